@@ -1,22 +1,66 @@
 #ifndef AST_ASTCOMMON_H_
 #define AST_ASTCOMMON_H_
 
-#include <ostream>
-
-#include "Dump.h"
-#include "Visitor.h"
-
-#define ACCEPT_VISITORS \
-  void accept(Visitor &visitor) const override { visitor.Visit(*this); }
+#include "Casting.h"
+#include "LineTable.h"
 
 namespace lang {
 namespace ast {
 
+/**
+ * The concrete class of a node. Kinds of the same abstract class are kept
+ * together so classof() can check a range.
+ */
+enum NodeKind {
+  NODE_MODULE,
+  NODE_FUNCTION_DECLARATION,
+  NODE_ARGUMENT_DECLARATION,
+
+  NODE_RETURN,
+  NODE_EXPR_STMT,
+  NODE_VAR_DECL,
+
+  NODE_CALL,
+  NODE_ID,
+  NODE_STRING_LITERAL,
+  NODE_INTEGER_LITERAL,
+
+  NODE_TYPENAME,
+
+  NODE_FIRST_STMT = NODE_RETURN,
+  NODE_LAST_STMT = NODE_VAR_DECL,
+  NODE_FIRST_EXPR = NODE_CALL,
+  NODE_LAST_EXPR = NODE_INTEGER_LITERAL,
+  NODE_FIRST_TYPE = NODE_TYPENAME,
+  NODE_LAST_TYPE = NODE_TYPENAME,
+};
+
+/**
+ * Nodes are allocated in an ASTContext and are never destroyed individually,
+ * so they must not own anything that needs a destructor. There are no
+ * virtual methods; use the kind with isa<>, dyn_cast<> or a
+ * RecursiveASTVisitor to find the concrete class.
+ */
 class Node {
  public:
-  virtual ~Node() {}
+  NodeKind Kind() const { return Kind_; }
+
+  /**
+   * The offset of the first token of this node from the start of the
+   * top-level declaration it is in, so a declaration's own location is 0.
+   * Moving a declaration within its buffer leaves its nodes untouched. Add
+   * Module::DeclLoc() to get the offset in the source buffer, and use the
+   * buffer's LineTable to get the row and col.
+   */
+  SourceLocation Loc() const { return Loc_; }
+  void SetLoc(SourceLocation Loc) { Loc_ = Loc; }
+
+ protected:
+  explicit Node(NodeKind Kind) : Kind_(Kind) {}
 
-  virtual void accept(Visitor &visitor) const = 0;
+ private:
+  NodeKind Kind_;
+  SourceLocation Loc_ = 0;
 };
 
 }  // namespace ast
@@ -0,0 +1,97 @@
+#ifndef AST_ASTCONTEXT_H_
+#define AST_ASTCONTEXT_H_
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Arena.h"
+#include "ArrayRef.h"
+#include "StringRef.h"
+
+namespace lang {
+namespace ast {
+
+/**
+ * Owns the memory for every node, child list and string in one AST. Nodes
+ * are never freed individually; they all go away together when the context
+ * is destroyed, which is why nodes must be trivially destructible.
+ */
+class ASTContext {
+ public:
+  ASTContext() = default;
+
+  /**
+   * A context for a small tree, such as a single function, whose arena uses
+   * slabs of SlabSize bytes.
+   */
+  explicit ASTContext(size_t SlabSize) : Alloc_(SlabSize) {}
+
+  ASTContext(const ASTContext &) = delete;
+  ASTContext &operator=(const ASTContext &) = delete;
+
+  template <class T, class... Args>
+  T *Create(Args &&... args) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "AST nodes are never destroyed");
+    void *Mem = Alloc_.Allocate(sizeof(T), alignof(T));
+    return new (Mem) T(std::forward<Args>(args)...);
+  }
+
+  /**
+   * Copy a temporary list of children into the context.
+   */
+  template <class T>
+  ArrayRef<T> CreateArray(const std::vector<T> &Elems) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Arrays are copied with memcpy");
+    if (Elems.empty()) return ArrayRef<T>();
+    size_t Size = sizeof(T) * Elems.size();
+    void *Mem = Alloc_.Allocate(Size, alignof(T));
+    memcpy(Mem, Elems.data(), Size);
+    return ArrayRef<T>(static_cast<T *>(Mem), Elems.size());
+  }
+
+  /**
+   * Allocate room for a list of children whose size is known up front. The
+   * caller fills in every element before the list is used.
+   */
+  template <class T>
+  T *AllocateArray(size_t Size) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Array elements are never constructed");
+    if (!Size) return nullptr;
+    return static_cast<T *>(Alloc_.Allocate(sizeof(T) * Size, alignof(T)));
+  }
+
+  StringRef CopyString(StringRef Str) {
+    if (Str.Empty()) return StringRef("", 0);
+    char *Mem = static_cast<char *>(Alloc_.Allocate(Str.Size(), 1));
+    memcpy(Mem, Str.Data(), Str.Size());
+    return StringRef(Mem, Str.Size());
+  }
+
+  /**
+   * Free every node, list and string created so far. Anything still pointing
+   * into the context is left dangling.
+   */
+  void Reset() { Alloc_.Reset(); }
+
+  /**
+   * Take ownership of everything created in Other, so nodes from several
+   * contexts can be kept alive by one.
+   */
+  void Adopt(ASTContext &Other) { Alloc_.Adopt(Other.Alloc_); }
+
+  size_t BytesAllocated() const { return Alloc_.BytesAllocated(); }
+
+ private:
+  Arena Alloc_;
+};
+
+}  // namespace ast
+}  // namespace lang
+
+#endif
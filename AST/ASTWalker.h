@@ -0,0 +1,173 @@
+#ifndef AST_ASTWALKER_H_
+#define AST_ASTWALKER_H_
+
+#include "ExternDecl.h"
+#include "InlineStack.h"
+
+namespace lang {
+namespace ast {
+
+/**
+ * Walks an AST with an explicit worklist instead of the C++ stack, so how
+ * deeply nodes can nest is only bounded by the heap. The worklist is inline
+ * until nodes nest deeply, so walking a typical tree does not allocate. Unlike
+ * RecursiveASTVisitor, derived classes never visit children themselves.
+ * They hide Enter and Leave for the nodes they care about and bring the
+ * rest in with
+ *
+ *   using ASTWalker<Derived>::Enter;
+ *   using ASTWalker<Derived>::Leave;
+ *
+ * A class that wants to see every node hides the templates instead.
+ *
+ * Enter is called before a node's children are walked and Leave after them.
+ * If Enter returns false the children are skipped, but Leave is still called.
+ * Children are walked in source order. Unlike RecursiveASTVisitor, this also
+ * walks the type of a VarDecl, before its initializer.
+ */
+template <class Derived>
+class ASTWalker {
+ public:
+  void Walk(const Node &Root) {
+    Worklist Stack;
+    Push(Root, Stack);
+    while (!Stack.Empty()) {
+      Frame &Top = Stack.Back();
+      if (const Node *Child = ChildAt(*Top.N, Top.Next++)) {
+        Push(*Child, Stack);
+        continue;
+      }
+      const Node *N = Top.N;
+      Stack.Pop();
+      LeaveNode(*N);
+    }
+  }
+
+  template <class T>
+  bool Enter(const T &) {
+    return true;
+  }
+
+  template <class T>
+  void Leave(const T &) {}
+
+  /**
+   * The I'th child of N in walk order, or null if it has no more.
+   */
+  static const Node *ChildAt(const Node &N, size_t I) {
+    switch (N.Kind()) {
+      case NODE_MODULE: {
+        ArrayRef<const ExternalDeclaration *> Decls =
+            static_cast<const Module &>(N).ExternDecls();
+        return I < Decls.Size() ? Decls[I] : nullptr;
+      }
+      case NODE_FUNCTION_DECLARATION: {
+        const auto &Func = static_cast<const FunctionDeclaration &>(N);
+        if (I == 0) return Func.ReturnType();
+        if (--I < Func.Args().Size()) return Func.Args()[I];
+        I -= Func.Args().Size();
+        return I < Func.Body().Size() ? Func.Body()[I] : nullptr;
+      }
+      case NODE_ARGUMENT_DECLARATION:
+        return I == 0 ? static_cast<const ArgumentDeclaration &>(N).ArgType()
+                      : nullptr;
+      case NODE_RETURN:
+        return I == 0 ? static_cast<const Return &>(N).Value() : nullptr;
+      case NODE_EXPR_STMT:
+        return I == 0 ? static_cast<const ExprStmt &>(N).Expression()
+                      : nullptr;
+      case NODE_VAR_DECL: {
+        const auto &Decl = static_cast<const VarDecl &>(N);
+        if (I == 0) return &Decl.VarType();
+        return I == 1 && Decl.HasInit() ? &Decl.Init() : nullptr;
+      }
+      case NODE_CALL: {
+        const auto &C = static_cast<const Call &>(N);
+        if (I == 0) return &C.Caller();
+        return I - 1 < C.Args().Size() ? C.Args()[I - 1] : nullptr;
+      }
+      case NODE_ID:
+      case NODE_STRING_LITERAL:
+      case NODE_INTEGER_LITERAL:
+      case NODE_TYPENAME:
+        return nullptr;
+    }
+    return nullptr;
+  }
+
+ private:
+  struct Frame {
+    const Node *N;
+    size_t Next;
+  };
+  using Worklist = InlineStack<Frame, 16>;
+
+  void Push(const Node &N, Worklist &Stack) {
+    if (EnterNode(N))
+      Stack.Push({&N, 0});
+    else
+      LeaveNode(N);
+  }
+
+  bool EnterNode(const Node &N) {
+    switch (N.Kind()) {
+      case NODE_MODULE:
+        return Self().Enter(static_cast<const Module &>(N));
+      case NODE_FUNCTION_DECLARATION:
+        return Self().Enter(static_cast<const FunctionDeclaration &>(N));
+      case NODE_ARGUMENT_DECLARATION:
+        return Self().Enter(static_cast<const ArgumentDeclaration &>(N));
+      case NODE_RETURN:
+        return Self().Enter(static_cast<const Return &>(N));
+      case NODE_EXPR_STMT:
+        return Self().Enter(static_cast<const ExprStmt &>(N));
+      case NODE_VAR_DECL:
+        return Self().Enter(static_cast<const VarDecl &>(N));
+      case NODE_CALL:
+        return Self().Enter(static_cast<const Call &>(N));
+      case NODE_ID:
+        return Self().Enter(static_cast<const ID &>(N));
+      case NODE_STRING_LITERAL:
+        return Self().Enter(static_cast<const StringLiteral &>(N));
+      case NODE_INTEGER_LITERAL:
+        return Self().Enter(static_cast<const IntegerLiteral &>(N));
+      case NODE_TYPENAME:
+        return Self().Enter(static_cast<const Typename &>(N));
+    }
+    return true;
+  }
+
+  void LeaveNode(const Node &N) {
+    switch (N.Kind()) {
+      case NODE_MODULE:
+        return Self().Leave(static_cast<const Module &>(N));
+      case NODE_FUNCTION_DECLARATION:
+        return Self().Leave(static_cast<const FunctionDeclaration &>(N));
+      case NODE_ARGUMENT_DECLARATION:
+        return Self().Leave(static_cast<const ArgumentDeclaration &>(N));
+      case NODE_RETURN:
+        return Self().Leave(static_cast<const Return &>(N));
+      case NODE_EXPR_STMT:
+        return Self().Leave(static_cast<const ExprStmt &>(N));
+      case NODE_VAR_DECL:
+        return Self().Leave(static_cast<const VarDecl &>(N));
+      case NODE_CALL:
+        return Self().Leave(static_cast<const Call &>(N));
+      case NODE_ID:
+        return Self().Leave(static_cast<const ID &>(N));
+      case NODE_STRING_LITERAL:
+        return Self().Leave(static_cast<const StringLiteral &>(N));
+      case NODE_INTEGER_LITERAL:
+        return Self().Leave(static_cast<const IntegerLiteral &>(N));
+      case NODE_TYPENAME:
+        return Self().Leave(static_cast<const Typename &>(N));
+    }
+  }
+
+  Derived &Self() { return *static_cast<Derived *>(this); }
+};
+
+}  // namespace ast
+}  // namespace lang
+
+#endif
@@ -1,5 +1,6 @@
 #include "Dump.h"
-#include "ExternDecl.h"
+
+#include "InlineStack.h"
 
 namespace lang {
 namespace ast {
@@ -8,16 +9,16 @@ void ASTDumper::Visit(const Module &module) {
   std::cerr << "init level " << level_ << std::endl;
   out_ << "Module\n";
   for (const auto &decl : module.ExternDecls()) {
-    decl->accept(*this);
+    Visit(*decl);
   }
 }
 
 void ASTDumper::Visit(const FunctionDeclaration &func_decl) {
   out_ << "|-FunctionDeclaration<\"" << func_decl.Name() << "\" -> ";
-  func_decl.ReturnType()->accept(*this);
+  Visit(*func_decl.ReturnType());
   out_ << ">(";
   for (const auto &arg : func_decl.Args()) {
-    arg->accept(*this);
+    Visit(*arg);
     out_ << "; ";
   }
   out_ << ")\n";
@@ -25,14 +26,14 @@ void ASTDumper::Visit(const FunctionDeclaration &func_decl) {
   level_++;
 
   for (auto const &stmt : func_decl.Body()) {
-    stmt->accept(*this);
+    Visit(*stmt);
   }
 
   level_--;
 }
 
 void ASTDumper::Visit(const ArgumentDeclaration &arg_decl) {
-  arg_decl.ArgType()->accept(*this);
+  Visit(*arg_decl.ArgType());
   out_ << " " << arg_decl.Name();
 }
 
@@ -40,7 +41,7 @@ void ASTDumper::Visit(const Return &ret) {
   AddPadding();
   out_ << "|-Return\n";
   level_++;
-  ret.Value()->accept(*this);
+  Visit(*ret.Value());
   level_--;
 }
 
@@ -48,30 +49,50 @@ void ASTDumper::Visit(const ExprStmt &exprstmt) {
   AddPadding();
   out_ << "|-ExprStmt\n";
   level_++;
-  exprstmt.Expression()->accept(*this);
+  Visit(*exprstmt.Expression());
   level_--;
 }
 
 void ASTDumper::Visit(const Call &call) {
-  AddPadding();
-  out_ << "|-Call\n";
-  level_++;
-
-  AddPadding();
-  out_ << "|-Caller\n";
-  level_++;
-  call.Caller().accept(*this);
-  level_--;
-
-  AddPadding();
-  out_ << "|-Args\n";
-  level_++;
-  for (const auto &expr : call.Args()) {
-    expr->accept(*this);
+  // Calls can nest arbitrarily deep, so instead of recursing into arguments
+  // keep a worklist of what is left to print, next item last. An item is
+  // either an expression or one of the labels of a call.
+  struct Item {
+    const Expr *E;
+    const char *Label;
+    unsigned Level;
+  };
+  InlineStack<Item, 16> Work;
+  Work.Push({&call, nullptr, level_});
+  unsigned Saved = level_;
+
+  while (!Work.Empty()) {
+    Item It = Work.Back();
+    Work.Pop();
+    level_ = It.Level;
+
+    if (It.Label) {
+      AddPadding();
+      out_ << It.Label;
+      continue;
+    }
+
+    const auto *C = dyn_cast<Call>(It.E);
+    if (!C) {
+      Visit(*It.E);
+      continue;
+    }
+
+    AddPadding();
+    out_ << "|-Call\n";
+    for (size_t i = C->Args().Size(); i-- > 0;)
+      Work.Push({C->Args()[i], nullptr, It.Level + 2});
+    Work.Push({nullptr, "|-Args\n", It.Level + 1});
+    Work.Push({&C->Caller(), nullptr, It.Level + 2});
+    Work.Push({nullptr, "|-Caller\n", It.Level + 1});
   }
-  level_--;
 
-  level_--;
+  level_ = Saved;
 }
 
 void ASTDumper::Visit(const ID &id) {
@@ -3,36 +3,27 @@
 
 #include <iostream>
 
-#include "Visitor.h"
+#include "RecursiveASTVisitor.h"
 
 namespace lang {
 namespace ast {
 
-class ArgumentDeclaration;
-class Call;
-class ExprStmt;
-class FunctionDeclaration;
-class ID;
-class IntegerLiteral;
-class Module;
-class Return;
-class StringLiteral;
-class Typename;
-
-class ASTDumper : public Visitor {
+class ASTDumper : public RecursiveASTVisitor<ASTDumper> {
  public:
   ASTDumper(std::ostream &out) : out_(out) {}
 
-  void Visit(const Module &module) override;
-  void Visit(const FunctionDeclaration &func_decl) override;
-  void Visit(const ArgumentDeclaration &arg_decl) override;
-  void Visit(const Return &ret) override;
-  void Visit(const ExprStmt &exprstmt) override;
-  void Visit(const Call &call) override;
-  void Visit(const ID &id) override;
-  void Visit(const StringLiteral &str) override;
-  void Visit(const IntegerLiteral &integer) override;
-  void Visit(const Typename &type) override;
+  using RecursiveASTVisitor<ASTDumper>::Visit;
+
+  void Visit(const Module &module);
+  void Visit(const FunctionDeclaration &func_decl);
+  void Visit(const ArgumentDeclaration &arg_decl);
+  void Visit(const Return &ret);
+  void Visit(const ExprStmt &exprstmt);
+  void Visit(const Call &call);
+  void Visit(const ID &id);
+  void Visit(const StringLiteral &str);
+  void Visit(const IntegerLiteral &integer);
+  void Visit(const Typename &type);
 
  private:
   void AddPadding() const {
@@ -7,14 +7,18 @@ namespace ast {
 
 // TODO: This method does not allow fully parsing the largest possible
 // decimal value for 2^64. Come back to this method to improve it.
-static bool CanAlwaysFitInto64Bits(const std::string &Str) {
-  return Str.length() <= 19;  // log10(2^64)
+static bool CanAlwaysFitInto64Bits(StringRef Str) {
+  return Str.Size() <= 19;  // log10(2^64)
 }
 
-std::unique_ptr<IntegerLiteral> IntegerLiteral::FromStr(
-    const std::string &Val) {
+/**
+ * NOTE: This function assumes the argument passed only contains digits.
+ */
+IntegerLiteral *IntegerLiteral::FromStr(ASTContext &Ctx, StringRef Val) {
   if (!CanAlwaysFitInto64Bits(Val)) return nullptr;
-  return std::make_unique<IntegerLiteral>(std::stoull(Val));
+  uint64_t Result = 0;
+  for (char C : Val) Result = Result * 10 + (C - '0');
+  return Ctx.Create<IntegerLiteral>(Result);
 }
 
 }  // namespace ast
@@ -1,30 +1,42 @@
 #ifndef AST_EXPR_H_
 #define AST_EXPR_H_
 
-#include <memory>
 #include <string>
-#include <vector>
 
 #include "ASTCommon.h"
+#include "ASTContext.h"
+#include "ArrayRef.h"
+#include "Interner.h"
+#include "StringRef.h"
 
 namespace lang {
 namespace ast {
 
-class Expr : public Node {};
+class Expr : public Node {
+ public:
+  static bool classof(const Node *N) {
+    return N->Kind() >= NODE_FIRST_EXPR && N->Kind() <= NODE_LAST_EXPR;
+  }
+
+ protected:
+  explicit Expr(NodeKind Kind) : Node(Kind) {}
+};
 
 class IntegerLiteral : public Expr {
  public:
-  IntegerLiteral(uint64_t Val) : Val_(Val) {}
+  IntegerLiteral(uint64_t Val) : Expr(NODE_INTEGER_LITERAL), Val_(Val) {}
 
   uint64_t Value() const { return Val_; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) {
+    return N->Kind() == NODE_INTEGER_LITERAL;
+  }
 
   /**
    * Attempts to parse an uint64_t from a string. Returns the integer literal
    * holding the value if successful and nullptr otherwise.
    */
-  static std::unique_ptr<IntegerLiteral> FromStr(const std::string &Val);
+  static IntegerLiteral *FromStr(ASTContext &Ctx, StringRef Val);
 
  private:
   uint64_t Val_;
@@ -32,17 +44,18 @@ class IntegerLiteral : public Expr {
 
 class StringLiteral : public Expr {
  public:
-  StringLiteral(const std::string &Val) : Val_(Val) {}
+  // The characters must be owned by the ASTContext this node is created in.
+  StringLiteral(StringRef Val) : Expr(NODE_STRING_LITERAL), Val_(Val) {}
 
   // Return the raw string from the source code with the surrounding quotes.
-  std::string Value() const { return Val_; }
+  StringRef Value() const { return Val_; }
 
   // Return the string without the surrounding quotes and escaped characters
   // (ie. "\n" is interpretted as the newline character in the resulting
   // string).
   std::string EscapedValue() const {
     std::string s;
-    for (unsigned i = 1; i < Val_.size() - 1; ++i) {
+    for (unsigned i = 1; i < Val_.Size() - 1; ++i) {
       char c = Val_[i];
       if (c == '\\') {
         ++i;
@@ -62,38 +75,40 @@ class StringLiteral : public Expr {
     return s;
   }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) {
+    return N->Kind() == NODE_STRING_LITERAL;
+  }
 
  private:
-  std::string Val_;
+  StringRef Val_;
 };
 
 class ID : public Expr {
  public:
-  ID(std::string &Name) : Name_(Name) {}
+  ID(Symbol Name) : Expr(NODE_ID), Name_(Name) {}
 
-  std::string Name() const { return Name_; }
+  Symbol Name() const { return Name_; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) { return N->Kind() == NODE_ID; }
 
  private:
-  std::string Name_;
+  Symbol Name_;
 };
 
 class Call : public Expr {
  public:
-  Call(std::unique_ptr<Expr> Func) : Func_(std::move(Func)) {}
-  Call(std::unique_ptr<Expr> Func, std::vector<std::unique_ptr<Expr>> &Args)
-      : Func_(std::move(Func)), Args_(std::move(Args)) {}
+  Call(const Expr *Func) : Expr(NODE_CALL), Func_(Func) {}
+  Call(const Expr *Func, ArrayRef<const Expr *> Args)
+      : Expr(NODE_CALL), Func_(Func), Args_(Args) {}
 
   const Expr &Caller() const { return *Func_; }
-  const std::vector<std::unique_ptr<Expr>> &Args() const { return Args_; }
+  ArrayRef<const Expr *> Args() const { return Args_; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) { return N->Kind() == NODE_CALL; }
 
  private:
-  std::unique_ptr<Expr> Func_;
-  std::vector<std::unique_ptr<Expr>> Args_;
+  const Expr *Func_;
+  ArrayRef<const Expr *> Args_;
 };
 
 }  // namespace ast
@@ -1,70 +1,253 @@
 #ifndef AST_EXTERNDECL_H_
 #define AST_EXTERNDECL_H_
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "ASTCommon.h"
+#include "ASTContext.h"
+#include "ArrayRef.h"
 #include "Stmt.h"
 #include "Type.h"
 
 namespace lang {
 namespace ast {
 
-class ExternalDeclaration : public Node {};
+class ExternalDeclaration : public Node {
+ public:
+  static bool classof(const Node *N) {
+    return N->Kind() == NODE_FUNCTION_DECLARATION;
+  }
+
+ protected:
+  explicit ExternalDeclaration(NodeKind Kind) : Node(Kind) {}
+};
 
 class ArgumentDeclaration : public Node {
  public:
-  ArgumentDeclaration(std::unique_ptr<Type> Ty, std::string &Name)
-      : Ty_(std::move(Ty)), Name_(Name) {}
+  ArgumentDeclaration(const Type *Ty, Symbol Name)
+      : Node(NODE_ARGUMENT_DECLARATION), Ty_(Ty), Name_(Name) {}
 
-  const Type *ArgType() const { return Ty_.get(); }
-  std::string Name() const { return Name_; }
+  const Type *ArgType() const { return Ty_; }
+  Symbol Name() const { return Name_; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) {
+    return N->Kind() == NODE_ARGUMENT_DECLARATION;
+  }
 
  private:
-  std::unique_ptr<Type> Ty_;
-  std::string Name_;
+  const Type *Ty_;
+  Symbol Name_;
+};
+
+class FunctionDeclaration;
+
+/**
+ * Parses function bodies that were skipped when their module was parsed. The
+ * module owns the source, so the nodes it creates live as long as the rest of
+ * the tree.
+ *
+ * Bodies are parsed one at a time under the source's lock, so any number of
+ * threads may ask for them.
+ */
+class BodySource {
+ public:
+  virtual ~BodySource() = default;
+
+  /**
+   * Returns false if any body parsed so far had an error.
+   */
+  bool Ok() const {
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    return Ok_;
+  }
+
+  /**
+   * Print the first error hit while parsing a body. Returns true if there was
+   * none.
+   */
+  virtual bool DebugOk() const = 0;
+
+ protected:
+  /**
+   * Parse the body spanning tokens [Begin, End), braces included, of the
+   * declaration starting at DeclStart. Only called with the lock held.
+   * Returns false on an error.
+   */
+  virtual bool ParseBody(uint32_t Begin, uint32_t End,
+                         SourceLocation DeclStart,
+                         ArrayRef<const Stmt *> &Body) = 0;
+
+  // Held while a body is parsed.
+  mutable std::mutex Mutex_;
+
+ private:
+  friend class FunctionDeclaration;
+
+  ArrayRef<const Stmt *> Body(const FunctionDeclaration &Func);
+
+  bool Ok_ = true;
 };
 
 class FunctionDeclaration : public ExternalDeclaration {
  public:
-  FunctionDeclaration(std::unique_ptr<Type> RetType, const std::string &Name,
-                      std::vector<std::unique_ptr<ArgumentDeclaration>> &Args,
-                      std::vector<std::unique_ptr<Stmt>> &Body)
-      : RetType_(std::move(RetType)),
+  FunctionDeclaration(const Type *RetType, Symbol Name,
+                      ArrayRef<const ArgumentDeclaration *> Args,
+                      ArrayRef<const Stmt *> Body)
+      : ExternalDeclaration(NODE_FUNCTION_DECLARATION),
+        RetType_(RetType),
+        Name_(Name),
+        Args_(Args),
+        Body_(Body) {}
+
+  /**
+   * A function whose body is only parsed by Source the first time Body() is
+   * called. The body spans tokens [BodyBegin, BodyEnd), and the function
+   * starts at DeclStart in its buffer.
+   */
+  FunctionDeclaration(const Type *RetType, Symbol Name,
+                      ArrayRef<const ArgumentDeclaration *> Args,
+                      BodySource &Source, uint32_t BodyBegin,
+                      uint32_t BodyEnd, SourceLocation DeclStart)
+      : ExternalDeclaration(NODE_FUNCTION_DECLARATION),
+        RetType_(RetType),
         Name_(Name),
-        Args_(std::move(Args)),
-        Body_(std::move(Body)) {}
+        Args_(Args),
+        Source_(&Source),
+        BodyBegin_(BodyBegin),
+        BodyEnd_(BodyEnd),
+        DeclStart_(DeclStart),
+        BodyParsed_(false) {}
 
-  const Type *ReturnType() const { return RetType_.get(); }
-  std::string Name() const { return Name_; }
-  const std::vector<std::unique_ptr<ArgumentDeclaration>> &Args() const {
-    return Args_;
+  const Type *ReturnType() const { return RetType_; }
+  Symbol Name() const { return Name_; }
+  ArrayRef<const ArgumentDeclaration *> Args() const { return Args_; }
+
+  /**
+   * A body that failed to parse is empty, and the error is reported by the
+   * module's BodySource.
+   */
+  ArrayRef<const Stmt *> Body() const {
+    if (BodyParsed_.load(std::memory_order_acquire)) return Body_;
+    return Source_->Body(*this);
   }
-  const std::vector<std::unique_ptr<Stmt>> &Body() const { return Body_; }
 
-  ACCEPT_VISITORS;
+  /**
+   * False until a deferred body is parsed.
+   */
+  bool HasParsedBody() const {
+    return BodyParsed_.load(std::memory_order_acquire);
+  }
+
+  static bool classof(const Node *N) {
+    return N->Kind() == NODE_FUNCTION_DECLARATION;
+  }
 
  private:
-  std::unique_ptr<Type> RetType_;
-  std::string Name_;
-  std::vector<std::unique_ptr<ArgumentDeclaration>> Args_;
-  std::vector<std::unique_ptr<Stmt>> Body_;
+  friend class BodySource;
+
+  const Type *RetType_;
+  Symbol Name_;
+  ArrayRef<const ArgumentDeclaration *> Args_;
+
+  // A deferred body is written once by its source, which then sets
+  // BodyParsed_. Readers only look at Body_ after seeing BodyParsed_.
+  mutable ArrayRef<const Stmt *> Body_;
+  BodySource *Source_ = nullptr;
+  uint32_t BodyBegin_ = 0;
+  uint32_t BodyEnd_ = 0;
+  SourceLocation DeclStart_ = 0;
+  mutable std::atomic<bool> BodyParsed_{true};
 };
 
+inline ArrayRef<const Stmt *> BodySource::Body(
+    const FunctionDeclaration &Func) {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  if (!Func.BodyParsed_.load(std::memory_order_relaxed)) {
+    if (!ParseBody(Func.BodyBegin_, Func.BodyEnd_, Func.DeclStart_,
+                   Func.Body_)) {
+      Func.Body_ = ArrayRef<const Stmt *>();
+      Ok_ = false;
+    }
+    Func.BodyParsed_.store(true, std::memory_order_release);
+  }
+  return Func.Body_;
+}
+
+/**
+ * The root of an AST. Unlike every other node, the module is allocated on the
+ * heap and owns the ASTContext holding the rest of the tree, so destroying it
+ * frees the whole AST at once. It also owns the source of any function bodies
+ * that have not been parsed yet.
+ *
+ * The module also keeps where each top-level declaration starts, since the
+ * locations of the nodes in a declaration are relative to its start.
+ */
 class Module : public Node {
  public:
-  explicit Module(
-      std::vector<std::unique_ptr<ExternalDeclaration>> &ExternDecls)
-      : ExternDecls_(std::move(ExternDecls)) {}
+  Module(std::unique_ptr<ASTContext> Ctx,
+         ArrayRef<const ExternalDeclaration *> ExternDecls,
+         ArrayRef<SourceLocation> DeclLocs,
+         std::unique_ptr<BodySource> Bodies = nullptr)
+      : Node(NODE_MODULE),
+        Ctx_(std::move(Ctx)),
+        ExternDecls_(ExternDecls),
+        DeclLocs_(DeclLocs),
+        Bodies_(std::move(Bodies)) {}
 
-  const std::vector<std::unique_ptr<ExternalDeclaration>> &ExternDecls() const {
+  /**
+   * A module whose declarations live in contexts of their own rather than in
+   * Ctx, which only holds the two lists. DeclCtxs has the context of each
+   * declaration, and declarations may share one. A context is freed once no
+   * module holds on to it, so modules can share the declarations they have
+   * in common and drop the rest.
+   */
+  Module(std::unique_ptr<ASTContext> Ctx,
+         ArrayRef<const ExternalDeclaration *> ExternDecls,
+         ArrayRef<SourceLocation> DeclLocs,
+         std::vector<std::shared_ptr<const ASTContext>> DeclCtxs)
+      : Node(NODE_MODULE),
+        Ctx_(std::move(Ctx)),
+        ExternDecls_(ExternDecls),
+        DeclLocs_(DeclLocs),
+        DeclCtxs_(std::move(DeclCtxs)) {}
+
+  ArrayRef<const ExternalDeclaration *> ExternDecls() const {
     return ExternDecls_;
   }
 
-  ACCEPT_VISITORS;
+  /**
+   * The offset in the source buffer where each declaration starts.
+   */
+  ArrayRef<SourceLocation> DeclLocs() const { return DeclLocs_; }
+  SourceLocation DeclLoc(size_t i) const { return DeclLocs_[i]; }
+
+  const ASTContext &Context() const { return *Ctx_; }
+
+  /**
+   * The context holding declaration i and everything in it.
+   */
+  std::shared_ptr<const ASTContext> DeclContext(size_t i) const {
+    if (DeclCtxs_.empty()) return Ctx_;
+    return DeclCtxs_[i];
+  }
+
+  /**
+   * Null unless the module was parsed with deferred bodies.
+   */
+  const BodySource *Bodies() const { return Bodies_.get(); }
+
+  static bool classof(const Node *N) { return N->Kind() == NODE_MODULE; }
 
  private:
-  std::vector<std::unique_ptr<ExternalDeclaration>> ExternDecls_;
+  std::shared_ptr<const ASTContext> Ctx_;
+  ArrayRef<const ExternalDeclaration *> ExternDecls_;
+  ArrayRef<SourceLocation> DeclLocs_;
+  std::vector<std::shared_ptr<const ASTContext>> DeclCtxs_;
+  std::unique_ptr<BodySource> Bodies_;
 };
 
 }  // namespace ast
@@ -0,0 +1,250 @@
+#include "FlatAST.h"
+
+#include <cassert>
+
+#include "ASTWalker.h"
+
+namespace lang {
+namespace ast {
+
+constexpr unsigned NodeRef::kKindBits;
+constexpr uint32_t NodeRef::kMaxIdx;
+
+/**
+ * Appends each node to a FlatModule once all of its children have been
+ * appended. Refs_ holds the flat copies of the children of every node that is
+ * still being walked, so leaving a node pops its children off the end.
+ */
+class FlatBuilder : public ASTWalker<FlatBuilder> {
+ public:
+  FlatBuilder(const Module &Src, FlatModule &Mod) : Src_(Src), Mod_(Mod) {}
+
+  using ASTWalker<FlatBuilder>::Enter;
+  using ASTWalker<FlatBuilder>::Leave;
+
+  void Leave(const Module &) { Refs_.clear(); }
+  void Leave(const FunctionDeclaration &func_decl);
+  void Leave(const ArgumentDeclaration &arg_decl);
+  void Leave(const Return &ret);
+  void Leave(const ExprStmt &exprstmt);
+  void Leave(const Call &call);
+  void Leave(const ID &id);
+  void Leave(const StringLiteral &str);
+  void Leave(const IntegerLiteral &integer);
+  void Leave(const Typename &type);
+  void Leave(const VarDecl &vardecl);
+
+ private:
+  NodeRef Pop() {
+    NodeRef Ref = Refs_.back();
+    Refs_.pop_back();
+    return Ref;
+  }
+
+  /**
+   * Copy the last Size refs into the child table as a list.
+   */
+  ChildRange PopList(size_t Size) {
+    ChildRange Range{static_cast<uint32_t>(Mod_.Children_.size()),
+                     static_cast<uint32_t>(Size)};
+    Mod_.Children_.insert(Mod_.Children_.end(), Refs_.end() - Size,
+                          Refs_.end());
+    Refs_.resize(Refs_.size() - Size);
+    return Range;
+  }
+
+  template <class T>
+  void Append(std::vector<T> &Nodes, FlatKind Kind, const T &Node) {
+    assert(Nodes.size() <= NodeRef::kMaxIdx && "Too many nodes of one kind");
+    Nodes.push_back(Node);
+    Refs_.push_back(NodeRef(Kind, static_cast<uint32_t>(Nodes.size() - 1)));
+  }
+
+  const Module &Src_;
+  FlatModule &Mod_;
+  std::vector<NodeRef> Refs_;
+  size_t NextDecl_ = 0;
+};
+
+void FlatBuilder::Leave(const FunctionDeclaration &func_decl) {
+  FlatFunc Func;
+  Func.Name = func_decl.Name();
+  ChildRange Body = PopList(func_decl.Body().Size());
+  Func.Args = PopList(func_decl.Args().Size());
+  Func.Body = Body;
+  Func.RetType = Pop();
+  Func.Loc = Src_.DeclLoc(NextDecl_++);
+  Append(Mod_.Funcs_, FLAT_FUNC, Func);
+}
+
+void FlatBuilder::Leave(const ArgumentDeclaration &arg_decl) {
+  FlatArg Arg{arg_decl.Name(), Pop(), arg_decl.Loc()};
+  Append(Mod_.Args_, FLAT_ARG, Arg);
+}
+
+void FlatBuilder::Leave(const Return &ret) {
+  FlatReturn Ret{Pop(), ret.Loc()};
+  Append(Mod_.Returns_, FLAT_RETURN, Ret);
+}
+
+void FlatBuilder::Leave(const ExprStmt &exprstmt) {
+  FlatExprStmt S{Pop(), exprstmt.Loc()};
+  Append(Mod_.ExprStmts_, FLAT_EXPR_STMT, S);
+}
+
+void FlatBuilder::Leave(const Call &call) {
+  FlatCall C;
+  C.Args = PopList(call.Args().Size());
+  C.Caller = Pop();
+  C.Loc = call.Loc();
+  Append(Mod_.Calls_, FLAT_CALL, C);
+}
+
+void FlatBuilder::Leave(const ID &id) {
+  Append(Mod_.IDs_, FLAT_ID, FlatID{id.Name(), id.Loc()});
+}
+
+void FlatBuilder::Leave(const StringLiteral &str) {
+  StringRef Val = str.Value();
+  FlatStr S{static_cast<uint32_t>(Mod_.Chars_.size()),
+            static_cast<uint32_t>(Val.Size()), str.Loc()};
+  Mod_.Chars_.insert(Mod_.Chars_.end(), Val.begin(), Val.end());
+  Append(Mod_.Strs_, FLAT_STR, S);
+}
+
+void FlatBuilder::Leave(const IntegerLiteral &integer) {
+  Append(Mod_.Ints_, FLAT_INT, FlatInt{integer.Value(), integer.Loc()});
+}
+
+void FlatBuilder::Leave(const Typename &type) {
+  Append(Mod_.Typenames_, FLAT_TYPENAME, FlatTypename{type.Name(), type.Loc()});
+}
+
+void FlatBuilder::Leave(const VarDecl &vardecl) {
+  FlatVarDecl Decl;
+  Decl.Name = vardecl.Name();
+  Decl.Init = vardecl.HasInit() ? Pop() : NodeRef();
+  Decl.Ty = Pop();
+  Decl.Loc = vardecl.Loc();
+  Append(Mod_.VarDecls_, FLAT_VAR_DECL, Decl);
+}
+
+FlatModule FlatModule::FromModule(const Module &Mod) {
+  FlatModule Flat;
+  FlatBuilder Builder(Mod, Flat);
+  Builder.Walk(Mod);
+  return Flat;
+}
+
+size_t FlatModule::NumNodes() const {
+  return Funcs_.size() + Args_.size() + Returns_.size() + ExprStmts_.size() +
+         VarDecls_.size() + Calls_.size() + IDs_.size() + Strs_.size() +
+         Ints_.size() + Typenames_.size();
+}
+
+template <class T>
+static size_t CapacityBytes(const std::vector<T> &Vec) {
+  return Vec.capacity() * sizeof(T);
+}
+
+size_t FlatModule::BytesAllocated() const {
+  return CapacityBytes(Funcs_) + CapacityBytes(Args_) +
+         CapacityBytes(Returns_) + CapacityBytes(ExprStmts_) +
+         CapacityBytes(VarDecls_) + CapacityBytes(Calls_) +
+         CapacityBytes(IDs_) + CapacityBytes(Strs_) + CapacityBytes(Ints_) +
+         CapacityBytes(Typenames_) + CapacityBytes(Children_) +
+         CapacityBytes(Chars_);
+}
+
+void FlatASTDumper::Dump() {
+  out_ << "Module\n";
+  for (const FlatFunc &Func : Mod_.Funcs()) DumpFunc(Func);
+}
+
+void FlatASTDumper::DumpFunc(const FlatFunc &Func) {
+  out_ << "|-FunctionDeclaration<\"" << Func.Name << "\" -> ";
+  DumpNode(Func.RetType);
+  out_ << ">(";
+  for (NodeRef Arg : Mod_.Children(Func.Args)) {
+    DumpNode(Arg);
+    out_ << "; ";
+  }
+  out_ << ")\n";
+
+  level_++;
+  for (NodeRef Stmt : Mod_.Children(Func.Body)) DumpNode(Stmt);
+  level_--;
+}
+
+void FlatASTDumper::DumpNode(NodeRef Ref) {
+  switch (Ref.Kind()) {
+    case FLAT_NONE:
+      break;
+    case FLAT_FUNC:
+      DumpFunc(Mod_.AsFunc(Ref));
+      break;
+    case FLAT_ARG: {
+      const FlatArg &Arg = Mod_.AsArg(Ref);
+      DumpNode(Arg.Ty);
+      out_ << " " << Arg.Name;
+      break;
+    }
+    case FLAT_RETURN:
+      AddPadding();
+      out_ << "|-Return\n";
+      level_++;
+      DumpNode(Mod_.AsReturn(Ref).Value);
+      level_--;
+      break;
+    case FLAT_EXPR_STMT:
+      AddPadding();
+      out_ << "|-ExprStmt\n";
+      level_++;
+      DumpNode(Mod_.AsExprStmt(Ref).E);
+      level_--;
+      break;
+    case FLAT_VAR_DECL:
+      // Like ASTDumper, only the initializer is printed.
+      DumpNode(Mod_.AsVarDecl(Ref).Init);
+      break;
+    case FLAT_CALL: {
+      const FlatCall &C = Mod_.AsCall(Ref);
+      AddPadding();
+      out_ << "|-Call\n";
+      level_++;
+
+      AddPadding();
+      out_ << "|-Caller\n";
+      level_++;
+      DumpNode(C.Caller);
+      level_--;
+
+      AddPadding();
+      out_ << "|-Args\n";
+      level_++;
+      for (NodeRef Arg : Mod_.Children(C.Args)) DumpNode(Arg);
+      level_--;
+
+      level_--;
+      break;
+    }
+    case FLAT_ID:
+      AddPadding();
+      out_ << "|-ID<\"" << Mod_.AsID(Ref).Name << "\">\n";
+      break;
+    case FLAT_STR:
+      AddPadding();
+      out_ << "|-StringLiteral<" << Mod_.StrValue(Mod_.AsStr(Ref)) << ">\n";
+      break;
+    case FLAT_INT:
+      AddPadding();
+      out_ << "|-IntegerLiteral<" << Mod_.AsInt(Ref).Val << ">\n";
+      break;
+    case FLAT_TYPENAME:
+      out_ << "\"" << Mod_.AsTypename(Ref).Name << "\"";
+      break;
+  }
+}
+
+}  // namespace ast
+}  // namespace lang
@@ -0,0 +1,220 @@
+#ifndef AST_FLATAST_H_
+#define AST_FLATAST_H_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "ArrayRef.h"
+#include "Interner.h"
+#include "LineTable.h"
+#include "StringRef.h"
+
+namespace lang {
+namespace ast {
+
+class Module;
+
+enum FlatKind : uint32_t {
+  FLAT_NONE,
+  FLAT_FUNC,
+  FLAT_ARG,
+  FLAT_RETURN,
+  FLAT_EXPR_STMT,
+  FLAT_VAR_DECL,
+  FLAT_CALL,
+  FLAT_ID,
+  FLAT_STR,
+  FLAT_INT,
+  FLAT_TYPENAME,
+};
+
+/**
+ * A 32-bit reference to a node in a FlatModule. The top bits hold the node
+ * kind and the rest hold the index into that kind's array.
+ */
+class NodeRef {
+ public:
+  static constexpr unsigned kKindBits = 4;
+  static constexpr uint32_t kMaxIdx = (1u << (32 - kKindBits)) - 1;
+
+  NodeRef() : Raw_(0) {}
+  NodeRef(FlatKind Kind, uint32_t Idx)
+      : Raw_((uint32_t(Kind) << (32 - kKindBits)) | Idx) {}
+
+  FlatKind Kind() const { return FlatKind(Raw_ >> (32 - kKindBits)); }
+  uint32_t Idx() const { return Raw_ & kMaxIdx; }
+  bool Valid() const { return Kind() != FLAT_NONE; }
+
+ private:
+  uint32_t Raw_;
+};
+
+/**
+ * A range of node references in the FlatModule's child table.
+ */
+struct ChildRange {
+  uint32_t Begin;
+  uint32_t Size;
+};
+
+struct FlatFunc {
+  Symbol Name;
+  NodeRef RetType;
+  ChildRange Args;
+  ChildRange Body;
+  // Where the function starts in its buffer. The locations of every other
+  // node are relative to the function they are in.
+  SourceLocation Loc;
+};
+
+struct FlatArg {
+  Symbol Name;
+  NodeRef Ty;
+  SourceLocation Loc;
+};
+
+struct FlatReturn {
+  NodeRef Value;
+  SourceLocation Loc;
+};
+
+struct FlatExprStmt {
+  NodeRef E;
+  SourceLocation Loc;
+};
+
+struct FlatVarDecl {
+  Symbol Name;
+  NodeRef Ty;
+  NodeRef Init;  // Not valid if there is no initializer.
+  SourceLocation Loc;
+};
+
+struct FlatCall {
+  NodeRef Caller;
+  ChildRange Args;
+  SourceLocation Loc;
+};
+
+struct FlatID {
+  Symbol Name;
+  SourceLocation Loc;
+};
+
+// The characters are in the module's character pool.
+struct FlatStr {
+  uint32_t Begin;
+  uint32_t Size;
+  SourceLocation Loc;
+};
+
+struct FlatInt {
+  uint64_t Val;
+  SourceLocation Loc;
+};
+
+struct FlatTypename {
+  Symbol Name;
+  SourceLocation Loc;
+};
+
+/**
+ * An alternative to the ast::Module pointer tree. Each node kind is stored in
+ * its own contiguous array and nodes refer to each other with 32-bit
+ * NodeRefs. Every child list lives in one shared table, so walking a module
+ * reads a handful of arrays front to back instead of chasing pointers.
+ */
+class FlatModule {
+ public:
+  /**
+   * Copy an AST into the flat representation. The module can be freed
+   * afterwards.
+   */
+  static FlatModule FromModule(const Module &Mod);
+
+  const std::vector<FlatFunc> &Funcs() const { return Funcs_; }
+
+  const FlatFunc &AsFunc(NodeRef Ref) const { return Funcs_[Ref.Idx()]; }
+  const FlatArg &AsArg(NodeRef Ref) const { return Args_[Ref.Idx()]; }
+  const FlatReturn &AsReturn(NodeRef Ref) const {
+    return Returns_[Ref.Idx()];
+  }
+  const FlatExprStmt &AsExprStmt(NodeRef Ref) const {
+    return ExprStmts_[Ref.Idx()];
+  }
+  const FlatVarDecl &AsVarDecl(NodeRef Ref) const {
+    return VarDecls_[Ref.Idx()];
+  }
+  const FlatCall &AsCall(NodeRef Ref) const { return Calls_[Ref.Idx()]; }
+  const FlatID &AsID(NodeRef Ref) const { return IDs_[Ref.Idx()]; }
+  const FlatStr &AsStr(NodeRef Ref) const { return Strs_[Ref.Idx()]; }
+  const FlatInt &AsInt(NodeRef Ref) const { return Ints_[Ref.Idx()]; }
+  const FlatTypename &AsTypename(NodeRef Ref) const {
+    return Typenames_[Ref.Idx()];
+  }
+
+  ArrayRef<NodeRef> Children(ChildRange Range) const {
+    return ArrayRef<NodeRef>(Children_.data() + Range.Begin, Range.Size);
+  }
+
+  // Return the raw string from the source code with the surrounding quotes.
+  StringRef StrValue(const FlatStr &S) const {
+    return StringRef(Chars_.data() + S.Begin, S.Size);
+  }
+
+  size_t NumNodes() const;
+
+  /**
+   * The bytes used by every array in the module.
+   */
+  size_t BytesAllocated() const;
+
+ private:
+  friend class ASTWriter;
+  friend class FlatBuilder;
+
+  std::vector<FlatFunc> Funcs_;
+  std::vector<FlatArg> Args_;
+  std::vector<FlatReturn> Returns_;
+  std::vector<FlatExprStmt> ExprStmts_;
+  std::vector<FlatVarDecl> VarDecls_;
+  std::vector<FlatCall> Calls_;
+  std::vector<FlatID> IDs_;
+  std::vector<FlatStr> Strs_;
+  std::vector<FlatInt> Ints_;
+  std::vector<FlatTypename> Typenames_;
+
+  std::vector<NodeRef> Children_;
+  std::vector<char> Chars_;
+};
+
+/**
+ * Prints a FlatModule in the same format as ASTDumper.
+ */
+class FlatASTDumper {
+ public:
+  FlatASTDumper(const FlatModule &Mod, std::ostream &out)
+      : Mod_(Mod), out_(out) {}
+
+  void Dump();
+
+ private:
+  void DumpFunc(const FlatFunc &Func);
+  void DumpNode(NodeRef Ref);
+
+  void AddPadding() const {
+    for (unsigned i = 0; i < level_; ++i) {
+      out_ << "  ";
+    }
+  }
+
+  const FlatModule &Mod_;
+  std::ostream &out_;
+  unsigned level_ = 0;
+};
+
+}  // namespace ast
+}  // namespace lang
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef AST_RECURSIVEASTVISITOR_H_
+#define AST_RECURSIVEASTVISITOR_H_
+
+#include "ExternDecl.h"
+
+namespace lang {
+namespace ast {
+
+/**
+ * Walks an AST without virtual calls. Derived classes hide the Visit methods
+ * for the nodes they care about and bring the rest in with
+ *
+ *   using RecursiveASTVisitor<Derived>::Visit;
+ *
+ * Visit(const Node &) switches on the node's kind and calls the Visit method
+ * of Derived for the concrete class. The default Visit methods visit each
+ * child through it, so a Derived that only handles leaves still sees every
+ * node in the tree.
+ */
+template <class Derived>
+class RecursiveASTVisitor {
+ public:
+  void Visit(const Node &N) {
+    switch (N.Kind()) {
+      case NODE_MODULE:
+        return Self().Visit(static_cast<const Module &>(N));
+      case NODE_FUNCTION_DECLARATION:
+        return Self().Visit(static_cast<const FunctionDeclaration &>(N));
+      case NODE_ARGUMENT_DECLARATION:
+        return Self().Visit(static_cast<const ArgumentDeclaration &>(N));
+      case NODE_RETURN:
+        return Self().Visit(static_cast<const Return &>(N));
+      case NODE_EXPR_STMT:
+        return Self().Visit(static_cast<const ExprStmt &>(N));
+      case NODE_VAR_DECL:
+        return Self().Visit(static_cast<const VarDecl &>(N));
+      case NODE_CALL:
+        return Self().Visit(static_cast<const Call &>(N));
+      case NODE_ID:
+        return Self().Visit(static_cast<const ID &>(N));
+      case NODE_STRING_LITERAL:
+        return Self().Visit(static_cast<const StringLiteral &>(N));
+      case NODE_INTEGER_LITERAL:
+        return Self().Visit(static_cast<const IntegerLiteral &>(N));
+      case NODE_TYPENAME:
+        return Self().Visit(static_cast<const Typename &>(N));
+    }
+  }
+
+  void Visit(const Module &module) {
+    for (const ExternalDeclaration *decl : module.ExternDecls())
+      Self().Visit(static_cast<const Node &>(*decl));
+  }
+
+  void Visit(const FunctionDeclaration &func_decl) {
+    Self().Visit(static_cast<const Node &>(*func_decl.ReturnType()));
+    for (const ArgumentDeclaration *arg : func_decl.Args())
+      Self().Visit(static_cast<const Node &>(*arg));
+    for (const Stmt *stmt : func_decl.Body())
+      Self().Visit(static_cast<const Node &>(*stmt));
+  }
+
+  void Visit(const ArgumentDeclaration &arg_decl) {
+    Self().Visit(static_cast<const Node &>(*arg_decl.ArgType()));
+  }
+
+  void Visit(const Return &ret) {
+    Self().Visit(static_cast<const Node &>(*ret.Value()));
+  }
+
+  void Visit(const ExprStmt &exprstmt) {
+    Self().Visit(static_cast<const Node &>(*exprstmt.Expression()));
+  }
+
+  void Visit(const Call &call) {
+    Self().Visit(static_cast<const Node &>(call.Caller()));
+    for (const Expr *arg : call.Args())
+      Self().Visit(static_cast<const Node &>(*arg));
+  }
+
+  void Visit(const VarDecl &vardecl) {
+    if (vardecl.HasInit())
+      Self().Visit(static_cast<const Node &>(vardecl.Init()));
+  }
+
+  void Visit(const ID &) {}
+  void Visit(const StringLiteral &) {}
+  void Visit(const IntegerLiteral &) {}
+  void Visit(const Typename &) {}
+
+ private:
+  Derived &Self() { return *static_cast<Derived *>(this); }
+};
+
+}  // namespace ast
+}  // namespace lang
+
+#endif
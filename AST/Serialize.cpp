@@ -0,0 +1,575 @@
+#include "Serialize.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "FlatAST.h"
+#include "InlineStack.h"
+
+namespace lang {
+namespace ast {
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'A', 'N', 'G', 'A', 'S', 'T', '\0'};
+
+enum SectionID {
+  SEC_SYMBOL_OFFSETS,  // One past the end of each spelling in SEC_SYMBOL_CHARS.
+  SEC_SYMBOL_CHARS,
+  SEC_FUNCS,
+  SEC_ARGS,
+  SEC_RETURNS,
+  SEC_EXPR_STMTS,
+  SEC_VAR_DECLS,
+  SEC_CALLS,
+  SEC_IDS,
+  SEC_STRS,
+  SEC_INTS,
+  SEC_TYPENAMES,
+  SEC_CHILDREN,
+  SEC_CHARS,
+
+  NUM_SECTIONS,
+};
+
+struct Section {
+  uint64_t Offset;  // From the start of the file. Always a multiple of 8.
+  uint64_t Count;   // In elements, not bytes.
+};
+
+struct FileHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t NumSections;
+  uint64_t SourceHash;
+  Section Sections[NUM_SECTIONS];
+};
+
+// Records with symbols store them as indices into the file's symbol table.
+// The other flat records are written as they are.
+struct DiskFunc {
+  uint32_t Name;
+  NodeRef RetType;
+  ChildRange Args;
+  ChildRange Body;
+  SourceLocation Loc;
+};
+
+struct DiskArg {
+  uint32_t Name;
+  NodeRef Ty;
+  SourceLocation Loc;
+};
+
+struct DiskVarDecl {
+  uint32_t Name;
+  NodeRef Ty;
+  NodeRef Init;
+  SourceLocation Loc;
+};
+
+struct DiskID {
+  uint32_t Name;
+  SourceLocation Loc;
+};
+
+struct DiskTypename {
+  uint32_t Name;
+  SourceLocation Loc;
+};
+
+// FlatInt has trailing padding. It is spelled out here so the bytes written
+// for the same source are always the same.
+struct DiskInt {
+  uint64_t Val;
+  SourceLocation Loc;
+  uint32_t Pad;
+};
+
+static_assert(sizeof(FileHeader) % 8 == 0, "Sections must stay aligned");
+
+uint64_t AlignTo8(uint64_t Offset) { return (Offset + 7) & ~uint64_t(7); }
+
+/**
+ * Gives each symbol used by a module a dense index and collects its spelling.
+ */
+class SymbolTable {
+ public:
+  SymbolTable() : Offsets_(1, 0) {}
+
+  uint32_t Index(Symbol Sym) {
+    auto Found = Indices_.find(Sym.ID());
+    if (Found != Indices_.end()) return Found->second;
+
+    uint32_t Idx = static_cast<uint32_t>(Offsets_.size() - 1);
+    Indices_.emplace(Sym.ID(), Idx);
+    StringRef Spelling = Sym.Str();
+    Chars_.insert(Chars_.end(), Spelling.begin(), Spelling.end());
+    Offsets_.push_back(static_cast<uint32_t>(Chars_.size()));
+    return Idx;
+  }
+
+  const std::vector<uint32_t> &Offsets() const { return Offsets_; }
+  const std::vector<char> &Chars() const { return Chars_; }
+
+ private:
+  std::vector<uint32_t> Offsets_;
+  std::vector<char> Chars_;
+  std::unordered_map<uint32_t, uint32_t> Indices_;
+};
+
+struct SectionData {
+  const void *Data;
+  uint64_t Count;
+  uint64_t EltSize;
+};
+
+template <class T>
+SectionData MakeSection(const std::vector<T> &Vec) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Sections are written byte for byte");
+  return SectionData{Vec.data(), Vec.size(), sizeof(T)};
+}
+
+/**
+ * Views of every section in an AST file. These point into the file's buffer.
+ */
+struct FileArrays {
+  ArrayRef<uint32_t> SymbolOffsets;
+  ArrayRef<char> SymbolChars;
+  ArrayRef<DiskFunc> Funcs;
+  ArrayRef<DiskArg> Args;
+  ArrayRef<FlatReturn> Returns;
+  ArrayRef<FlatExprStmt> ExprStmts;
+  ArrayRef<DiskVarDecl> VarDecls;
+  ArrayRef<FlatCall> Calls;
+  ArrayRef<DiskID> IDs;
+  ArrayRef<FlatStr> Strs;
+  ArrayRef<DiskInt> Ints;
+  ArrayRef<DiskTypename> Typenames;
+  ArrayRef<NodeRef> Children;
+  ArrayRef<char> Chars;
+};
+
+template <class T>
+bool GetSection(const MemoryBuffer &Buf, const FileHeader &Header,
+                SectionID ID, ArrayRef<T> &Arr) {
+  const Section &S = Header.Sections[ID];
+  if (S.Offset % 8 || S.Offset > Buf.Size() ||
+      S.Count > (Buf.Size() - S.Offset) / sizeof(T))
+    return false;
+  Arr = ArrayRef<T>(reinterpret_cast<const T *>(Buf.Begin() + S.Offset),
+                    S.Count);
+  return true;
+}
+
+/**
+ * Builds the pointer tree from the arrays of an AST file.
+ *
+ * FlatBuilder numbers the nodes of each kind in the order it finishes them,
+ * which is the order this finishes them in too, so every reference must be
+ * to the next unused node of its kind. Checking that means a corrupt file
+ * can't make the tree cyclic or share a node between parents.
+ */
+class ModuleInflater {
+ public:
+  ModuleInflater(const FileArrays &File, ASTContext &Ctx)
+      : File_(File), Ctx_(Ctx) {}
+
+  bool Build(ArrayRef<const ExternalDeclaration *> &Decls,
+             ArrayRef<SourceLocation> &DeclLocs);
+
+ private:
+  const FunctionDeclaration *BuildFunc(NodeRef Ref);
+  const ArgumentDeclaration *BuildArg(NodeRef Ref);
+  const Stmt *BuildStmt(NodeRef Ref);
+  const Expr *BuildExpr(NodeRef Ref);
+  const Expr *BuildLeafExpr(NodeRef Ref);
+  const Type *BuildType(NodeRef Ref);
+
+  template <class T>
+  bool BuildList(ChildRange Range, const T *(ModuleInflater::*Build)(NodeRef),
+                 ArrayRef<const T *> &List);
+
+  bool InternSymbols();
+  bool GetSymbol(uint32_t Idx, Symbol &Sym) const {
+    if (Idx >= Syms_.size()) return false;
+    Sym = Syms_[Idx];
+    return true;
+  }
+
+  // Called once all children of the node are built.
+  bool Take(NodeRef Ref) { return Ref.Idx() == Next_[Ref.Kind()]++; }
+
+  template <class T>
+  T *Finish(T *N, SourceLocation Loc) {
+    N->SetLoc(Loc);
+    return N;
+  }
+
+  const FileArrays &File_;
+  ASTContext &Ctx_;
+  std::vector<Symbol> Syms_;
+  uint32_t Next_[1u << NodeRef::kKindBits] = {};
+};
+
+bool ModuleInflater::Build(ArrayRef<const ExternalDeclaration *> &Decls,
+                           ArrayRef<SourceLocation> &DeclLocs) {
+  if (!InternSymbols() || File_.Funcs.Size() > NodeRef::kMaxIdx) return false;
+
+  size_t NumFuncs = File_.Funcs.Size();
+  const ExternalDeclaration **Elems =
+      Ctx_.AllocateArray<const ExternalDeclaration *>(NumFuncs);
+  SourceLocation *Locs = Ctx_.AllocateArray<SourceLocation>(NumFuncs);
+  for (uint32_t i = 0; i < NumFuncs; ++i) {
+    Elems[i] = BuildFunc(NodeRef(FLAT_FUNC, i));
+    if (!Elems[i]) return false;
+    Locs[i] = File_.Funcs[i].Loc;
+  }
+  Decls = ArrayRef<const ExternalDeclaration *>(Elems, NumFuncs);
+  DeclLocs = ArrayRef<SourceLocation>(Locs, NumFuncs);
+
+  // Every node in the file should be reachable from a function.
+  return Next_[FLAT_ARG] == File_.Args.Size() &&
+         Next_[FLAT_RETURN] == File_.Returns.Size() &&
+         Next_[FLAT_EXPR_STMT] == File_.ExprStmts.Size() &&
+         Next_[FLAT_VAR_DECL] == File_.VarDecls.Size() &&
+         Next_[FLAT_CALL] == File_.Calls.Size() &&
+         Next_[FLAT_ID] == File_.IDs.Size() &&
+         Next_[FLAT_STR] == File_.Strs.Size() &&
+         Next_[FLAT_INT] == File_.Ints.Size() &&
+         Next_[FLAT_TYPENAME] == File_.Typenames.Size();
+}
+
+bool ModuleInflater::InternSymbols() {
+  ArrayRef<uint32_t> Offsets = File_.SymbolOffsets;
+  if (Offsets.Empty() || Offsets[0] != 0) return false;
+
+  Syms_.reserve(Offsets.Size() - 1);
+  for (size_t i = 1; i < Offsets.Size(); ++i) {
+    if (Offsets[i] < Offsets[i - 1] || Offsets[i] > File_.SymbolChars.Size())
+      return false;
+    Syms_.push_back(Symbol::Intern(
+        StringRef(File_.SymbolChars.Data() + Offsets[i - 1],
+                  Offsets[i] - Offsets[i - 1])));
+  }
+  return true;
+}
+
+template <class T>
+bool ModuleInflater::BuildList(ChildRange Range,
+                               const T *(ModuleInflater::*Build)(NodeRef),
+                               ArrayRef<const T *> &List) {
+  if (uint64_t(Range.Begin) + Range.Size > File_.Children.Size()) return false;
+
+  const T **Elems = Ctx_.AllocateArray<const T *>(Range.Size);
+  for (uint32_t i = 0; i < Range.Size; ++i) {
+    Elems[i] = (this->*Build)(File_.Children[Range.Begin + i]);
+    if (!Elems[i]) return false;
+  }
+  List = ArrayRef<const T *>(Elems, Range.Size);
+  return true;
+}
+
+const FunctionDeclaration *ModuleInflater::BuildFunc(NodeRef Ref) {
+  const DiskFunc &F = File_.Funcs[Ref.Idx()];
+  Symbol Name;
+  ArrayRef<const ArgumentDeclaration *> Args;
+  ArrayRef<const Stmt *> Body;
+  const Type *RetType = BuildType(F.RetType);
+  if (!RetType || !GetSymbol(F.Name, Name) ||
+      !BuildList(F.Args, &ModuleInflater::BuildArg, Args) ||
+      !BuildList(F.Body, &ModuleInflater::BuildStmt, Body) || !Take(Ref))
+    return nullptr;
+  return Ctx_.Create<FunctionDeclaration>(RetType, Name, Args, Body);
+}
+
+const ArgumentDeclaration *ModuleInflater::BuildArg(NodeRef Ref) {
+  if (Ref.Kind() != FLAT_ARG || Ref.Idx() >= File_.Args.Size()) return nullptr;
+
+  const DiskArg &A = File_.Args[Ref.Idx()];
+  Symbol Name;
+  const Type *Ty = BuildType(A.Ty);
+  if (!Ty || !GetSymbol(A.Name, Name) || !Take(Ref)) return nullptr;
+  return Finish(Ctx_.Create<ArgumentDeclaration>(Ty, Name), A.Loc);
+}
+
+const Stmt *ModuleInflater::BuildStmt(NodeRef Ref) {
+  switch (Ref.Kind()) {
+    case FLAT_RETURN: {
+      if (Ref.Idx() >= File_.Returns.Size()) return nullptr;
+      const FlatReturn &R = File_.Returns[Ref.Idx()];
+      const Expr *Value = BuildExpr(R.Value);
+      if (!Value || !Take(Ref)) return nullptr;
+      return Finish(Ctx_.Create<Return>(Value), R.Loc);
+    }
+    case FLAT_EXPR_STMT: {
+      if (Ref.Idx() >= File_.ExprStmts.Size()) return nullptr;
+      const FlatExprStmt &S = File_.ExprStmts[Ref.Idx()];
+      const Expr *E = BuildExpr(S.E);
+      if (!E || !Take(Ref)) return nullptr;
+      return Finish(Ctx_.Create<ExprStmt>(E), S.Loc);
+    }
+    case FLAT_VAR_DECL: {
+      if (Ref.Idx() >= File_.VarDecls.Size()) return nullptr;
+      const DiskVarDecl &D = File_.VarDecls[Ref.Idx()];
+      Symbol Name;
+      const Type *Ty = BuildType(D.Ty);
+      if (!Ty || !GetSymbol(D.Name, Name)) return nullptr;
+
+      const Expr *Init = nullptr;
+      if (D.Init.Valid() && !(Init = BuildExpr(D.Init))) return nullptr;
+      if (!Take(Ref)) return nullptr;
+      return Finish(Ctx_.Create<VarDecl>(Ty, Name, Init), D.Loc);
+    }
+    default:
+      return nullptr;
+  }
+}
+
+const Expr *ModuleInflater::BuildExpr(NodeRef Ref) {
+  // Calls can nest arbitrarily deep, so they are built with an explicit stack
+  // instead of recursing. Built holds the finished caller and arguments of
+  // every call still on Calls.
+  struct PendingCall {
+    NodeRef Ref;
+    uint32_t NextArg;
+    size_t FirstBuilt;
+  };
+  InlineStack<PendingCall, 4> Calls;
+  InlineStack<const Expr *, 8> Built;
+
+  while (true) {
+    if (Ref.Kind() == FLAT_CALL) {
+      // A call can only be pending once, unless the file has a cycle.
+      if (Ref.Idx() >= File_.Calls.Size() ||
+          Calls.Size() == File_.Calls.Size())
+        return nullptr;
+      const FlatCall &C = File_.Calls[Ref.Idx()];
+      if (uint64_t(C.Args.Begin) + C.Args.Size > File_.Children.Size())
+        return nullptr;
+      Calls.Push({Ref, 0, Built.Size()});
+      Ref = C.Caller;
+      continue;
+    }
+
+    const Expr *E = BuildLeafExpr(Ref);
+    if (!E) return nullptr;
+
+    // Hand E to the innermost pending call, finishing each call that E
+    // completes.
+    while (true) {
+      if (Calls.Empty()) return E;
+      Built.Push(E);
+
+      PendingCall &P = Calls.Back();
+      const FlatCall &C = File_.Calls[P.Ref.Idx()];
+      if (P.NextArg < C.Args.Size) {
+        Ref = File_.Children[C.Args.Begin + P.NextArg++];
+        break;
+      }
+      if (!Take(P.Ref)) return nullptr;
+
+      const Expr *Caller = Built[P.FirstBuilt];
+      const Expr **Args = Ctx_.AllocateArray<const Expr *>(C.Args.Size);
+      std::copy(Built.begin() + P.FirstBuilt + 1, Built.end(), Args);
+      Built.Truncate(P.FirstBuilt);
+      Calls.Pop();
+      E = Finish(Ctx_.Create<Call>(Caller, ArrayRef<const Expr *>(
+                                               Args, C.Args.Size)),
+                 C.Loc);
+    }
+  }
+}
+
+const Expr *ModuleInflater::BuildLeafExpr(NodeRef Ref) {
+  switch (Ref.Kind()) {
+    case FLAT_ID: {
+      if (Ref.Idx() >= File_.IDs.Size()) return nullptr;
+      const DiskID &I = File_.IDs[Ref.Idx()];
+      Symbol Name;
+      if (!GetSymbol(I.Name, Name) || !Take(Ref)) return nullptr;
+      return Finish(Ctx_.Create<ID>(Name), I.Loc);
+    }
+    case FLAT_STR: {
+      if (Ref.Idx() >= File_.Strs.Size()) return nullptr;
+      const FlatStr &S = File_.Strs[Ref.Idx()];
+      if (uint64_t(S.Begin) + S.Size > File_.Chars.Size() || !Take(Ref))
+        return nullptr;
+      StringRef Val =
+          Ctx_.CopyString(StringRef(File_.Chars.Data() + S.Begin, S.Size));
+      return Finish(Ctx_.Create<StringLiteral>(Val), S.Loc);
+    }
+    case FLAT_INT: {
+      if (Ref.Idx() >= File_.Ints.Size() || !Take(Ref)) return nullptr;
+      const DiskInt &I = File_.Ints[Ref.Idx()];
+      return Finish(Ctx_.Create<IntegerLiteral>(I.Val), I.Loc);
+    }
+    default:
+      return nullptr;
+  }
+}
+
+const Type *ModuleInflater::BuildType(NodeRef Ref) {
+  if (Ref.Kind() != FLAT_TYPENAME || Ref.Idx() >= File_.Typenames.Size())
+    return nullptr;
+
+  const DiskTypename &T = File_.Typenames[Ref.Idx()];
+  Symbol Name;
+  if (!GetSymbol(T.Name, Name) || !Take(Ref)) return nullptr;
+  return Finish(Ctx_.Create<Typename>(Name), T.Loc);
+}
+
+}  // namespace
+
+uint64_t HashSource(const MemoryBuffer &Buf) {
+  // FNV-1a
+  uint64_t Hash = 14695981039346656037ull;
+  for (const char *P = Buf.Begin(); P != Buf.End(); ++P) {
+    Hash ^= static_cast<unsigned char>(*P);
+    Hash *= 1099511628211ull;
+  }
+  return Hash;
+}
+
+bool ASTWriter::Write(const Module &Mod, uint64_t SourceHash) {
+  FlatModule Flat = FlatModule::FromModule(Mod);
+  SymbolTable Syms;
+
+  std::vector<DiskFunc> Funcs;
+  Funcs.reserve(Flat.Funcs_.size());
+  for (const FlatFunc &F : Flat.Funcs_)
+    Funcs.push_back(
+        DiskFunc{Syms.Index(F.Name), F.RetType, F.Args, F.Body, F.Loc});
+
+  std::vector<DiskArg> Args;
+  Args.reserve(Flat.Args_.size());
+  for (const FlatArg &A : Flat.Args_)
+    Args.push_back(DiskArg{Syms.Index(A.Name), A.Ty, A.Loc});
+
+  std::vector<DiskVarDecl> VarDecls;
+  VarDecls.reserve(Flat.VarDecls_.size());
+  for (const FlatVarDecl &D : Flat.VarDecls_)
+    VarDecls.push_back(DiskVarDecl{Syms.Index(D.Name), D.Ty, D.Init, D.Loc});
+
+  std::vector<DiskID> IDs;
+  IDs.reserve(Flat.IDs_.size());
+  for (const FlatID &I : Flat.IDs_)
+    IDs.push_back(DiskID{Syms.Index(I.Name), I.Loc});
+
+  std::vector<DiskInt> Ints;
+  Ints.reserve(Flat.Ints_.size());
+  for (const FlatInt &I : Flat.Ints_) Ints.push_back(DiskInt{I.Val, I.Loc, 0});
+
+  std::vector<DiskTypename> Typenames;
+  Typenames.reserve(Flat.Typenames_.size());
+  for (const FlatTypename &T : Flat.Typenames_)
+    Typenames.push_back(DiskTypename{Syms.Index(T.Name), T.Loc});
+
+  SectionData Data[NUM_SECTIONS];
+  Data[SEC_SYMBOL_OFFSETS] = MakeSection(Syms.Offsets());
+  Data[SEC_SYMBOL_CHARS] = MakeSection(Syms.Chars());
+  Data[SEC_FUNCS] = MakeSection(Funcs);
+  Data[SEC_ARGS] = MakeSection(Args);
+  Data[SEC_RETURNS] = MakeSection(Flat.Returns_);
+  Data[SEC_EXPR_STMTS] = MakeSection(Flat.ExprStmts_);
+  Data[SEC_VAR_DECLS] = MakeSection(VarDecls);
+  Data[SEC_CALLS] = MakeSection(Flat.Calls_);
+  Data[SEC_IDS] = MakeSection(IDs);
+  Data[SEC_STRS] = MakeSection(Flat.Strs_);
+  Data[SEC_INTS] = MakeSection(Ints);
+  Data[SEC_TYPENAMES] = MakeSection(Typenames);
+  Data[SEC_CHILDREN] = MakeSection(Flat.Children_);
+  Data[SEC_CHARS] = MakeSection(Flat.Chars_);
+
+  FileHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  memcpy(Header.Magic, kMagic, sizeof(kMagic));
+  Header.Version = kASTFileVersion;
+  Header.NumSections = NUM_SECTIONS;
+  Header.SourceHash = SourceHash;
+
+  uint64_t Offset = sizeof(FileHeader);
+  for (unsigned i = 0; i < NUM_SECTIONS; ++i) {
+    Header.Sections[i] = Section{Offset, Data[i].Count};
+    Offset = AlignTo8(Offset + Data[i].Count * Data[i].EltSize);
+  }
+
+  const char Padding[8] = {};
+  Out_.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+  for (unsigned i = 0; i < NUM_SECTIONS; ++i) {
+    uint64_t Size = Data[i].Count * Data[i].EltSize;
+    Out_.write(static_cast<const char *>(Data[i].Data), Size);
+    Out_.write(Padding, AlignTo8(Size) - Size);
+  }
+  return Out_.good();
+}
+
+std::unique_ptr<Module> ASTReader::Read(uint64_t SourceHash) {
+  Status_ = ASTFILE_BAD_FORMAT;
+  if (Buf_.Size() < sizeof(FileHeader) ||
+      reinterpret_cast<uintptr_t>(Buf_.Begin()) % alignof(FileHeader))
+    return nullptr;
+
+  const FileHeader &Header = *reinterpret_cast<const FileHeader *>(Buf_.Begin());
+  if (memcmp(Header.Magic, kMagic, sizeof(kMagic))) return nullptr;
+  if (Header.Version != kASTFileVersion) {
+    Status_ = ASTFILE_VERSION_MISMATCH;
+    return nullptr;
+  }
+  if (Header.NumSections != NUM_SECTIONS) return nullptr;
+  if (Header.SourceHash != SourceHash) {
+    Status_ = ASTFILE_STALE;
+    return nullptr;
+  }
+
+  FileArrays File;
+  if (!GetSection(Buf_, Header, SEC_SYMBOL_OFFSETS, File.SymbolOffsets) ||
+      !GetSection(Buf_, Header, SEC_SYMBOL_CHARS, File.SymbolChars) ||
+      !GetSection(Buf_, Header, SEC_FUNCS, File.Funcs) ||
+      !GetSection(Buf_, Header, SEC_ARGS, File.Args) ||
+      !GetSection(Buf_, Header, SEC_RETURNS, File.Returns) ||
+      !GetSection(Buf_, Header, SEC_EXPR_STMTS, File.ExprStmts) ||
+      !GetSection(Buf_, Header, SEC_VAR_DECLS, File.VarDecls) ||
+      !GetSection(Buf_, Header, SEC_CALLS, File.Calls) ||
+      !GetSection(Buf_, Header, SEC_IDS, File.IDs) ||
+      !GetSection(Buf_, Header, SEC_STRS, File.Strs) ||
+      !GetSection(Buf_, Header, SEC_INTS, File.Ints) ||
+      !GetSection(Buf_, Header, SEC_TYPENAMES, File.Typenames) ||
+      !GetSection(Buf_, Header, SEC_CHILDREN, File.Children) ||
+      !GetSection(Buf_, Header, SEC_CHARS, File.Chars))
+    return nullptr;
+
+  auto Ctx = std::make_unique<ASTContext>();
+  ArrayRef<const ExternalDeclaration *> Decls;
+  ArrayRef<SourceLocation> DeclLocs;
+  ModuleInflater Inflater(File, *Ctx);
+  if (!Inflater.Build(Decls, DeclLocs)) return nullptr;
+
+  Status_ = ASTFILE_OK;
+  return std::make_unique<Module>(std::move(Ctx), Decls, DeclLocs);
+}
+
+bool ASTReader::DebugOk() const {
+  switch (Status_) {
+    case ASTFILE_OK:
+      return true;
+    case ASTFILE_BAD_FORMAT:
+      std::cerr << "Not a valid AST file" << std::endl;
+      break;
+    case ASTFILE_VERSION_MISMATCH:
+      std::cerr << "AST file is not version " << kASTFileVersion << std::endl;
+      break;
+    case ASTFILE_STALE:
+      std::cerr << "AST file was written for different source" << std::endl;
+      break;
+  }
+  return false;
+}
+
+}  // namespace ast
+}  // namespace lang
@@ -0,0 +1,87 @@
+#ifndef AST_SERIALIZE_H_
+#define AST_SERIALIZE_H_
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "ExternDecl.h"
+#include "MemoryBuffer.h"
+
+namespace lang {
+namespace ast {
+
+/**
+ * Bump this whenever the layout or meaning of an AST file changes. Files
+ * written with a different version are rejected and the source is parsed
+ * again. Version 2 made node locations relative to their function.
+ */
+constexpr uint32_t kASTFileVersion = 2;
+
+/**
+ * The hash an AST file is keyed by. This is the 64-bit FNV-1a hash of every
+ * byte in the source buffer.
+ */
+uint64_t HashSource(const MemoryBuffer &Buf);
+
+/**
+ * Writes a module as a binary AST file.
+ *
+ * The file is a fixed header followed by the arrays of a FlatModule, each
+ * aligned to 8 bytes, so a reader can use them straight out of an mmap'd
+ * buffer. Symbols are written as indices into a table of spellings stored in
+ * the file since symbol ids are only stable within one process. The file uses
+ * the host's byte order and is only meant to be read back on the same
+ * machine.
+ */
+class ASTWriter {
+ public:
+  explicit ASTWriter(std::ostream &Out) : Out_(Out) {}
+
+  /**
+   * Returns false if writing to the stream failed.
+   */
+  bool Write(const Module &Mod, uint64_t SourceHash);
+
+ private:
+  std::ostream &Out_;
+};
+
+enum ASTFileStatus {
+  ASTFILE_OK,
+  ASTFILE_BAD_FORMAT,
+  ASTFILE_VERSION_MISMATCH,
+  ASTFILE_STALE,
+};
+
+/**
+ * Rebuilds a module from a binary AST file written by ASTWriter. Nothing is
+ * copied out of the buffer except the spellings of symbols and the contents
+ * of string literals, so the buffer can be freed once the module is built.
+ */
+class ASTReader {
+ public:
+  explicit ASTReader(const MemoryBuffer &Buf) : Buf_(Buf) {}
+
+  /**
+   * Returns nullptr if the buffer is not a valid AST file of this version, or
+   * if it was written for source with a different hash. Status() tells which.
+   */
+  std::unique_ptr<Module> Read(uint64_t SourceHash);
+
+  ASTFileStatus Status() const { return Status_; }
+
+  /**
+   * Print why the last Read() failed. Returns true if it did not.
+   */
+  bool DebugOk() const;
+
+ private:
+  const MemoryBuffer &Buf_;
+  ASTFileStatus Status_ = ASTFILE_OK;
+};
+
+}  // namespace ast
+}  // namespace lang
+
+#endif
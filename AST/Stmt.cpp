@@ -1,8 +0,0 @@
-#include "Stmt.h"
-
-namespace lang {
-namespace ast {
-
-
-}  // namespace ast
-}  // namespace lang
@@ -8,51 +8,58 @@
 namespace lang {
 namespace ast {
 
-class Stmt : public Node {};
+class Stmt : public Node {
+ public:
+  static bool classof(const Node *N) {
+    return N->Kind() >= NODE_FIRST_STMT && N->Kind() <= NODE_LAST_STMT;
+  }
+
+ protected:
+  explicit Stmt(NodeKind Kind) : Node(Kind) {}
+};
 
 class ExprStmt : public Stmt {
  public:
-  explicit ExprStmt(std::unique_ptr<Expr> E) : E_(std::move(E)) {}
+  explicit ExprStmt(const Expr *E) : Stmt(NODE_EXPR_STMT), E_(E) {}
 
-  const Expr *Expression() const { return E_.get(); }
+  const Expr *Expression() const { return E_; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) { return N->Kind() == NODE_EXPR_STMT; }
 
  private:
-  std::unique_ptr<Expr> E_;
+  const Expr *E_;
 };
 
 class Return : public Stmt {
  public:
-  Return(std::unique_ptr<Expr> RetVal) : RetVal_(std::move(RetVal)) {}
+  Return(const Expr *RetVal) : Stmt(NODE_RETURN), RetVal_(RetVal) {}
 
-  const Expr *Value() const { return RetVal_.get(); }
+  const Expr *Value() const { return RetVal_; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) { return N->Kind() == NODE_RETURN; }
 
  private:
-  std::unique_ptr<Expr> RetVal_;
+  const Expr *RetVal_;
 };
 
 class VarDecl : public Stmt {
  public:
-  VarDecl(std::unique_ptr<Type> type, const std::string &varname,
-          std::unique_ptr<Expr> init)
-      : type_(std::move(type)), varname_(varname), init_(std::move(init)) {}
-  VarDecl(std::unique_ptr<Type> type, const std::string &varname)
-      : type_(std::move(type)), varname_(varname) {}
+  VarDecl(const Type *type, Symbol varname, const Expr *init)
+      : Stmt(NODE_VAR_DECL), type_(type), varname_(varname), init_(init) {}
+  VarDecl(const Type *type, Symbol varname)
+      : Stmt(NODE_VAR_DECL), type_(type), varname_(varname), init_(nullptr) {}
 
-  std::string Name() const { return varname_; }
+  Symbol Name() const { return varname_; }
   const Expr &Init() const { return *init_; }
   const Type &VarType() const { return *type_; }
   bool HasInit() const { return init_ != nullptr; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) { return N->Kind() == NODE_VAR_DECL; }
 
  private:
-  std::unique_ptr<Type> type_;
-  std::string varname_;
-  std::unique_ptr<Expr> init_;
+  const Type *type_;
+  Symbol varname_;
+  const Expr *init_;
 };
 
 }  // namespace ast
@@ -1,25 +1,32 @@
 #ifndef AST_TYPE_H_
 #define AST_TYPE_H_
 
-#include <string>
-
 #include "ASTCommon.h"
+#include "Interner.h"
 
 namespace lang {
 namespace ast {
 
-class Type : public Node {};
+class Type : public Node {
+ public:
+  static bool classof(const Node *N) {
+    return N->Kind() >= NODE_FIRST_TYPE && N->Kind() <= NODE_LAST_TYPE;
+  }
+
+ protected:
+  explicit Type(NodeKind Kind) : Node(Kind) {}
+};
 
 class Typename : public Type {
  public:
-  Typename(const std::string &Name) : Name_(Name) {}
+  Typename(Symbol Name) : Type(NODE_TYPENAME), Name_(Name) {}
 
-  std::string Name() const { return Name_; }
+  Symbol Name() const { return Name_; }
 
-  ACCEPT_VISITORS;
+  static bool classof(const Node *N) { return N->Kind() == NODE_TYPENAME; }
 
  private:
-  std::string Name_;
+  Symbol Name_;
 };
 
 }  // namespace ast
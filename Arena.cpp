@@ -0,0 +1,59 @@
+#include "Arena.h"
+
+namespace lang {
+
+constexpr size_t Arena::kSlabSize;
+
+void *Arena::AllocateSlow(size_t Size, size_t Align) {
+  // Very large allocations get their own slab so they do not waste the rest
+  // of the current one. new[] only guarantees fundamental alignment, so leave
+  // room to align within the slab.
+  size_t Needed = Size + Align - 1;
+  if (Needed > SlabSize_ / 4) {
+    Slabs_.emplace_back(new char[Needed]);
+    BytesAllocated_ += Needed;
+    uintptr_t Begin = reinterpret_cast<uintptr_t>(Slabs_.back().get());
+    return reinterpret_cast<void *>((Begin + Align - 1) &
+                                    ~(uintptr_t(Align) - 1));
+  }
+
+  Slabs_.emplace_back(new char[SlabSize_]);
+  BytesAllocated_ += SlabSize_;
+  Cur_ = Slabs_.back().get();
+  End_ = Cur_ + SlabSize_;
+  return Allocate(Size, Align);
+}
+
+void Arena::Reset() {
+  // The current slab is the last regular sized one that was added. Slabs for
+  // large allocations may come after it.
+  std::unique_ptr<char[]> Keep;
+  for (auto It = Slabs_.rbegin(); Cur_ && It != Slabs_.rend(); ++It) {
+    if (It->get() == End_ - SlabSize_) {
+      Keep = std::move(*It);
+      break;
+    }
+  }
+
+  Slabs_.clear();
+  BytesAllocated_ = 0;
+  Cur_ = End_ = nullptr;
+  if (!Keep) return;
+
+  Cur_ = Keep.get();
+  End_ = Cur_ + SlabSize_;
+  BytesAllocated_ = SlabSize_;
+  Slabs_.push_back(std::move(Keep));
+}
+
+void Arena::Adopt(Arena &Other) {
+  // Keep bumping from our own slab; the adopted ones are only held onto.
+  for (auto &Slab : Other.Slabs_) Slabs_.push_back(std::move(Slab));
+  BytesAllocated_ += Other.BytesAllocated_;
+
+  Other.Slabs_.clear();
+  Other.Cur_ = Other.End_ = nullptr;
+  Other.BytesAllocated_ = 0;
+}
+
+}  // namespace lang
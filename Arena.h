@@ -0,0 +1,74 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lang {
+
+/**
+ * A bump-pointer allocator. Memory is carved out of large slabs and is never
+ * freed one allocation at a time: Reset() releases everything at once so the
+ * arena can be reused, and destroying it frees the slabs, which costs one
+ * delete per slab no matter how many allocations were made. Nothing
+ * allocated here has its destructor run.
+ */
+class Arena {
+ public:
+  Arena() = default;
+
+  /**
+   * An arena whose slabs are SlabSize bytes instead of the default, for
+   * arenas that only ever hold a little.
+   */
+  explicit Arena(size_t SlabSize) : SlabSize_(SlabSize) {}
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *Allocate(size_t Size, size_t Align) {
+    uintptr_t Cur = reinterpret_cast<uintptr_t>(Cur_);
+    uintptr_t Aligned = (Cur + Align - 1) & ~(uintptr_t(Align) - 1);
+    if (Cur_ && Aligned + Size <= reinterpret_cast<uintptr_t>(End_)) {
+      Cur_ = reinterpret_cast<char *>(Aligned + Size);
+      return reinterpret_cast<void *>(Aligned);
+    }
+    return AllocateSlow(Size, Align);
+  }
+
+  /**
+   * Release everything allocated so far. The current slab is kept and reused
+   * so an arena that is reset between batches of work only holds as much
+   * memory as the largest batch needed.
+   */
+  void Reset();
+
+  /**
+   * Take over every slab of Other, which is left empty. Memory allocated in
+   * Other stays where it is and is now freed with this arena.
+   */
+  void Adopt(Arena &Other);
+
+  /**
+   * The total size of every slab allocated so far.
+   */
+  size_t BytesAllocated() const { return BytesAllocated_; }
+  size_t NumSlabs() const { return Slabs_.size(); }
+
+ private:
+  static constexpr size_t kSlabSize = 64 * 1024;
+
+  void *AllocateSlow(size_t Size, size_t Align);
+
+  size_t SlabSize_ = kSlabSize;
+  std::vector<std::unique_ptr<char[]>> Slabs_;
+  char *Cur_ = nullptr;
+  char *End_ = nullptr;
+  size_t BytesAllocated_ = 0;
+};
+
+}  // namespace lang
+
+#endif
@@ -47,6 +47,11 @@ ParsedArgs ArgParser::Parse(const std::vector<std::string> &args) {
     std::string argname = *iter;
     unknown_arg_ = argname;
 
+    // A keyword argument can also carry its value in the same entry, as in
+    // --name=value or -nvalue.
+    bool has_inline_value = false;
+    std::string inline_value;
+
     enum ParsedArgType argtype = GetArgType(argname);
     switch (argtype) {
       case POSITIONAL: {
@@ -74,16 +79,46 @@ ParsedArgs ArgParser::Parse(const std::vector<std::string> &args) {
           return parsed_args;
         }
 
+        if (argname.size() > 2) {
+          has_inline_value = true;
+          inline_value = argname.substr(2);
+        }
         argname = found_argname->second;
         break;
       }
       case KEYWORD: {
         argname = argname.substr(2);
+        size_t eq = argname.find('=');
+        if (eq != std::string::npos) {
+          has_inline_value = true;
+          inline_value = argname.substr(eq + 1);
+          argname = argname.substr(0, eq);
+        }
         break;
       }
     }
     unknown_arg_ = argname;
 
+    if (has_inline_value) {
+      if (parsing_methods_.find(argname) == parsing_methods_.end()) {
+        parse_status_ = UNKNOWN_ARG;
+        return parsed_args;
+      }
+
+      std::vector<std::string> inline_values = {inline_value};
+      auto value_iter = inline_values.cbegin();
+      std::unique_ptr<Argument> parsed_arg =
+          parsing_methods_[argname]->ParseArgument(value_iter);
+      if (!parsed_arg) {
+        parse_status_ = PARSE_ERROR;
+        return parsed_args;
+      }
+
+      parsed_args.SetArg(argname, std::move(parsed_arg));
+      ++iter;
+      continue;
+    }
+
     if (no_storage_args_.find(argname) != no_storage_args_.end()) {
       parsed_args.SetArg(argname, std::make_unique<EmptyArgument>());
       ++iter;
@@ -107,8 +142,8 @@ ParsedArgs ArgParser::Parse(const std::vector<std::string> &args) {
       return parsed_args;
     }
 
+    // The parsing method already moved past the value.
     parsed_args.SetArg(argname, std::move(parsed_arg));
-    ++iter;
   }
 
   parse_status_ = SUCCESS;
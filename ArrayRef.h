@@ -0,0 +1,34 @@
+#ifndef ARRAYREF_H_
+#define ARRAYREF_H_
+
+#include <cstddef>
+
+namespace lang {
+
+/**
+ * A non-owning view of a contiguous array, usually allocated in an Arena.
+ * The underlying elements must outlive the ArrayRef.
+ */
+template <class T>
+class ArrayRef {
+ public:
+  ArrayRef() : Data_(nullptr), Size_(0) {}
+  ArrayRef(const T *Data, size_t Size) : Data_(Data), Size_(Size) {}
+
+  const T *Data() const { return Data_; }
+  size_t Size() const { return Size_; }
+  bool Empty() const { return Size_ == 0; }
+
+  const T *begin() const { return Data_; }
+  const T *end() const { return Data_ + Size_; }
+
+  const T &operator[](size_t i) const { return Data_[i]; }
+
+ private:
+  const T *Data_;
+  size_t Size_;
+};
+
+}  // namespace lang
+
+#endif
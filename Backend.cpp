@@ -0,0 +1,844 @@
+#include "Backend.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ThreadPool.h"
+
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+namespace lang {
+
+namespace {
+
+// How many functions go in each part EmitObjectFileParallel() compiles on
+// its own. The split only depends on the module, never on the number of
+// threads, so the object file does not either.
+const size_t kCodeGenPartFunctions = 256;
+
+// The part each function defined in the module being split goes to.
+using PartMap = std::unordered_map<const llvm::Function *, unsigned>;
+
+// What UsersPart() returns when nothing uses a global, or when more than one
+// part does.
+const int kNoUsers = -2;
+const int kManyParts = -1;
+
+/**
+ * The part every instruction using V is in. Uses outside of any function, as
+ * in another global's initializer, count as more than one part.
+ */
+int UsersPart(const llvm::Value &V, const PartMap &Parts) {
+  int Part = kNoUsers;
+  for (const llvm::User *U : V.users()) {
+    int UserPart = kManyParts;
+    if (const auto *I = llvm::dyn_cast<llvm::Instruction>(U)) {
+      auto Found = Parts.find(I->getFunction());
+      UserPart = Found == Parts.end() ? 0 : Found->second;
+    } else if (llvm::isa<llvm::ConstantExpr>(U)) {
+      UserPart = UsersPart(*U, Parts);
+    }
+    if (UserPart == kNoUsers) continue;
+    if (Part != kNoUsers && UserPart != Part) return kManyParts;
+    Part = UserPart;
+  }
+  return Part;
+}
+
+/**
+ * Whether C is or refers to a global outside of M.
+ */
+bool RefersOutside(const llvm::Constant &C, const llvm::Module &M) {
+  if (const auto *GV = llvm::dyn_cast<llvm::GlobalValue>(&C))
+    return GV->getParent() != &M;
+  for (const llvm::Use &Op : C.operands()) {
+    if (RefersOutside(*llvm::cast<llvm::Constant>(Op), M)) return true;
+  }
+  return false;
+}
+
+/**
+ * Point every reference in Part to a global outside of it at a global of
+ * the same name inside it, declaring one if needed.
+ */
+void DeclareOutsideGlobals(llvm::Module &Part) {
+  llvm::ValueToValueMapTy VMap;
+  auto Declare = [&](const llvm::GlobalValue &GV) -> llvm::GlobalValue * {
+    if (llvm::GlobalValue *Existing = Part.getNamedValue(GV.getName()))
+      return Existing;
+    if (const auto *F = llvm::dyn_cast<llvm::Function>(&GV)) {
+      return llvm::Function::Create(F->getFunctionType(),
+                                    llvm::GlobalValue::ExternalLinkage,
+                                    F->getName(), &Part);
+    }
+    const auto &Var = llvm::cast<llvm::GlobalVariable>(GV);
+    return new llvm::GlobalVariable(
+        Part, Var.getValueType(), Var.isConstant(),
+        llvm::GlobalValue::ExternalLinkage, nullptr, Var.getName());
+  };
+  std::function<void(const llvm::Constant &)> Map =
+      [&](const llvm::Constant &C) {
+        if (const auto *GV = llvm::dyn_cast<llvm::GlobalValue>(&C)) {
+          if (GV->getParent() != &Part && !VMap.count(GV))
+            VMap[GV] = Declare(*GV);
+          return;
+        }
+        for (const llvm::Use &Op : C.operands())
+          Map(*llvm::cast<llvm::Constant>(Op));
+      };
+
+  std::vector<llvm::Instruction *> Refer;
+  for (llvm::Function &F : Part) {
+    for (llvm::Instruction &I : llvm::instructions(F)) {
+      bool RefersToOutside = false;
+      for (const llvm::Use &Op : I.operands()) {
+        const auto *C = llvm::dyn_cast<llvm::Constant>(Op);
+        if (C && RefersOutside(*C, Part)) {
+          Map(*C);
+          RefersToOutside = true;
+        }
+      }
+      if (RefersToOutside) Refer.push_back(&I);
+    }
+  }
+  for (llvm::Instruction *I : Refer)
+    llvm::RemapInstruction(I, VMap, llvm::RF_IgnoreMissingLocals);
+}
+
+/**
+ * Run the linker at Ld to combine the objects at Paths into one relocatable
+ * object at Filename. If it fails, Error says how it exited and what it
+ * wrote to stderr.
+ */
+bool RunLinker(const std::string &Ld, const std::string &Filename,
+               const std::vector<std::string> &Paths, std::string &Error) {
+  std::vector<const char *> Args = {Ld.c_str(), "-r", "-o", Filename.c_str()};
+  for (const std::string &Path : Paths) Args.push_back(Path.c_str());
+  Args.push_back(nullptr);
+
+  int Pipe[2];
+  if (pipe(Pipe) < 0) {
+    Error = std::string("Cannot run ld: ") + strerror(errno);
+    return false;
+  }
+  pid_t Pid = fork();
+  if (Pid < 0) {
+    Error = std::string("Cannot run ld: ") + strerror(errno);
+    close(Pipe[0]);
+    close(Pipe[1]);
+    return false;
+  }
+  if (!Pid) {
+    dup2(Pipe[1], STDERR_FILENO);
+    close(Pipe[0]);
+    close(Pipe[1]);
+    execv(Args[0], const_cast<char *const *>(Args.data()));
+    dprintf(STDERR_FILENO, "%s\n", strerror(errno));
+    _exit(127);
+  }
+  close(Pipe[1]);
+  std::string Stderr;
+  char Buf[4096];
+  ssize_t Read;
+  while ((Read = read(Pipe[0], Buf, sizeof(Buf))) != 0) {
+    if (Read < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    Stderr.append(Buf, Read);
+  }
+  close(Pipe[0]);
+
+  int Status;
+  while (waitpid(Pid, &Status, 0) < 0) {
+    if (errno != EINTR) {
+      Error = std::string("Cannot wait for ld: ") + strerror(errno);
+      return false;
+    }
+  }
+  if (WIFEXITED(Status) && !WEXITSTATUS(Status)) return true;
+
+  Error = Ld + " -r ";
+  if (WIFEXITED(Status))
+    Error += "exited with status " + std::to_string(WEXITSTATUS(Status));
+  else if (WIFSIGNALED(Status))
+    Error += "was killed by signal " + std::to_string(WTERMSIG(Status));
+  else
+    Error += "failed";
+  while (!Stderr.empty() && Stderr.back() == '\n') Stderr.pop_back();
+  if (!Stderr.empty()) Error += ":\n" + Stderr;
+  return false;
+}
+
+/**
+ * Runs a module split into one part per function, compiling each part the
+ * first time one of its functions is called. Every function is called
+ * through an ORC stub that starts out pointing at a compile callback, so the
+ * thread that calls a function compiles it and then points the stub at the
+ * code. Compile threads can also compile parts ahead of the program.
+ *
+ * The parts are kept as bitcode and each one is compiled in a context of its
+ * own, so several parts can be compiled at once. Only linking them into the
+ * process happens one part at a time.
+ */
+class LazyJIT {
+ public:
+  LazyJIT(const TargetSpec &Spec, OptLevel Level)
+      : Spec_(Spec),
+        Level_(Level),
+        Objects_(
+            [] { return std::make_shared<llvm::SectionMemoryManager>(); }) {}
+
+  /**
+   * Split M into parts and put a stub in front of every function it defines.
+   * The first part also keeps every global more than one part uses, so it is
+   * linked right away. Returns false and sets Error on failure.
+   */
+  bool Add(std::unique_ptr<llvm::Module> M, std::string &Error) {
+    std::unique_ptr<llvm::TargetMachine> TM =
+        CreateTargetMachine(Spec_, Level_, Error);
+    if (!TM) return false;
+    DL_ = TM->createDataLayout();
+    llvm::Triple Triple = TM->getTargetTriple();
+    Callbacks_ = llvm::orc::createLocalCompileCallbackManager(Triple, 0);
+    Stubs_ = llvm::orc::createLocalIndirectStubsManagerBuilder(Triple)();
+    FreeTMs_.push_back(std::move(TM));
+
+    size_t NumDefs = 0;
+    for (const llvm::Function &F : *M) {
+      if (!F.isDeclaration()) ++NumDefs;
+    }
+    M->setDataLayout(DL_);
+    std::vector<std::unique_ptr<llvm::Module>> Parts =
+        PartitionModule(std::move(M), NumDefs);
+
+    size_t NumParts = Parts.size();
+    Bitcode_.resize(NumParts);
+    Names_.resize(NumParts);
+    States_.resize(NumParts, PART_PENDING);
+    Errors_.resize(NumParts);
+    Handles_.resize(NumParts);
+    llvm::orc::IndirectStubsManager::StubInitsMap StubInits;
+    for (size_t i = 0; i < NumParts; ++i) {
+      for (const llvm::Function &F : *Parts[i]) {
+        if (F.isDeclaration()) continue;
+        std::string Name = Mangle(F.getName());
+        auto Callback = Callbacks_->getCompileCallback();
+        if (!Callback) {
+          Error = llvm::toString(Callback.takeError());
+          return false;
+        }
+        Callback->setCompileAction(
+            [this, i, Name] { return CompileCalled(i, Name); });
+        StubInits[Name] = std::make_pair(Callback->getAddress(),
+                                         llvm::JITSymbolFlags::Exported);
+        PartOf_[Name] = i;
+        Names_[i].push_back(Name);
+      }
+      llvm::raw_svector_ostream Out(Bitcode_[i]);
+      llvm::WriteBitcodeToFile(Parts[i].get(), Out);
+    }
+    Parts.clear();
+    if (llvm::Error Err = Stubs_->createStubs(StubInits)) {
+      Error = llvm::toString(std::move(Err));
+      return false;
+    }
+
+    Resolver_ = llvm::orc::createLambdaResolver(
+        [this](const std::string &Name) { return FindInJIT(Name); },
+        [](const std::string &Name) {
+          if (llvm::JITTargetAddress Addr =
+                  llvm::RTDyldMemoryManager::getSymbolAddressInProcess(Name))
+            return llvm::JITSymbol(Addr, llvm::JITSymbolFlags::Exported);
+          return llvm::JITSymbol(nullptr);
+        });
+    return NumParts && Materialize(0, Error);
+  }
+
+  /**
+   * Compile the function called Name if it is not yet, and set Addr to where
+   * its code is. Returns false and sets Error if the module does not define
+   * it or it cannot be compiled.
+   */
+  bool FunctionAddress(llvm::StringRef Name, llvm::JITTargetAddress &Addr,
+                       std::string &Error) {
+    std::string Mangled = Mangle(Name);
+    auto Found = PartOf_.find(Mangled);
+    if (Found == PartOf_.end()) {
+      Error = "No " + Name.str() + " function";
+      return false;
+    }
+    if (!Materialize(Found->second, Error)) return false;
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    Addr = Addresses_[Mangled];
+    return true;
+  }
+
+  /**
+   * Queue every part on Pool, in order, to be compiled before the program
+   * calls into it. Parts still queued when Stop() is called are skipped.
+   */
+  void CompileAhead(ThreadPool &Pool) {
+    for (size_t i = 1; i < Bitcode_.size(); ++i) {
+      Pool.Async([this, i] {
+        // A part that fails is reported if the program ever calls into it.
+        std::string Error;
+        if (!Stopped_.load(std::memory_order_relaxed)) Materialize(i, Error);
+      });
+    }
+  }
+
+  void Stop() { Stopped_ = true; }
+
+ private:
+  using Object = llvm::object::OwningBinary<llvm::object::ObjectFile>;
+  using ObjectPtr = std::shared_ptr<Object>;
+  using ObjectLayer = llvm::orc::RTDyldObjectLinkingLayer;
+
+  enum PartState { PART_PENDING, PART_COMPILING, PART_LINKED, PART_FAILED };
+
+  std::string Mangle(llvm::StringRef Name) const {
+    std::string Mangled;
+    llvm::raw_string_ostream Out(Mangled);
+    llvm::Mangler::getNameWithPrefix(Out, Name, DL_);
+    return Out.str();
+  }
+
+  /**
+   * What a stub's compile callback runs the first time the program calls
+   * the function Name in Part.
+   */
+  llvm::JITTargetAddress CompileCalled(size_t Part, const std::string &Name) {
+    std::string Error;
+    if (!Materialize(Part, Error)) {
+      llvm::report_fatal_error(llvm::Twine("Cannot compile ") + Name + ": " +
+                               Error);
+    }
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    return Addresses_[Name];
+  }
+
+  /**
+   * Compile and link Part unless that is already done. If another thread is
+   * compiling it, wait for that instead.
+   */
+  bool Materialize(size_t Part, std::string &Error) {
+    std::unique_lock<std::mutex> Lock(Mutex_);
+    while (States_[Part] == PART_COMPILING) StateChanged_.wait(Lock);
+    if (States_[Part] == PART_LINKED) return true;
+    if (States_[Part] == PART_FAILED) {
+      Error = Errors_[Part];
+      return false;
+    }
+    States_[Part] = PART_COMPILING;
+    std::unique_ptr<llvm::TargetMachine> TM;
+    if (!FreeTMs_.empty()) {
+      TM = std::move(FreeTMs_.back());
+      FreeTMs_.pop_back();
+    }
+    Lock.unlock();
+
+    ObjectPtr Obj;
+    bool Ok = Compile(Part, TM, Obj, Error);
+
+    Lock.lock();
+    if (TM) FreeTMs_.push_back(std::move(TM));
+    if (Ok) Ok = Link(Part, std::move(Obj), Error);
+    States_[Part] = Ok ? PART_LINKED : PART_FAILED;
+    if (!Ok) Errors_[Part] = Error;
+    StateChanged_.notify_all();
+    return Ok;
+  }
+
+  /**
+   * Compile Part to an object with TM, creating TM if there was no free one
+   * to reuse. Runs without the lock.
+   */
+  bool Compile(size_t Part, std::unique_ptr<llvm::TargetMachine> &TM,
+               ObjectPtr &Obj, std::string &Error) {
+    if (!TM) TM = CreateTargetMachine(Spec_, Level_, Error);
+    if (!TM) return false;
+    llvm::LLVMContext Context;
+    llvm::MemoryBufferRef Buf(
+        llvm::StringRef(Bitcode_[Part].data(), Bitcode_[Part].size()),
+        "part");
+    llvm::Expected<std::unique_ptr<llvm::Module>> M =
+        llvm::parseBitcodeFile(Buf, Context);
+    if (!M) {
+      Error = llvm::toString(M.takeError());
+      return false;
+    }
+    llvm::orc::SimpleCompiler Compiler(*TM);
+    Obj = std::make_shared<Object>(Compiler(**M));
+    if (!Obj->getBinary()) {
+      Error = "TargetMachine can't emit an object for the JIT";
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Link the object for Part into the process and point the stubs of its
+   * functions at their code. Runs with the lock held.
+   */
+  bool Link(size_t Part, ObjectPtr Obj, std::string &Error) {
+    auto Handle = Objects_.addObject(std::move(Obj), Resolver_);
+    if (!Handle) {
+      Error = llvm::toString(Handle.takeError());
+      return false;
+    }
+    Handles_[Part] = *Handle;
+    if (llvm::Error Err = Objects_.emitAndFinalize(*Handle)) {
+      Error = llvm::toString(std::move(Err));
+      return false;
+    }
+    for (const std::string &Name : Names_[Part]) {
+      llvm::JITSymbol Sym = Objects_.findSymbolIn(*Handle, Name, false);
+      llvm::Expected<llvm::JITTargetAddress> Addr = Sym.getAddress();
+      if (!Addr) {
+        Error = llvm::toString(Addr.takeError());
+        return false;
+      }
+      Addresses_[Name] = *Addr;
+      if (llvm::Error Err = Stubs_->updatePointer(Name, *Addr)) {
+        Error = llvm::toString(std::move(Err));
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Where a symbol that a part being linked refers to is in the JIT. A
+   * function not compiled yet is called through its stub. Anything else is
+   * a global the first part keeps. Runs with the lock held.
+   */
+  llvm::JITSymbol FindInJIT(const std::string &Name) {
+    auto Found = Addresses_.find(Name);
+    if (Found != Addresses_.end())
+      return llvm::JITSymbol(Found->second, llvm::JITSymbolFlags::Exported);
+    if (PartOf_.count(Name)) return Stubs_->findStub(Name, false);
+    if (States_[0] == PART_LINKED)
+      return Objects_.findSymbolIn(Handles_[0], Name, false);
+    return nullptr;
+  }
+
+  TargetSpec Spec_;
+  OptLevel Level_;
+  llvm::DataLayout DL_{""};
+
+  std::unique_ptr<llvm::orc::JITCompileCallbackManager> Callbacks_;
+  std::unique_ptr<llvm::orc::IndirectStubsManager> Stubs_;
+  std::shared_ptr<llvm::JITSymbolResolver> Resolver_;
+  ObjectLayer Objects_;
+
+  // Each part's bitcode and the mangled names of the functions it defines.
+  // Neither changes once the module is added.
+  std::vector<llvm::SmallVector<char, 0>> Bitcode_;
+  std::vector<std::vector<std::string>> Names_;
+  llvm::StringMap<size_t> PartOf_;
+
+  // Everything below is guarded by Mutex_.
+  std::mutex Mutex_;
+  std::condition_variable StateChanged_;
+  std::vector<PartState> States_;
+  std::vector<std::string> Errors_;
+  std::vector<ObjectLayer::ObjHandleT> Handles_;
+  llvm::StringMap<llvm::JITTargetAddress> Addresses_;
+  std::vector<std::unique_ptr<llvm::TargetMachine>> FreeTMs_;
+
+  std::atomic<bool> Stopped_{false};
+};
+
+}  // namespace
+
+bool OptLevel::Parse(const std::string &Str, OptLevel &Level) {
+  if (Str.size() != 1) return false;
+  if (Str[0] == 's') {
+    Level.Speed = 2;
+    Level.Size = 1;
+    Level.Given = true;
+    return true;
+  }
+  if (Str[0] < '0' || Str[0] > '3') return false;
+  Level.Speed = Str[0] - '0';
+  Level.Size = 0;
+  Level.Given = true;
+  return true;
+}
+
+llvm::CodeGenOpt::Level OptLevel::CodeGenLevel() const {
+  if (!Given) return llvm::CodeGenOpt::Default;
+  switch (Speed) {
+    case 0:
+      return llvm::CodeGenOpt::None;
+    case 1:
+      return llvm::CodeGenOpt::Less;
+    case 2:
+      return llvm::CodeGenOpt::Default;
+    default:
+      return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
+std::unique_ptr<llvm::TargetMachine> CreateTargetMachine(const TargetSpec &Spec,
+                                                         OptLevel Level,
+                                                         std::string &Error) {
+  // Initialize the target registry etc. Only once, since target machines can
+  // be created on several threads at the same time.
+  static std::once_flag Initialized;
+  std::call_once(Initialized, [] {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmParsers();
+    llvm::InitializeAllAsmPrinters();
+  });
+
+  // Fails if we've forgotten to initialise the TargetRegistry or we have a
+  // bogus target triple. An architecture replaces the one in the triple.
+  llvm::Triple TargetTriple(llvm::sys::getDefaultTargetTriple());
+  const llvm::Target *Target =
+      llvm::TargetRegistry::lookupTarget(Spec.Arch, TargetTriple, Error);
+  if (!Target) return nullptr;
+
+  std::string CPU = Spec.CPU;
+  llvm::SubtargetFeatures Features;
+  if (CPU == "native") {
+    CPU = llvm::sys::getHostCPUName().str();
+    llvm::StringMap<bool> HostFeatures;
+    if (llvm::sys::getHostCPUFeatures(HostFeatures)) {
+      for (const auto &Feature : HostFeatures)
+        Features.AddFeature(Feature.first(), Feature.second);
+    }
+  }
+  // Later features win, so these override the host's.
+  llvm::SubtargetFeatures Requested(Spec.Features);
+  for (const std::string &Feature : Requested.getFeatures())
+    Features.AddFeature(Feature);
+
+  llvm::TargetOptions opt;
+  auto RM = llvm::Optional<llvm::Reloc::Model>();
+  if (Spec.PIC) RM = llvm::Reloc::PIC_;
+  return std::unique_ptr<llvm::TargetMachine>(Target->createTargetMachine(
+      TargetTriple.getTriple(), CPU, Features.getString(), opt, RM, llvm::None,
+      Level.CodeGenLevel()));
+}
+
+void OptimizeModule(llvm::Module &M, llvm::TargetMachine &TM, OptLevel Level) {
+  M.setTargetTriple(TM.getTargetTriple().str());
+  M.setDataLayout(TM.createDataLayout());
+
+  // Clang marks every function with the target it was compiled for and
+  // whether it is optimized for size, and some passes only look at the
+  // attributes.
+  std::string CPU = TM.getTargetCPU().str();
+  std::string Features = TM.getTargetFeatureString().str();
+  for (llvm::Function &F : M) {
+    if (F.isDeclaration()) continue;
+    F.addFnAttr("target-cpu", CPU);
+    if (!Features.empty()) F.addFnAttr("target-features", Features);
+    if (Level.Size) F.addFnAttr(llvm::Attribute::OptimizeForSize);
+  }
+
+  llvm::PassManagerBuilder Builder;
+  Builder.OptLevel = Level.Speed;
+  Builder.SizeLevel = Level.Size;
+  if (Level.Speed > 1) {
+    Builder.Inliner = llvm::createFunctionInliningPass(
+        Level.Speed, Level.Size, /*DisableInlineHotCallSite=*/false);
+  } else {
+    Builder.Inliner = llvm::createAlwaysInlinerLegacyPass();
+  }
+  Builder.LoopVectorize = Level.Speed > 1;
+  Builder.SLPVectorize = Level.Speed > 1;
+  // The builder takes ownership.
+  Builder.LibraryInfo =
+      new llvm::TargetLibraryInfoImpl(llvm::Triple(M.getTargetTriple()));
+  TM.adjustPassManager(Builder);
+
+  llvm::legacy::FunctionPassManager FPM(&M);
+  FPM.add(
+      llvm::createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
+  Builder.populateFunctionPassManager(FPM);
+
+  llvm::legacy::PassManager MPM;
+  MPM.add(
+      llvm::createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
+  Builder.populateModulePassManager(MPM);
+
+  FPM.doInitialization();
+  for (llvm::Function &F : M) FPM.run(F);
+  FPM.doFinalization();
+  MPM.run(M);
+}
+
+bool EmitObjectFile(llvm::Module &M, llvm::TargetMachine &TM,
+                    llvm::raw_pwrite_stream &Out) {
+  llvm::legacy::PassManager pass;
+  auto FileType = llvm::TargetMachine::CGFT_ObjectFile;
+  if (TM.addPassesToEmitFile(pass, Out, FileType)) return false;
+
+  pass.run(M);
+  Out.flush();
+  return true;
+}
+
+bool EmitObjectFileParallel(std::unique_ptr<llvm::Module> M,
+                            const TargetSpec &Spec, OptLevel Level,
+                            unsigned NumThreads, const std::string &Filename,
+                            std::string &Error) {
+  auto Write = [&Error](const llvm::SmallVectorImpl<char> &Object,
+                        llvm::raw_fd_ostream &Out) {
+    Out.write(Object.data(), Object.size());
+    Out.close();
+    if (Out.has_error()) {
+      Error = "Could not write object file";
+      Out.clear_error();
+      return false;
+    }
+    return true;
+  };
+
+  size_t NumDefs = 0;
+  for (const llvm::Function &F : *M) {
+    if (!F.isDeclaration()) ++NumDefs;
+  }
+  size_t NumParts =
+      (NumDefs + kCodeGenPartFunctions - 1) / kCodeGenPartFunctions;
+
+  // A module that fits in one part is compiled whole on this thread, with no
+  // bitcode round trip and no ld, however many threads there are.
+  if (NumParts <= 1) {
+    std::unique_ptr<llvm::TargetMachine> TM =
+        CreateTargetMachine(Spec, Level, Error);
+    if (!TM) return false;
+    OptimizeModule(*M, *TM, Level);
+    llvm::SmallVector<char, 0> Object;
+    llvm::raw_svector_ostream ObjectOut(Object);
+    if (!EmitObjectFile(*M, *TM, ObjectOut)) {
+      Error = "TargetMachine can't emit a file of this type";
+      return false;
+    }
+    std::error_code EC;
+    llvm::raw_fd_ostream Out(Filename, EC, llvm::sys::fs::F_None);
+    if (EC) {
+      Error = EC.message();
+      return false;
+    }
+    return Write(Object, Out);
+  }
+
+  // Find ld before doing any of the work that needs it.
+  llvm::ErrorOr<std::string> Ld = llvm::sys::findProgramByName("ld");
+  if (!Ld) {
+    Error = "Cannot find ld to combine the object files: " +
+            Ld.getError().message();
+    return false;
+  }
+
+  // An LLVMContext can only be used by one thread at a time, so each part
+  // goes to its thread as bitcode and is read back into a context of its own.
+  std::vector<std::unique_ptr<llvm::Module>> Parts =
+      PartitionModule(std::move(M), NumParts);
+  std::vector<llvm::SmallVector<char, 0>> Bitcode(Parts.size());
+  for (size_t i = 0; i < Parts.size(); ++i) {
+    llvm::raw_svector_ostream Out(Bitcode[i]);
+    llvm::WriteBitcodeToFile(Parts[i].get(), Out);
+  }
+  Parts.clear();
+
+  std::vector<llvm::SmallVector<char, 0>> Objects(Bitcode.size());
+  std::vector<std::string> Errors(Bitcode.size());
+  {
+    ThreadPool Pool(std::max(1u, std::min<unsigned>(NumThreads, NumParts)));
+    for (size_t i = 0; i < Bitcode.size(); ++i) {
+      Pool.Async([&, i] {
+        llvm::LLVMContext Context;
+        llvm::MemoryBufferRef Buf(
+            llvm::StringRef(Bitcode[i].data(), Bitcode[i].size()), "part");
+        llvm::Expected<std::unique_ptr<llvm::Module>> Part =
+            llvm::parseBitcodeFile(Buf, Context);
+        if (!Part) {
+          Errors[i] = llvm::toString(Part.takeError());
+          return;
+        }
+        std::unique_ptr<llvm::TargetMachine> TM =
+            CreateTargetMachine(Spec, Level, Errors[i]);
+        if (!TM) return;
+        OptimizeModule(**Part, *TM, Level);
+        llvm::raw_svector_ostream Out(Objects[i]);
+        if (!EmitObjectFile(**Part, *TM, Out))
+          Errors[i] = "TargetMachine can't emit a file of this type";
+      });
+    }
+  }
+  for (const std::string &PartError : Errors) {
+    if (!PartError.empty()) {
+      Error = PartError;
+      return false;
+    }
+  }
+
+  // ld -r joins the parts into one relocatable object, in the order given.
+  std::vector<std::string> Paths;
+  bool Ok = true;
+  for (const llvm::SmallVectorImpl<char> &Object : Objects) {
+    int FD;
+    llvm::SmallString<128> Path;
+    std::error_code EC =
+        llvm::sys::fs::createTemporaryFile("part", "o", FD, Path);
+    if (EC) {
+      Error = EC.message();
+      Ok = false;
+      break;
+    }
+    Paths.push_back(Path.str().str());
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    if (!Write(Object, Out)) {
+      Ok = false;
+      break;
+    }
+  }
+  if (Ok) Ok = RunLinker(*Ld, Filename, Paths, Error);
+  for (const std::string &Path : Paths) llvm::sys::fs::remove(Path);
+  return Ok;
+}
+
+std::vector<std::unique_ptr<llvm::Module>> PartitionModule(
+    std::unique_ptr<llvm::Module> M, unsigned NumParts) {
+  std::vector<llvm::Function *> Defs;
+  for (llvm::Function &F : *M) {
+    if (!F.isDeclaration()) Defs.push_back(&F);
+  }
+  NumParts = std::max<size_t>(1, std::min<size_t>(NumParts, Defs.size()));
+  PartMap PartOf;
+  for (size_t i = 0; i < Defs.size(); ++i)
+    PartOf[Defs[i]] = i * NumParts / Defs.size();
+
+  std::vector<std::unique_ptr<llvm::Module>> Parts;
+  Parts.push_back(std::move(M));
+  llvm::Module &First = *Parts[0];
+  for (unsigned i = 1; i < NumParts; ++i) {
+    Parts.emplace_back(new llvm::Module(
+        First.getModuleIdentifier() + "." + std::to_string(i),
+        First.getContext()));
+    Parts[i]->setTargetTriple(First.getTargetTriple());
+    Parts[i]->setDataLayout(First.getDataLayout());
+  }
+
+  // A local global used from another part than its own has to be visible to
+  // that part. Its new name ends in a hash of what the module defines, like
+  // ThinLTO's promoted locals, so it cannot clash with one from another
+  // module when their objects are linked together.
+  std::string ModuleID = llvm::getUniqueModuleId(&First);
+  auto ExposeTo = [&ModuleID](llvm::GlobalValue &GV, int UsersPart,
+                              int Part) {
+    if (!GV.hasLocalLinkage() || UsersPart == kNoUsers || UsersPart == Part)
+      return;
+    GV.setLinkage(llvm::GlobalValue::ExternalLinkage);
+    GV.setVisibility(llvm::GlobalValue::HiddenVisibility);
+    std::string Name = GV.hasName() ? GV.getName().str() : "__part_global";
+    GV.setName(Name + ModuleID);
+  };
+
+  // A variable only one part uses moves to that part, unless its initializer
+  // would then refer to another part. Everything else stays in the first.
+  std::vector<std::pair<llvm::GlobalVariable *, int>> Vars;
+  for (llvm::GlobalVariable &Var : First.globals()) {
+    int Users = UsersPart(Var, PartOf);
+    int Part = Users > 0 ? Users : 0;
+    if (Part && Var.hasInitializer() &&
+        RefersOutside(*Var.getInitializer(), *Parts[Part]))
+      Part = 0;
+    ExposeTo(Var, Users, Part);
+    Vars.emplace_back(&Var, Part);
+  }
+  for (const auto &VarPart : Vars) {
+    if (!VarPart.second) continue;
+    VarPart.first->removeFromParent();
+    Parts[VarPart.second]->getGlobalList().push_back(VarPart.first);
+  }
+
+  for (llvm::Function *F : Defs) {
+    unsigned Part = PartOf[F];
+    ExposeTo(*F, UsersPart(*F, PartOf), Part);
+    if (Part == 0) continue;
+    // Callers left behind call a declaration instead.
+    llvm::Function *Decl =
+        llvm::Function::Create(F->getFunctionType(),
+                               llvm::GlobalValue::ExternalLinkage, "", &First);
+    F->replaceAllUsesWith(Decl);
+    F->removeFromParent();
+    Parts[Part]->getFunctionList().push_back(F);
+    Decl->setName(F->getName());
+  }
+
+  for (std::unique_ptr<llvm::Module> &Part : Parts)
+    DeclareOutsideGlobals(*Part);
+  return Parts;
+}
+
+bool RunMain(std::unique_ptr<llvm::Module> M, const TargetSpec &Spec,
+             OptLevel Level, unsigned NumThreads, int &ExitCode,
+             std::string &Error) {
+  // Let the JIT look up printf and the rest of libc in this process.
+  llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+
+  LazyJIT JIT(Spec, Level);
+  if (!JIT.Add(std::move(M), Error)) return false;
+  llvm::JITTargetAddress Main;
+  if (!JIT.FunctionAddress("main", Main, Error)) return false;
+
+  // The pool is destroyed before the JIT, once the parts it is compiling are
+  // done.
+  std::unique_ptr<ThreadPool> Pool;
+  if (NumThreads) {
+    Pool.reset(new ThreadPool(NumThreads));
+    JIT.CompileAhead(*Pool);
+  }
+  ExitCode = reinterpret_cast<int (*)()>(static_cast<uintptr_t>(Main))();
+  JIT.Stop();
+  return true;
+}
+
+}  // namespace lang
@@ -0,0 +1,126 @@
+#ifndef BACKEND_H_
+#define BACKEND_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace lang {
+
+/**
+ * How hard to optimize, as picked with -O0 to -O3 or -Os.
+ */
+struct OptLevel {
+  // 0 to 3.
+  unsigned Speed = 0;
+  // 1 for -Os, which optimizes like -O2 but gives up speed for size.
+  unsigned Size = 0;
+  // Whether a level was picked at all. Without one the IR is not optimized,
+  // but the code generator still runs at its default level.
+  bool Given = false;
+
+  /**
+   * Parse the value given to -O: 0, 1, 2, 3 or s. Returns false for anything
+   * else.
+   */
+  static bool Parse(const std::string &Str, OptLevel &Level);
+
+  /**
+   * The code generator level for Speed, or CodeGenOpt::Default if no level
+   * was given.
+   */
+  llvm::CodeGenOpt::Level CodeGenLevel() const;
+};
+
+/**
+ * Which machine to generate code for, as picked with --march, --mcpu and
+ * --mattr.
+ */
+struct TargetSpec {
+  // An architecture name like x86-64, or empty for the host's.
+  std::string Arch;
+  // A CPU name, or native for the CPU this runs on along with every feature
+  // it has.
+  std::string CPU = "generic";
+  // Comma separated features to turn on or off on top of the CPU's, as in
+  // +avx2,-fma.
+  std::string Features;
+  // Generate position independent code. The JIT needs it since it can put
+  // code and data anywhere in memory.
+  bool PIC = false;
+};
+
+/**
+ * Create a target machine that generates code for Spec at the given level.
+ * Returns nullptr and sets Error if the target is not available.
+ */
+std::unique_ptr<llvm::TargetMachine> CreateTargetMachine(const TargetSpec &Spec,
+                                                         OptLevel Level,
+                                                         std::string &Error);
+
+/**
+ * Run the standard LLVM function and module pass pipelines for the level over
+ * the module, tuned for the target it will be emitted for. Every function is
+ * also given the target's CPU and features as attributes, which is what the
+ * optimizer and vectorizers check before using an instruction. Like clang, -O0
+ * and -O1 only inline functions that must be, and higher levels use the
+ * inliner threshold for the level.
+ */
+void OptimizeModule(llvm::Module &M, llvm::TargetMachine &TM, OptLevel Level);
+
+/**
+ * Write the module to Out as an object file. Returns false if the target
+ * cannot emit object files.
+ */
+bool EmitObjectFile(llvm::Module &M, llvm::TargetMachine &TM,
+                    llvm::raw_pwrite_stream &Out);
+
+/**
+ * Optimize the module for the level and write it to Filename as an object
+ * file, using NumThreads threads. A large module is split into parts of a
+ * fixed number of functions, each of which is optimized and compiled on one
+ * of the threads in its own LLVMContext, and the objects are combined with
+ * ld -r. A module that fits in one part is compiled whole and ld is not
+ * needed. How the module is split does not depend on NumThreads, so neither
+ * does the output. Returns false and sets Error on failure, including how ld
+ * exited and what it printed if it fails.
+ */
+bool EmitObjectFileParallel(std::unique_ptr<llvm::Module> M,
+                            const TargetSpec &Spec, OptLevel Level,
+                            unsigned NumThreads, const std::string &Filename,
+                            std::string &Error);
+
+/**
+ * Move the functions M defines into up to NumParts modules in the same
+ * context, each with about as many functions as the others. Global variables
+ * go with the only part that uses them, or stay in the first. Each part
+ * declares what it uses from the others, so the parts can be compiled on
+ * their own and linked back together.
+ */
+std::vector<std::unique_ptr<llvm::Module>> PartitionModule(
+    std::unique_ptr<llvm::Module> M, unsigned NumParts);
+
+/**
+ * Compile the module in this process for Spec at the given level and call
+ * its main, setting ExitCode to what it returns. Library functions like
+ * printf are found in this process. Spec must ask for position independent
+ * code. Returns false and sets Error if the module cannot be compiled or has
+ * no main.
+ *
+ * Each function is compiled the first time it is called, on the thread that
+ * calls it, so a program only pays for the functions it runs. With
+ * NumThreads above 0, that many threads also compile the other functions
+ * while the program runs, so calls find them ready.
+ */
+bool RunMain(std::unique_ptr<llvm::Module> M, const TargetSpec &Spec,
+             OptLevel Level, unsigned NumThreads, int &ExitCode,
+             std::string &Error);
+
+}  // namespace lang
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef CASTING_H_
+#define CASTING_H_
+
+#include <cassert>
+
+namespace lang {
+
+/**
+ * LLVM style RTTI. A class opts in by defining
+ *
+ *   static bool classof(const Base *B);
+ *
+ * which returns true if B is an instance of that class.
+ */
+template <class To, class From>
+bool isa(const From *Val) {
+  assert(Val && "isa<> used on a null pointer");
+  return To::classof(Val);
+}
+
+template <class To, class From>
+bool isa(From *Val) {
+  return isa<To>(static_cast<const From *>(Val));
+}
+
+template <class To, class From>
+bool isa(const From &Val) {
+  return To::classof(&Val);
+}
+
+template <class To, class From>
+To *cast(From *Val) {
+  assert(isa<To>(Val) && "cast<> argument of incompatible type");
+  return static_cast<To *>(Val);
+}
+
+template <class To, class From>
+const To *cast(const From *Val) {
+  assert(isa<To>(Val) && "cast<> argument of incompatible type");
+  return static_cast<const To *>(Val);
+}
+
+template <class To, class From>
+const To &cast(const From &Val) {
+  assert(isa<To>(Val) && "cast<> argument of incompatible type");
+  return static_cast<const To &>(Val);
+}
+
+/**
+ * Returns nullptr instead of asserting if the value is not a To.
+ */
+template <class To, class From>
+To *dyn_cast(From *Val) {
+  return isa<To>(Val) ? static_cast<To *>(Val) : nullptr;
+}
+
+template <class To, class From>
+const To *dyn_cast(const From *Val) {
+  return isa<To>(Val) ? static_cast<const To *>(Val) : nullptr;
+}
+
+}  // namespace lang
+
+#endif
@@ -0,0 +1,290 @@
+#include "CharScan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LANG_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace lang {
+
+namespace {
+
+typedef const char *(*ScanFunc)(const char *, const char *);
+typedef void (*NewlineFunc)(const char *, const char *,
+                            std::vector<uint32_t> &);
+
+struct ScanKernels {
+  ScanFunc SkipWhitespace;
+  ScanFunc SkipIdentChars;
+  ScanFunc SkipDigits;
+  ScanFunc FindQuoteOrBackslash;
+  NewlineFunc FindNewlines;
+};
+
+/********** Scalar **********/
+
+template <uint8_t Class>
+const char *SkipClassScalar(const char *Ptr, const char *End) {
+  while (Ptr != End && CharClasses.Is(*Ptr, Class)) ++Ptr;
+  return Ptr;
+}
+
+const char *FindQuoteOrBackslashScalar(const char *Ptr, const char *End) {
+  while (Ptr != End && *Ptr != '"' && *Ptr != '\\') ++Ptr;
+  return Ptr;
+}
+
+/**
+ * Offsets are relative to Base so the vector kernels can hand off their tail
+ * without adjusting anything.
+ */
+void FindNewlinesFrom(const char *Base, const char *Ptr, const char *End,
+                      std::vector<uint32_t> &Offsets) {
+  for (; Ptr != End; ++Ptr)
+    if (*Ptr == '\n') Offsets.push_back(Ptr - Base);
+}
+
+void FindNewlinesScalar(const char *Begin, const char *End,
+                        std::vector<uint32_t> &Offsets) {
+  FindNewlinesFrom(Begin, Begin, End, Offsets);
+}
+
+constexpr ScanKernels ScalarKernels = {
+    SkipClassScalar<CC_SPACE>,
+    SkipClassScalar<CC_IDENT>,
+    SkipClassScalar<CC_DIGIT>,
+    FindQuoteOrBackslashScalar,
+    FindNewlinesScalar,
+};
+
+#ifdef LANG_SCAN_X86
+
+/**
+ * The vector kernels classify a whole vector at a time with unsigned range
+ * checks that encode the same classes as CharClassTable. A byte X is in
+ * [Lo, Lo + Len] iff min(X - Lo, Len) == X - Lo with wrapping subtraction.
+ * The kernels return a bitmask with a bit set for every byte that does NOT
+ * match, so the end of a run is the lowest set bit. Anything shorter than a
+ * vector falls back to the scalar loop so we never read past End.
+ */
+
+/********** SSE2 **********/
+
+inline __m128i InRange128(__m128i V, char Lo, char Len) {
+  __m128i T = _mm_sub_epi8(V, _mm_set1_epi8(Lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(T, _mm_set1_epi8(Len)), T);
+}
+
+struct SpaceSSE2 {
+  static __m128i Match(__m128i V) {
+    return _mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8(' ')),
+                        InRange128(V, '\t', '\r' - '\t'));
+  }
+};
+
+struct DigitSSE2 {
+  static __m128i Match(__m128i V) { return InRange128(V, '0', 9); }
+};
+
+struct IdentSSE2 {
+  static __m128i Match(__m128i V) {
+    __m128i Lower = _mm_or_si128(V, _mm_set1_epi8(0x20));
+    return _mm_or_si128(InRange128(V, '0', 9), InRange128(Lower, 'a', 25));
+  }
+};
+
+struct QuoteOrBackslashSSE2 {
+  // Inverted so that quotes and backslashes are what end the run.
+  static __m128i Match(__m128i V) {
+    __m128i Special = _mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8('"')),
+                                   _mm_cmpeq_epi8(V, _mm_set1_epi8('\\')));
+    return _mm_xor_si128(Special, _mm_set1_epi8(-1));
+  }
+};
+
+template <class Matcher, ScanFunc Scalar>
+const char *SkipSSE2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+    unsigned Mask = ~_mm_movemask_epi8(Matcher::Match(V)) & 0xFFFF;
+    if (Mask) return Ptr + __builtin_ctz(Mask);
+  }
+  return Scalar(Ptr, End);
+}
+
+/**
+ * Newlines are sparse, so each vector is a single compare and most of them
+ * produce an empty mask.
+ */
+void FindNewlinesSSE2(const char *Begin, const char *End,
+                      std::vector<uint32_t> &Offsets) {
+  const char *Ptr = Begin;
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+    unsigned Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(V, _mm_set1_epi8('\n')));
+    for (; Mask; Mask &= Mask - 1)
+      Offsets.push_back(Ptr - Begin + __builtin_ctz(Mask));
+  }
+  FindNewlinesFrom(Begin, Ptr, End, Offsets);
+}
+
+constexpr ScanKernels SSE2Kernels = {
+    SkipSSE2<SpaceSSE2, SkipClassScalar<CC_SPACE>>,
+    SkipSSE2<IdentSSE2, SkipClassScalar<CC_IDENT>>,
+    SkipSSE2<DigitSSE2, SkipClassScalar<CC_DIGIT>>,
+    SkipSSE2<QuoteOrBackslashSSE2, FindQuoteOrBackslashScalar>,
+    FindNewlinesSSE2,
+};
+
+/********** AVX2 **********/
+
+#define LANG_AVX2 __attribute__((target("avx2")))
+
+LANG_AVX2 inline __m256i InRange256(__m256i V, char Lo, char Len) {
+  __m256i T = _mm256_sub_epi8(V, _mm256_set1_epi8(Lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(T, _mm256_set1_epi8(Len)), T);
+}
+
+struct SpaceAVX2 {
+  LANG_AVX2 static __m256i Match(__m256i V) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(V, _mm256_set1_epi8(' ')),
+                           InRange256(V, '\t', '\r' - '\t'));
+  }
+};
+
+struct DigitAVX2 {
+  LANG_AVX2 static __m256i Match(__m256i V) { return InRange256(V, '0', 9); }
+};
+
+struct IdentAVX2 {
+  LANG_AVX2 static __m256i Match(__m256i V) {
+    __m256i Lower = _mm256_or_si256(V, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(InRange256(V, '0', 9), InRange256(Lower, 'a', 25));
+  }
+};
+
+struct QuoteOrBackslashAVX2 {
+  LANG_AVX2 static __m256i Match(__m256i V) {
+    __m256i Special =
+        _mm256_or_si256(_mm256_cmpeq_epi8(V, _mm256_set1_epi8('"')),
+                        _mm256_cmpeq_epi8(V, _mm256_set1_epi8('\\')));
+    return _mm256_xor_si256(Special, _mm256_set1_epi8(-1));
+  }
+};
+
+template <class Matcher, ScanFunc Tail>
+LANG_AVX2 const char *SkipAVX2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Ptr));
+    unsigned Mask =
+        ~static_cast<unsigned>(_mm256_movemask_epi8(Matcher::Match(V)));
+    if (Mask) return Ptr + __builtin_ctz(Mask);
+  }
+  return Tail(Ptr, End);
+}
+
+LANG_AVX2 void FindNewlinesAVX2(const char *Begin, const char *End,
+                                std::vector<uint32_t> &Offsets) {
+  const char *Ptr = Begin;
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Ptr));
+    unsigned Mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(V, _mm256_set1_epi8('\n'))));
+    for (; Mask; Mask &= Mask - 1)
+      Offsets.push_back(Ptr - Begin + __builtin_ctz(Mask));
+  }
+  FindNewlinesFrom(Begin, Ptr, End, Offsets);
+}
+
+constexpr ScanKernels AVX2Kernels = {
+    SkipAVX2<SpaceAVX2, SkipSSE2<SpaceSSE2, SkipClassScalar<CC_SPACE>>>,
+    SkipAVX2<IdentAVX2, SkipSSE2<IdentSSE2, SkipClassScalar<CC_IDENT>>>,
+    SkipAVX2<DigitAVX2, SkipSSE2<DigitSSE2, SkipClassScalar<CC_DIGIT>>>,
+    SkipAVX2<QuoteOrBackslashAVX2,
+             SkipSSE2<QuoteOrBackslashSSE2, FindQuoteOrBackslashScalar>>,
+    FindNewlinesAVX2,
+};
+
+#undef LANG_AVX2
+
+#endif  // LANG_SCAN_X86
+
+bool HostSupports(ScanImpl Impl) {
+#ifdef LANG_SCAN_X86
+  // This can run from a static initializer before the CPU model is set up.
+  __builtin_cpu_init();
+#endif
+  switch (Impl) {
+    case SCAN_SCALAR:
+      return true;
+#ifdef LANG_SCAN_X86
+    case SCAN_SSE2:
+      return __builtin_cpu_supports("sse2");
+    case SCAN_AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+const ScanKernels &KernelsFor(ScanImpl Impl) {
+  switch (Impl) {
+#ifdef LANG_SCAN_X86
+    case SCAN_AVX2:
+      return AVX2Kernels;
+    case SCAN_SSE2:
+      return SSE2Kernels;
+#endif
+    default:
+      return ScalarKernels;
+  }
+}
+
+ScanImpl DetectScanImpl() {
+  if (HostSupports(SCAN_AVX2)) return SCAN_AVX2;
+  if (HostSupports(SCAN_SSE2)) return SCAN_SSE2;
+  return SCAN_SCALAR;
+}
+
+// These are constant initialized so scanning is safe from other static
+// initializers. The best kernels for the host are selected during dynamic
+// initialization below.
+ScanImpl CurrentImpl = SCAN_SCALAR;
+const ScanKernels *Kernels = &ScalarKernels;
+
+}  // namespace
+
+const char *SkipWhitespace(const char *Ptr, const char *End) {
+  return Kernels->SkipWhitespace(Ptr, End);
+}
+
+const char *SkipIdentChars(const char *Ptr, const char *End) {
+  return Kernels->SkipIdentChars(Ptr, End);
+}
+
+const char *SkipDigits(const char *Ptr, const char *End) {
+  return Kernels->SkipDigits(Ptr, End);
+}
+
+const char *FindQuoteOrBackslash(const char *Ptr, const char *End) {
+  return Kernels->FindQuoteOrBackslash(Ptr, End);
+}
+
+void FindNewlines(const char *Begin, const char *End,
+                  std::vector<uint32_t> &Offsets) {
+  Kernels->FindNewlines(Begin, End, Offsets);
+}
+
+ScanImpl GetScanImpl() { return CurrentImpl; }
+
+bool SetScanImpl(ScanImpl Impl) {
+  if (!HostSupports(Impl)) return false;
+  CurrentImpl = Impl;
+  Kernels = &KernelsFor(Impl);
+  return true;
+}
+
+static const bool HostKernelsSelected = SetScanImpl(DetectScanImpl());
+
+}  // namespace lang
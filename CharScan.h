@@ -0,0 +1,80 @@
+#ifndef CHARSCAN_H_
+#define CHARSCAN_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace lang {
+
+enum CharClass : uint8_t {
+  CC_SPACE = 1 << 0,
+  CC_DIGIT = 1 << 1,
+  CC_ALPHA = 1 << 2,
+  CC_IDENT = CC_ALPHA | CC_DIGIT,
+};
+
+/**
+ * Character class table for every byte. This matches the "C" locale
+ * isspace(), isdigit() and isalpha() so bytes outside of ASCII have no class.
+ */
+struct CharClassTable {
+  constexpr CharClassTable() : Classes() {
+    for (unsigned C = 0; C < 256; ++C) {
+      if (C == ' ' || (C >= '\t' && C <= '\r'))
+        Classes[C] = CC_SPACE;
+      else if (C >= '0' && C <= '9')
+        Classes[C] = CC_DIGIT;
+      else if ((C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z'))
+        Classes[C] = CC_ALPHA;
+    }
+  }
+
+  bool Is(char C, uint8_t Class) const {
+    return Classes[static_cast<unsigned char>(C)] & Class;
+  }
+
+  uint8_t Classes[256];
+};
+
+constexpr CharClassTable CharClasses;
+
+/**
+ * Each of these returns a pointer to the first character in [Ptr, End) that
+ * does not belong to the run being skipped, or End if every character does.
+ * They dispatch at runtime to an AVX2, SSE2 or scalar kernel depending on what
+ * the host CPU supports.
+ */
+const char *SkipWhitespace(const char *Ptr, const char *End);
+const char *SkipIdentChars(const char *Ptr, const char *End);
+const char *SkipDigits(const char *Ptr, const char *End);
+
+/**
+ * Returns a pointer to the first '"' or '\\' in [Ptr, End), or End if there is
+ * none.
+ */
+const char *FindQuoteOrBackslash(const char *Ptr, const char *End);
+
+/**
+ * Append the offset from Begin of every '\n' in [Begin, End) to Offsets in a
+ * single pass.
+ */
+void FindNewlines(const char *Begin, const char *End,
+                  std::vector<uint32_t> &Offsets);
+
+enum ScanImpl {
+  SCAN_SCALAR,
+  SCAN_SSE2,
+  SCAN_AVX2,
+};
+
+/**
+ * The implementation chosen for this host. This can be overridden to compare
+ * kernels in tests and benchmarks. Returns false if the host does not support
+ * the requested implementation.
+ */
+ScanImpl GetScanImpl();
+bool SetScanImpl(ScanImpl Impl);
+
+}  // namespace lang
+
+#endif
@@ -1,29 +1,32 @@
 #include "CodeGen.h"
 
+#include "InlineStack.h"
+
 namespace lang {
 
 void CodeGen::Visit(const ast::Module &Mod) {
-  for (const auto &extern_decl : Mod.ExternDecls()) extern_decl->accept(*this);
+  for (const auto &extern_decl : Mod.ExternDecls()) Visit(*extern_decl);
 }
 
 void CodeGen::Visit(const ast::FunctionDeclaration &FuncDecl) {
-  const std::string &FuncName = FuncDecl.Name();
+  StringRef Name = FuncDecl.Name().Str();
+  llvm::StringRef FuncName(Name.Data(), Name.Size());
 
   // TODO: Function arguments
   llvm::FunctionType *funcType =
       llvm::FunctionType::get(CreateType(*FuncDecl.ReturnType()), false);
 
   llvm::Function *func = llvm::Function::Create(
-      funcType, llvm::Function::ExternalLinkage, FuncName, &Module_);
+      funcType, llvm::Function::ExternalLinkage, FuncName, Module_.get());
   auto *entry =
-      llvm::BasicBlock::Create(GlobalContext, FuncName + "_func", func);
+      llvm::BasicBlock::Create(Context_, FuncName + "_func", func);
   Builder_.SetInsertPoint(entry);
 
-  for (const auto &stmt : FuncDecl.Body()) stmt->accept(*this);
+  for (const auto &stmt : FuncDecl.Body()) Visit(*stmt);
 }
 
 void CodeGen::Visit(const ast::ExprStmt &exprstmt) {
-  exprstmt.Expression()->accept(*this);
+  Visit(*exprstmt.Expression());
 }
 
 void CodeGen::Visit(const ast::Return &retstmt) {
@@ -31,8 +34,7 @@ void CodeGen::Visit(const ast::Return &retstmt) {
 }
 
 void CodeGen::Visit(const ast::ID &id) {
-  const std::string Name = id.Name();
-  if (Name == "printf") {
+  if (id.Name() == SYM_PRINTF) {
     SetReturnVal(PrintfFunc_);
   } else {
     ASSERT(0 && "Unknown variable");
@@ -40,11 +42,41 @@ void CodeGen::Visit(const ast::ID &id) {
 }
 
 void CodeGen::Visit(const ast::Call &call) {
-  std::vector<llvm::Value *> Args;
-  for (const auto &Arg : call.Args()) {
-    Args.push_back(CreateValue(*Arg));
+  // Lower nested calls with an explicit stack instead of recursing, so deep
+  // nesting cannot overflow the C++ stack. Each pending call remembers where
+  // its lowered arguments start in Args.
+  struct Pending {
+    const ast::Call *C;
+    size_t NextArg;
+    size_t FirstArg;
+  };
+  InlineStack<Pending, 4> Stack;
+  InlineStack<llvm::Value *, 8> Args;
+  Stack.Push({&call, 0, 0});
+
+  while (true) {
+    Pending &Top = Stack.Back();
+    if (Top.NextArg < Top.C->Args().Size()) {
+      const ast::Expr *Arg = Top.C->Args()[Top.NextArg++];
+      if (const auto *Inner = dyn_cast<ast::Call>(Arg))
+        Stack.Push({Inner, 0, Args.Size()});
+      else
+        Args.Push(CreateValue(*Arg));
+      continue;
+    }
+
+    llvm::ArrayRef<llvm::Value *> CallArgs(Args.Data() + Top.FirstArg,
+                                           Args.Size() - Top.FirstArg);
+    llvm::Value *Result =
+        Builder_.CreateCall(CreateValue(Top.C->Caller()), CallArgs);
+    Args.Truncate(Top.FirstArg);
+    Stack.Pop();
+    if (Stack.Empty()) {
+      SetReturnVal(Result);
+      return;
+    }
+    Args.Push(Result);
   }
-  SetReturnVal(Builder_.CreateCall(CreateValue(call.Caller()), Args));
 }
 
 void CodeGen::Visit(const ast::StringLiteral &str) {
@@ -52,15 +84,14 @@ void CodeGen::Visit(const ast::StringLiteral &str) {
 }
 
 void CodeGen::Visit(const ast::IntegerLiteral &intexpr) {
-  SetReturnVal(llvm::ConstantInt::get(llvm::Type::getInt32Ty(GlobalContext),
+  SetReturnVal(llvm::ConstantInt::get(llvm::Type::getInt32Ty(Context_),
                                       intexpr.Value()));
 }
 
 llvm::Type *CodeGen::CreateType(const ast::Type &Ty) {
   // TODO: Other types
-  const auto &type = dynamic_cast<const ast::Typename &>(Ty);
-  const std::string &Name = type.Name();
-  if (Name == "int") {
+  const auto &type = cast<ast::Typename>(Ty);
+  if (type.Name() == SYM_INT) {
     return Builder_.getInt32Ty();
   } else {
     ASSERT(0 && "Unknown typename");
@@ -74,7 +105,7 @@ llvm::Constant *CodeGen::CreatePrintfFunc() {
   llvm::FunctionType *PrintfType =
       llvm::FunctionType::get(Builder_.getInt32Ty(), argsRef,
                               /*isVarArg=*/true);
-  return Module_.getOrInsertFunction("printf", PrintfType);
+  return Module_->getOrInsertFunction("printf", PrintfType);
 }
 
 }  // namespace lang
@@ -2,7 +2,7 @@
 #define CODEGEN_H_
 
 #include "AST/ExternDecl.h"
-#include "AST/Visitor.h"
+#include "AST/RecursiveASTVisitor.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
@@ -23,40 +23,51 @@
     }                                                               \
   }
 
-// TODO: Move this out of a header
-static llvm::LLVMContext GlobalContext;
-
 namespace lang {
 
-// TODO: Actually use the ast::Visitor methods
-class CodeGen : public virtual ast::Visitor {
+/**
+ * Lowers an AST into a new module in Context. Only one thread can use a
+ * context at a time, so compilations running in parallel each need their
+ * own. The context has to outlive the module.
+ */
+class CodeGen : public ast::RecursiveASTVisitor<CodeGen> {
  public:
-  CodeGen(const std::string &ModuleID)
-      : Module_(ModuleID, GlobalContext), Builder_(GlobalContext) {
-    Module_.setTargetTriple(llvm::sys::getDefaultTargetTriple());
+  CodeGen(const std::string &ModuleID, llvm::LLVMContext &Context)
+      : Context_(Context),
+        Module_(new llvm::Module(ModuleID, Context)),
+        Builder_(Context) {
+    Module_->setTargetTriple(llvm::sys::getDefaultTargetTriple());
     PrintfFunc_ = CreatePrintfFunc();
   }
 
-  void Visit(const ast::Module &Mod) override;
-  void Visit(const ast::FunctionDeclaration &FuncDecl) override;
-  void Visit(const ast::ExprStmt &exprstmt) override;
-  void Visit(const ast::Return &retstmt) override;
+  using ast::RecursiveASTVisitor<CodeGen>::Visit;
+
+  void Visit(const ast::Module &Mod);
+  void Visit(const ast::FunctionDeclaration &FuncDecl);
+  void Visit(const ast::ExprStmt &exprstmt);
+  void Visit(const ast::Return &retstmt);
 
-  void Visit(const ast::ID &id) override;
-  void Visit(const ast::Call &call) override;
-  void Visit(const ast::StringLiteral &str) override;
-  void Visit(const ast::IntegerLiteral &intexpr) override;
+  void Visit(const ast::ID &id);
+  void Visit(const ast::Call &call);
+  void Visit(const ast::StringLiteral &str);
+  void Visit(const ast::IntegerLiteral &intexpr);
 
   llvm::Type *CreateType(const ast::Type &Ty);
 
-  llvm::Module &Module() { return Module_; }
+  llvm::Module &Module() { return *Module_; }
+
+  /**
+   * Take ownership of the module, as the JIT needs to. Nothing else can be
+   * lowered afterwards.
+   */
+  std::unique_ptr<llvm::Module> ReleaseModule() { return std::move(Module_); }
 
  private:
   // TODO: Come up with a better way to return a new value on visiting an
   // expression for some visitors
   template <class ExprTy>
   llvm::Value *CreateValue(const ExprTy &E) {
-    E.accept(*this);
+    Visit(E);
     ASSERT(return_val_ &&
            "Expected visitor to call SetReturnVal() with a valid llvm::Value "
            "when visiting expression");
@@ -71,7 +82,8 @@ class CodeGen : public virtual ast::Visitor {
 
   llvm::Value *return_val_ = nullptr;
 
-  llvm::Module Module_;
+  llvm::LLVMContext &Context_;
+  std::unique_ptr<llvm::Module> Module_;
   llvm::IRBuilder<> Builder_;
 
   llvm::Constant *PrintfFunc_;
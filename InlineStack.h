@@ -0,0 +1,75 @@
+#ifndef INLINESTACK_H_
+#define INLINESTACK_H_
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace lang {
+
+/**
+ * A stack that keeps its first N elements inline and only allocates once it
+ * grows past them. The explicit worklists that replace recursion over the
+ * AST are almost always a few entries deep, so they cost no allocations
+ * unless something really is deeply nested.
+ */
+template <class T, size_t N>
+class InlineStack {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "InlineStack copies elements between its inline and heap "
+                "storage with plain assignment");
+
+ public:
+  InlineStack() = default;
+  InlineStack(const InlineStack &) = delete;
+  InlineStack &operator=(const InlineStack &) = delete;
+
+  bool Empty() const { return Size_ == 0; }
+  size_t Size() const { return Size_; }
+
+  T *Data() { return OnHeap_ ? Heap_.data() : Inline_; }
+  const T *Data() const { return OnHeap_ ? Heap_.data() : Inline_; }
+  T *begin() { return Data(); }
+  T *end() { return Data() + Size_; }
+  const T *begin() const { return Data(); }
+  const T *end() const { return Data() + Size_; }
+
+  T &operator[](size_t i) { return Data()[i]; }
+  const T &operator[](size_t i) const { return Data()[i]; }
+  T &Back() { return Data()[Size_ - 1]; }
+
+  void Push(const T &Val) {
+    if (!OnHeap_) {
+      if (Size_ < N) {
+        Inline_[Size_++] = Val;
+        return;
+      }
+      Heap_.assign(Inline_, Inline_ + Size_);
+      OnHeap_ = true;
+    }
+    Heap_.push_back(Val);
+    ++Size_;
+  }
+
+  void Pop() { Truncate(Size_ - 1); }
+
+  /**
+   * Drop every element from NewSize on.
+   */
+  void Truncate(size_t NewSize) {
+    assert(NewSize <= Size_);
+    if (OnHeap_) Heap_.resize(NewSize);
+    Size_ = NewSize;
+  }
+
+ private:
+  T Inline_[N];
+  std::vector<T> Heap_;
+  size_t Size_ = 0;
+  bool OnHeap_ = false;
+};
+
+}  // namespace lang
+
+#endif
@@ -0,0 +1,120 @@
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+#include "Interner.h"
+
+namespace lang {
+
+namespace {
+
+constexpr size_t kInitialBuckets = 1024;
+
+// FNV-1a
+uint32_t Hash(StringRef Str) {
+  uint32_t Hash = 2166136261u;
+  for (char C : Str) {
+    Hash ^= static_cast<unsigned char>(C);
+    Hash *= 16777619u;
+  }
+  return Hash;
+}
+
+}  // namespace
+
+Interner &Interner::Global() {
+  static Interner Global;
+  return Global;
+}
+
+Interner::Interner() {
+  for (Shard &S : Shards_) S.Buckets.resize(kInitialBuckets / kNumShards);
+
+  const char *WellKnown[] = {"", "int", "char", "printf"};
+  static_assert(sizeof(WellKnown) / sizeof(WellKnown[0]) ==
+                    NUM_WELL_KNOWN_SYMBOLS,
+                "Every well known symbol needs a spelling");
+  for (const char *Spelling : WellKnown) Intern(Spelling);
+}
+
+Interner::~Interner() {
+  for (std::atomic<StringRef *> &Chunk : Chunks_) delete[] Chunk.load();
+}
+
+Symbol Interner::Intern(StringRef Spelling) {
+  uint32_t SpellingHash = Hash(Spelling);
+  // The low bits pick the bucket, so pick the shard with the high ones.
+  Shard &S = Shards_[SpellingHash >> (32 - kShardBits)];
+  std::lock_guard<std::mutex> Lock(S.Mutex);
+  size_t Mask = S.Buckets.size() - 1;
+  size_t i = SpellingHash & Mask;
+  for (; S.Buckets[i].IDPlusOne; i = (i + 1) & Mask) {
+    uint32_t ID = S.Buckets[i].IDPlusOne - 1;
+    if (S.Buckets[i].Hash == SpellingHash &&
+        this->Spelling(Symbol(ID)) == Spelling)
+      return Symbol(ID);
+  }
+
+  assert(NextID_.load() < std::numeric_limits<uint32_t>::max() &&
+         "Ran out of symbol ids");
+  uint32_t ID = NextID_.fetch_add(1, std::memory_order_relaxed);
+  // Any other thread can only get hold of ID after this, either from this
+  // thread or by finding it in the bucket under the shard's lock.
+  SpellingSlot(ID) = Save(S, Spelling);
+  S.Buckets[i] = {SpellingHash, ID + 1};
+
+  // Keep the table at most half full so probe sequences stay short.
+  if (++S.Size * 2 > S.Buckets.size()) S.Grow();
+  return Symbol(ID);
+}
+
+void Interner::Shard::Grow() {
+  std::vector<Bucket> NewBuckets(Buckets.size() * 2);
+  size_t Mask = NewBuckets.size() - 1;
+  for (const Bucket &B : Buckets) {
+    if (!B.IDPlusOne) continue;
+    size_t i = B.Hash & Mask;
+    while (NewBuckets[i].IDPlusOne) i = (i + 1) & Mask;
+    NewBuckets[i] = B;
+  }
+  Buckets.swap(NewBuckets);
+}
+
+StringRef Interner::Spelling(Symbol Sym) const {
+  assert(Sym.ID() < Size() && "Symbol was not interned");
+  uint32_t Offset;
+  unsigned Chunk = ChunkOf(Sym.ID(), Offset);
+  return Chunks_[Chunk].load(std::memory_order_acquire)[Offset];
+}
+
+unsigned Interner::ChunkOf(uint32_t ID, uint32_t &Offset) {
+  unsigned Chunk = 31 - __builtin_clz((ID >> kFirstChunkBits) + 1);
+  Offset = ID - (((1u << Chunk) - 1) << kFirstChunkBits);
+  return Chunk;
+}
+
+StringRef &Interner::SpellingSlot(uint32_t ID) {
+  uint32_t Offset;
+  unsigned Chunk = ChunkOf(ID, Offset);
+  StringRef *Spellings = Chunks_[Chunk].load(std::memory_order_acquire);
+  if (!Spellings) {
+    std::lock_guard<std::mutex> Lock(ChunkMutex_);
+    Spellings = Chunks_[Chunk].load(std::memory_order_relaxed);
+    if (!Spellings) {
+      Spellings = new StringRef[size_t(1) << (kFirstChunkBits + Chunk)];
+      Chunks_[Chunk].store(Spellings, std::memory_order_release);
+    }
+  }
+  return Spellings[Offset];
+}
+
+StringRef Interner::Save(Shard &S, StringRef Spelling) {
+  size_t Size = Spelling.Size();
+  if (!Size) return StringRef("", 0);
+
+  char *Dst = static_cast<char *>(S.Storage.Allocate(Size, 1));
+  memcpy(Dst, Spelling.Data(), Size);
+  return StringRef(Dst, Size);
+}
+
+}  // namespace lang
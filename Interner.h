@@ -0,0 +1,159 @@
+#ifndef INTERNER_H_
+#define INTERNER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "Arena.h"
+#include "StringRef.h"
+
+namespace lang {
+
+/**
+ * Symbols that are always interned with these ids, so they can be compared
+ * against without looking anything up.
+ */
+enum WellKnownSymbol : uint32_t {
+  SYM_EMPTY = 0,
+  SYM_INT,
+  SYM_CHAR,
+  SYM_PRINTF,
+
+  NUM_WELL_KNOWN_SYMBOLS,
+};
+
+/**
+ * A 32-bit id for a spelling in the global Interner. Every distinct spelling
+ * gets exactly one id that stays the same for the lifetime of the process, so
+ * two symbols are equal only if their spellings are equal. The default symbol
+ * is the empty string.
+ */
+class Symbol {
+ public:
+  Symbol() : ID_(SYM_EMPTY) {}
+  Symbol(WellKnownSymbol ID) : ID_(ID) {}
+
+  /**
+   * Return the symbol for a spelling, adding it to the global interner if
+   * this is the first time it is seen.
+   */
+  static Symbol Intern(StringRef Spelling);
+
+  uint32_t ID() const { return ID_; }
+  bool Empty() const { return ID_ == SYM_EMPTY; }
+
+  /**
+   * The characters of this symbol. These are owned by the interner and are
+   * never freed.
+   */
+  StringRef Str() const;
+
+  bool operator==(Symbol Other) const { return ID_ == Other.ID_; }
+  bool operator!=(Symbol Other) const { return ID_ != Other.ID_; }
+
+ private:
+  friend class Interner;
+  explicit Symbol(uint32_t ID) : ID_(ID) {}
+
+  uint32_t ID_;
+};
+
+inline std::ostream &operator<<(std::ostream &out, Symbol Sym) {
+  return out << Sym.Str();
+}
+
+/**
+ * The table mapping spellings to symbols. There is only one for the whole
+ * process so symbols from different lexers, parsers and threads can be
+ * compared directly. All methods are thread-safe.
+ *
+ * The table is split into shards by hash, each with its own lock, so threads
+ * interning different spellings rarely wait on each other. Looking up the
+ * spelling of a symbol takes no lock at all, because a spelling never changes
+ * once its symbol has been handed out.
+ */
+class Interner {
+ public:
+  static Interner &Global();
+
+  ~Interner();
+
+  Symbol Intern(StringRef Spelling);
+  StringRef Spelling(Symbol Sym) const;
+
+  /**
+   * The number of distinct spellings interned so far, including the well
+   * known ones.
+   */
+  size_t Size() const { return NextID_.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr unsigned kShardBits = 4;
+  static constexpr unsigned kNumShards = 1u << kShardBits;
+
+  // Spellings are indexed by symbol id in chunks that double in size, so the
+  // table can grow without ever moving an entry a reader might be looking at.
+  static constexpr unsigned kFirstChunkBits = 10;
+  static constexpr unsigned kNumChunks = 32 - kFirstChunkBits + 1;
+
+  // An open addressed hash table with linear probing. Each bucket holds the
+  // hash of its spelling and a symbol id plus one, or zero if it is empty.
+  struct Bucket {
+    uint32_t Hash;
+    uint32_t IDPlusOne;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex Mutex;
+    std::vector<Bucket> Buckets;
+    size_t Size = 0;
+
+    // Spellings are packed into an arena so most symbols do not need their
+    // own allocation.
+    Arena Storage;
+
+    /**
+     * Double the number of buckets and reinsert every symbol.
+     */
+    void Grow();
+  };
+
+  Interner();
+
+  /**
+   * Copy the characters into storage owned by the shard.
+   */
+  static StringRef Save(Shard &S, StringRef Spelling);
+
+  /**
+   * The chunk holding the spelling of a symbol id, and where in it.
+   */
+  static unsigned ChunkOf(uint32_t ID, uint32_t &Offset);
+
+  /**
+   * Where the spelling of a symbol id is kept, allocating its chunk if no
+   * symbol in it was interned yet.
+   */
+  StringRef &SpellingSlot(uint32_t ID);
+
+  Shard Shards_[kNumShards];
+  std::atomic<uint32_t> NextID_{0};
+
+  std::mutex ChunkMutex_;
+  std::atomic<StringRef *> Chunks_[kNumChunks] = {};
+};
+
+inline Symbol Symbol::Intern(StringRef Spelling) {
+  return Interner::Global().Intern(Spelling);
+}
+
+inline StringRef Symbol::Str() const {
+  return Interner::Global().Spelling(*this);
+}
+
+}  // namespace lang
+
+#endif
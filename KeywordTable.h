@@ -0,0 +1,139 @@
+#ifndef KEYWORDTABLE_H_
+#define KEYWORDTABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "StringRef.h"
+
+namespace lang {
+
+template <class ValueT>
+struct KeywordEntry {
+  const char *Spelling;
+  ValueT Value;
+};
+
+/**
+ * A perfect hash table from keyword spellings to values that is built at
+ * compile time. The hash only looks at the length and the first and last
+ * characters of a string, and the constructor searches for a multiplier that
+ * puts every keyword in its own slot. A lookup is then one hash and at most
+ * one string compare no matter how many keywords there are.
+ *
+ * Tables should be declared constexpr and checked with
+ * static_assert(Table.Valid()) so adding a keyword that cannot be hashed
+ * without a collision fails the build instead of misbehaving at runtime. Two
+ * keywords with the same length, first and last character can never be told
+ * apart by the hash.
+ */
+template <class ValueT, size_t NumKeywords>
+class KeywordTable {
+ public:
+  constexpr KeywordTable(const KeywordEntry<ValueT> (&Keywords)[NumKeywords],
+                         ValueT NotFound)
+      : NotFound_(NotFound), Multiplier_(0) {
+    for (Slot &S : Slots_) S.Value = NotFound;
+
+    // Try odd multipliers from a simple LCG until every keyword lands in its
+    // own slot. Multiplier_ stays 0 if none do.
+    uint32_t Candidate = 0x9E3779B1u;
+    for (unsigned Try = 0; Try < kMaxTries; ++Try) {
+      if (IsPerfect(Keywords, Candidate)) {
+        Multiplier_ = Candidate;
+        break;
+      }
+      Candidate = (Candidate * 1664525u + 1013904223u) | 1;
+    }
+    if (!Multiplier_) return;
+
+    for (const KeywordEntry<ValueT> &Keyword : Keywords) {
+      size_t Len = Strlen(Keyword.Spelling);
+      Slot &S = Slots_[Hash(Multiplier_, Keyword.Spelling, Len)];
+      S.Spelling = Keyword.Spelling;
+      S.Len = Len;
+      S.Value = Keyword.Value;
+    }
+  }
+
+  /**
+   * Returns false if no multiplier could be found that hashes every keyword
+   * without a collision, or if a keyword was empty or repeated.
+   */
+  constexpr bool Valid() const { return Multiplier_ != 0; }
+
+  ValueT Lookup(StringRef Str) const {
+    if (Str.Empty()) return NotFound_;
+    const Slot &S = Slots_[Hash(Multiplier_, Str.Data(), Str.Size())];
+    if (S.Len == Str.Size() && !memcmp(S.Spelling, Str.Data(), S.Len))
+      return S.Value;
+    return NotFound_;
+  }
+
+ private:
+  // Keep the table at most a quarter full so a perfect multiplier is quick to
+  // find.
+  static constexpr unsigned BitsFor(size_t N) {
+    unsigned Bits = 1;
+    while ((size_t(1) << Bits) < N * 4) ++Bits;
+    return Bits;
+  }
+
+  static constexpr unsigned kBits = BitsFor(NumKeywords);
+  static constexpr size_t kNumSlots = size_t(1) << kBits;
+  static constexpr unsigned kMaxTries = 1000;
+
+  struct Slot {
+    const char *Spelling = "";
+    size_t Len = 0;
+    ValueT Value = ValueT();
+  };
+
+  static constexpr size_t Strlen(const char *Str) {
+    size_t Len = 0;
+    while (Str[Len]) ++Len;
+    return Len;
+  }
+
+  static constexpr uint32_t Hash(uint32_t Multiplier, const char *Str,
+                                 size_t Len) {
+    uint32_t Key = (static_cast<uint32_t>(Len) << 16) |
+                   (static_cast<uint32_t>(static_cast<unsigned char>(Str[0]))
+                    << 8) |
+                   static_cast<unsigned char>(Str[Len - 1]);
+    return (Key * Multiplier) >> (32 - kBits);
+  }
+
+  static constexpr bool IsPerfect(
+      const KeywordEntry<ValueT> (&Keywords)[NumKeywords],
+      uint32_t Multiplier) {
+    bool Used[kNumSlots] = {};
+    for (const KeywordEntry<ValueT> &Keyword : Keywords) {
+      size_t Len = Strlen(Keyword.Spelling);
+      if (!Len) return false;
+      uint32_t H = Hash(Multiplier, Keyword.Spelling, Len);
+      if (Used[H]) return false;
+      Used[H] = true;
+    }
+    return true;
+  }
+
+  ValueT NotFound_;
+  uint32_t Multiplier_;
+  Slot Slots_[kNumSlots];
+};
+
+/**
+ * Class template arguments cannot be deduced from the constructor before
+ * C++17, so tables are made through this.
+ */
+template <class ValueT, size_t NumKeywords>
+constexpr KeywordTable<ValueT, NumKeywords> MakeKeywordTable(
+    const KeywordEntry<ValueT> (&Keywords)[NumKeywords], ValueT NotFound) {
+  return KeywordTable<ValueT, NumKeywords>(Keywords, NotFound);
+}
+
+}  // namespace lang
+
+#endif
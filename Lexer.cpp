@@ -1,22 +1,91 @@
 #include <cassert>
+#include <limits>
 
+#include "CharScan.h"
+#include "KeywordTable.h"
 #include "Lexer.h"
 
 namespace lang {
+
+static constexpr KeywordEntry<enum TokenKind> KeywordList[] = {
+    {"return", TOK_RETURN},
+};
+
+static constexpr auto Keywords = MakeKeywordTable(KeywordList, TOK_UNKNOWN);
+static_assert(Keywords.Valid(), "Keywords cannot be perfectly hashed");
+
+/**
+ * Returns the keyword kind of an identifier or TOK_UNKNOWN if it is not a
+ * keyword.
+ */
+static enum TokenKind TokenKindFromStr(StringRef Keyword) {
+  return Keywords.Lookup(Keyword);
+}
+
 /**
- * NOTE: This function assumes the argument passed is an alphanumeric string.
+ * Returns the kind of a single character token or TOK_UNKNOWN if the
+ * character does not start one.
  */
-static enum TokenKind TokenKindFromStr(const std::string &Keyword) {
-  if (Keyword == "return") return TOK_RETURN;
-  return TOK_UNKNOWN;
+static enum TokenKind PunctuationKindFromChar(int C) {
+  switch (C) {
+    case ';':
+      return TOK_SEMICOL;
+    case ':':
+      return TOK_COL;
+    case ',':
+      return TOK_COMMA;
+    case '(':
+      return TOK_LPAR;
+    case ')':
+      return TOK_RPAR;
+    case '"':
+      return TOK_DQUOTE;
+    case '{':
+      return TOK_LBRACE;
+    case '}':
+      return TOK_RBRACE;
+    case '=':
+      return TOK_ASSIGN;
+    default:
+      return TOK_UNKNOWN;
+  }
+}
+
+void Token::dump(std::ostream &out, const Lexer &Lex) const {
+  LineCol Loc = Lex.Location(*this);
+  out << "<" << Kind << " " << Loc.Row << ":" << Loc.Col << " '";
+  if (Kind == TOK_EOF)
+    out << "EOF";
+  else
+    out << Lex.Text(*this);
+  out << "'>";
 }
 
-static void SetTokenEOF(Token &Tok) {
-  Tok.Chars.clear();
-  Tok.Chars += EOF;
-  Tok.Kind = TOK_EOF;
+Lexer::Lexer(std::istream &Input) : OwnedBuf_(MemoryBuffer::FromStream(Input)) {
+  Init(*OwnedBuf_);
 }
 
+Lexer::Lexer(const MemoryBuffer &Buf, FileID File) : File_(File) { Init(Buf); }
+
+Lexer::Lexer(const MemoryBuffer &Buf, FileID File, uint32_t Begin,
+             uint32_t End)
+    : File_(File) {
+  Init(Buf);
+  assert(Begin <= End && End <= Buf.Size() && "Invalid lexing range");
+  BufCur_ = BufBegin_ + Begin;
+  BufEnd_ = BufBegin_ + End;
+}
+
+void Lexer::Init(const MemoryBuffer &Buf) {
+  assert(Buf.Size() <= std::numeric_limits<uint32_t>::max() &&
+         "Token offsets are only 32 bits");
+  Buf_ = &Buf;
+  BufBegin_ = BufCur_ = Buf.Begin();
+  BufEnd_ = Buf.End();
+}
+
+void Lexer::ExhaustWhitespace() { BufCur_ = SkipWhitespace(BufCur_, BufEnd_); }
+
 bool Lexer::ReadToken(Token &Tok) {
   if (HasBufferedTok_) {
     HasBufferedTok_ = false;
@@ -24,131 +93,67 @@ bool Lexer::ReadToken(Token &Tok) {
     return true;
   }
 
-  // Early EOF detection
-  Tok.Row = Row();
-  Tok.Col = Col();
-  if (Input_.eof() && !Input_.fail()) {
-    SetTokenEOF(Tok);
-    return true;
-  }
+  ExhaustWhitespace();
 
-  int C;
-  while (SafePeek(C) && isspace(C)) ReadCharAndUpdatePos();
-  if (Input_.fail()) {
-    std::cerr << "Failed after clearing whitespace" << std::endl;
-    SaveErrData(C);
-    return false;
+  Tok.Offset = BufCur_ - BufBegin_;
+  Tok.Length = 0;
+  Tok.File = File_;
+  Tok.Sym = Symbol();
+  if (BufCur_ == BufEnd_) {
+    Tok.Kind = TOK_EOF;
+    return true;
   }
 
-  // Overwrite whitespace location
-  Tok.Row = Row();
-  Tok.Col = Col();
+  const char *Start = BufCur_;
+  const char *Ptr = Start;
+  char C = *Ptr;
 
-  if (isalpha(C)) {
+  if (CharClasses.Is(C, CC_ALPHA)) {
     // Reading an ID, type, or keyword
-    std::string Chars;
-    while (SafePeek(C) && isalnum(C)) Chars += ReadCharAndUpdatePos();
-    if (Input_.fail()) {
-      SaveErrData(C);
-      return false;
-    }
+    Ptr = SkipIdentChars(Ptr + 1, BufEnd_);
 
-    enum TokenKind Kind = TokenKindFromStr(Chars);
+    StringRef Text(Start, Ptr - Start);
+    enum TokenKind Kind = TokenKindFromStr(Text);
     if (Kind == TOK_UNKNOWN) {
       Tok.Kind = TOK_ID;
+      Tok.Sym = Symbol::Intern(Text);
     } else {
       Tok.Kind = Kind;
     }
-    Tok.Chars = Chars;
-
-    return true;
-  } else if (isdigit(C)) {
+  } else if (CharClasses.Is(C, CC_DIGIT)) {
     // Int literal
-    std::string Chars;
-    while (SafePeek(C) && isdigit(C)) Chars += ReadCharAndUpdatePos();
-    if (Input_.fail()) {
-      SaveErrData(C);
-      return false;
-    }
-
-    Tok.Chars = Chars;
+    Ptr = SkipDigits(Ptr + 1, BufEnd_);
     Tok.Kind = TOK_INT;
-    return true;
   } else if (C == '"') {
-    // Read off a string
-    std::string Chars;
-    Chars += ReadCharAndUpdatePos();
-    bool OnEscapedQuote = false;
-    while (SafePeek(C) && (C != '"' || OnEscapedQuote)) {
-      Chars += ReadCharAndUpdatePos();
-      int Lookahead;
-      SafePeek(Lookahead);
-      OnEscapedQuote = (C == '\\' && Lookahead == '"');
+    // Read off a string. A backslash escapes whatever character follows it,
+    // so we only need to stop at quotes and backslashes.
+    ++Ptr;
+    while ((Ptr = FindQuoteOrBackslash(Ptr, BufEnd_)) != BufEnd_ &&
+           *Ptr == '\\') {
+      // Skip over the escaped character.
+      if (++Ptr != BufEnd_) ++Ptr;
     }
-    if (Input_.fail()) {
-      SaveErrData(C);
+    if (Ptr == BufEnd_) {
+      // Unterminated string
+      SaveErrData(EOF);
       return false;
     }
-    Chars += ReadCharAndUpdatePos();
-    Tok.Chars = Chars;
+    ++Ptr;
     Tok.Kind = TOK_STR;
-    return true;
-  }
-
-  switch (C) {
-    case ';':
-      ReadCharAndUpdatePos();
-      Tok.Chars = ";";
-      Tok.Kind = TOK_SEMICOL;
-      return true;
-    case ':':
-      ReadCharAndUpdatePos();
-      Tok.Chars = ":";
-      Tok.Kind = TOK_COL;
-      return true;
-    case ',':
-      ReadCharAndUpdatePos();
-      Tok.Chars = ",";
-      Tok.Kind = TOK_COMMA;
-      return true;
-    case '(':
-      ReadCharAndUpdatePos();
-      Tok.Chars = "(";
-      Tok.Kind = TOK_LPAR;
-      return true;
-    case ')':
-      ReadCharAndUpdatePos();
-      Tok.Chars = ")";
-      Tok.Kind = TOK_RPAR;
-      return true;
-    case '"':
-      ReadCharAndUpdatePos();
-      Tok.Chars = "\"";
-      Tok.Kind = TOK_DQUOTE;
-      return true;
-    case '{':
-      ReadCharAndUpdatePos();
-      Tok.Chars = "{";
-      Tok.Kind = TOK_LBRACE;
-      return true;
-    case '}':
-      ReadCharAndUpdatePos();
-      Tok.Chars = "}";
-      Tok.Kind = TOK_RBRACE;
-      return true;
-    case '=':
-      ReadCharAndUpdatePos();
-      Tok.Chars = "=";
-      Tok.Kind = TOK_ASSIGN;
-      return true;
-    case EOF:
-      SetTokenEOF(Tok);
-      return true;
-    default:
+  } else {
+    enum TokenKind Kind = PunctuationKindFromChar(C);
+    if (Kind == TOK_UNKNOWN) {
       // Unknown lookahead
-      SaveErrData(C);
+      SaveErrData(static_cast<unsigned char>(C));
       return false;
+    }
+    ++Ptr;
+    Tok.Kind = Kind;
   }
+
+  Tok.Length = Ptr - Start;
+  BufCur_ = Ptr;
+  return true;
 }
 
 bool Lexer::PeekToken(Token &Tok) {
@@ -156,6 +161,6 @@ bool Lexer::PeekToken(Token &Tok) {
     HasBufferedTok_ = ReadToken(BufferedTok_);
   }
   Tok = BufferedTok_;
-  return HasBufferedTok_ && !Input_.fail();
+  return HasBufferedTok_;
 }
 }  // namespace lang
@@ -1,19 +1,25 @@
 #ifndef LEXER_H_
 #define LEXER_H_
 
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
 #include <istream>
+#include <memory>
 #include <string>
 
+#include "Interner.h"
+#include "MemoryBuffer.h"
+#include "StringRef.h"
+
 namespace lang {
 enum TokenKind {
   TOK_UNKNOWN = 0,
   TOK_EOF,
 
   // Keywords
-  // NOTE: New keywords added here MUST be added to the function
-  // `TokenKindFromStr()` that handles conversion from a TokenKind to a string
+  // NOTE: New keywords added here MUST be added to `KeywordList` in Lexer.cpp
+  // that handles conversion from a string to a TokenKind
   TOK_RETURN,
 
   // Atoms
@@ -34,26 +40,55 @@ enum TokenKind {
   TOK_ASSIGN,
 };
 
+/**
+ * Identifies the buffer a token was read from. See SourceManager.
+ */
+typedef uint32_t FileID;
+
+class Lexer;
+
+/**
+ * Tokens do not own their characters. They only record where they are in the
+ * source buffer, and the text is resolved on demand through
+ * Lexer::Text() or SourceManager::Text(). This keeps tokens cheap to copy.
+ * Likewise, the row and col are only computed from the offset when needed
+ * through Lexer::Location() or SourceManager::Location().
+ *
+ * Identifiers are interned as they are read, and Sym holds their symbol. Sym
+ * is the empty symbol for every other kind of token.
+ */
 struct Token {
   enum TokenKind Kind;
-  std::string Chars;
-  unsigned Row;
-  unsigned Col;
+  SourceLocation Offset;
+  uint32_t Length;
+  FileID File;
+  Symbol Sym;
 
-  void dump(std::ostream &out) const {
-    std::string chars = (Kind == TOK_EOF) ? "EOF" : Chars;
-    out << "<" << Kind << " " << Row << ":" << Col << " '" << chars << "'>";
-  }
+  void dump(std::ostream &out, const Lexer &Lex) const;
 };
 
 class Lexer {
  public:
   /**
-   * The file must have, and assumes, an open mode of `in` which cannot be
-   * checked for. Undefined behavior occurs if an iopstream is passed not
-   * operating on `in` mode.
+   * The remaining contents of the stream are copied into a buffer owned by
+   * the lexer. The file must have, and assumes, an open mode of `in` which
+   * cannot be checked for. Undefined behavior occurs if an iopstream is
+   * passed not operating on `in` mode.
+   */
+  explicit Lexer(std::istream &Input);
+
+  /**
+   * Lex directly out of a contiguous buffer. This avoids copying the source
+   * and should be preferred for large inputs. The buffer must outlive the
+   * lexer and every token read from it.
    */
-  explicit Lexer(std::istream &Input) : Input_(Input) {}
+  explicit Lexer(const MemoryBuffer &Buf, FileID File = 0);
+
+  /**
+   * Only lex the characters in [Begin, End) of the buffer. Token offsets are
+   * still relative to the start of the buffer.
+   */
+  Lexer(const MemoryBuffer &Buf, FileID File, uint32_t Begin, uint32_t End);
 
   /**
    * Read a token off the stream. Returns true if a token was successfully read.
@@ -70,16 +105,26 @@ class Lexer {
 
   /**
    * Same as ReadToken() but does not advance the stream of tokens. The internal
-   * stream may be advanced and the row and col are updated.
+   * stream may be advanced and the current offset is updated.
    */
   bool PeekToken(Token &Tok);
 
   bool ReachedEOF() {
-    int C;
-    while (SafePeek(C) && isspace(C)) ReadCharAndUpdatePos();
-    return Input_.eof() || (SafePeek(C) && C == EOF);
+    ExhaustWhitespace();
+    return BufCur_ == BufEnd_;
+  }
+
+  /**
+   * The characters of a token read from this lexer. This points into the
+   * source buffer and does not copy.
+   */
+  StringRef Text(const Token &Tok) const {
+    return StringRef(BufBegin_ + Tok.Offset, Tok.Length);
   }
 
+  FileID File() const { return File_; }
+  const MemoryBuffer &Buffer() const { return *Buf_; }
+
   /**
    * This is the character that we were unable to handle and is still left on
    * the stream.
@@ -87,50 +132,40 @@ class Lexer {
   int CharReadOnErr() const { return CharReadOnErr_; }
 
   /**
-   * These always point to the current row and column after every
+   * This always points to the current position in the buffer after every
    * Read/PeekToken() call. This can also be used on unsuccessful reads to get
-   * the location of an unhandled character. These values start at zero to
-   * represent the first row/col.
+   * the location of an unhandled character.
    */
-  unsigned Row() const { return Row_; }
-  unsigned Col() const { return Col_; }
+  SourceLocation Offset() const { return BufCur_ - BufBegin_; }
 
- private:
   /**
-   * "Safe" wrappers for stream functions that check if the stream failed after
-   * each operation. Returns true on successful operation and false on a failed
-   * one.
+   * Row and col lookups go through the buffer's line table, which is built on
+   * the first call. These are meant for diagnostics and tests, not the hot
+   * path. Row() and Col() are for the current position. These values start at
+   * zero to represent the first row/col.
    */
-  bool SafePeek(int &C) {
-    if (Input_.eof()) {
-      C = EOF;
-      return true;
-    }
-    C = Input_.peek();
-    return !Input_.fail();
+  LineCol Location(SourceLocation Loc) const {
+    return Buf_->Lines().Lookup(Loc);
   }
+  LineCol Location(const Token &Tok) const { return Location(Tok.Offset); }
+  unsigned Row() const { return Location(Offset()).Row; }
+  unsigned Col() const { return Location(Offset()).Col; }
 
-  int ReadCharAndUpdatePos() {
-    int C = Input_.get();
-    if (C == '\n') {
-      ++Row_;
-      Col_ = 0;
-    } else if (C != EOF) {
-      ++Col_;
-    }
-    return C;
-  }
+ private:
+  void Init(const MemoryBuffer &Buf);
 
-  void ExhaustWhitespace() {
-    int C;
-    while (SafePeek(C) && isspace(C)) ReadCharAndUpdatePos();
-  }
+  void ExhaustWhitespace();
 
   inline void SaveErrData(int C) { CharReadOnErr_ = C; }
 
-  std::istream &Input_;
-  unsigned Row_ = 0;
-  unsigned Col_ = 0;
+  // Only set if the lexer was created from a stream.
+  std::unique_ptr<MemoryBuffer> OwnedBuf_;
+
+  const MemoryBuffer *Buf_;
+  const char *BufBegin_;
+  const char *BufCur_;
+  const char *BufEnd_;
+  FileID File_ = 0;
 
   int CharReadOnErr_;
   Token BufferedTok_;
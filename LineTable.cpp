@@ -0,0 +1,26 @@
+#include <algorithm>
+
+#include "CharScan.h"
+#include "LineTable.h"
+
+namespace lang {
+
+LineTable::LineTable(const char *Begin, const char *End) {
+  LineStarts_.push_back(0);
+  FindNewlines(Begin, End, LineStarts_);
+
+  // Every line after the first starts right after a newline.
+  for (size_t i = 1; i < LineStarts_.size(); ++i) ++LineStarts_[i];
+}
+
+LineCol LineTable::Lookup(SourceLocation Loc) const {
+  // Find the last line that starts at or before the location. The first line
+  // always starts at 0, so this is never the beginning.
+  auto Line = std::upper_bound(LineStarts_.begin(), LineStarts_.end(), Loc) - 1;
+  LineCol Result;
+  Result.Row = Line - LineStarts_.begin();
+  Result.Col = Loc - *Line;
+  return Result;
+}
+
+}  // namespace lang
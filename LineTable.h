@@ -0,0 +1,43 @@
+#ifndef LINETABLE_H_
+#define LINETABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lang {
+
+/**
+ * A location in a source buffer, stored as the offset of a character from the
+ * start of the buffer. Rows and cols are only computed from this through a
+ * LineTable when they are actually needed, like for diagnostics.
+ */
+typedef uint32_t SourceLocation;
+
+/**
+ * A zero-based row and col.
+ */
+struct LineCol {
+  unsigned Row;
+  unsigned Col;
+};
+
+/**
+ * The offset of the start of every line in a buffer. This is built with a
+ * single pass over the buffer, and each lookup is a binary search.
+ */
+class LineTable {
+ public:
+  LineTable(const char *Begin, const char *End);
+
+  LineCol Lookup(SourceLocation Loc) const;
+
+  size_t NumLines() const { return LineStarts_.size(); }
+
+ private:
+  std::vector<uint32_t> LineStarts_;
+};
+
+}  // namespace lang
+
+#endif
@@ -0,0 +1,86 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+#include "MemoryBuffer.h"
+
+namespace lang {
+
+MemoryBuffer::~MemoryBuffer() {
+  if (IsMapped_) {
+    munmap(const_cast<char *>(Begin_), Size());
+  } else {
+    delete[] Begin_;
+  }
+}
+
+const LineTable &MemoryBuffer::Lines() const {
+  std::call_once(LinesBuilt_,
+                 [this] { Lines_.reset(new LineTable(Begin_, End_)); });
+  return *Lines_;
+}
+
+std::unique_ptr<MemoryBuffer> MemoryBuffer::FromFile(
+    const std::string &Filename) {
+  int FD = open(Filename.c_str(), O_RDONLY);
+  if (FD < 0) return nullptr;
+
+  struct stat Stat;
+  if (fstat(FD, &Stat) < 0) {
+    close(FD);
+    return nullptr;
+  }
+
+  // mmap() cannot map a zero length region.
+  size_t Size = Stat.st_size;
+  if (!Size) {
+    close(FD);
+    return FromString("");
+  }
+
+  void *Addr = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, FD, /*offset=*/0);
+  close(FD);
+  if (Addr == MAP_FAILED) return nullptr;
+
+  // The lexer reads the whole buffer front to back exactly once.
+  madvise(Addr, Size, MADV_SEQUENTIAL);
+
+  const char *Begin = static_cast<const char *>(Addr);
+  return std::unique_ptr<MemoryBuffer>(
+      new MemoryBuffer(Begin, Begin + Size, /*IsMapped=*/true));
+}
+
+std::unique_ptr<MemoryBuffer> MemoryBuffer::FromString(const std::string &Str) {
+  char *Begin = new char[Str.size()];
+  memcpy(Begin, Str.data(), Str.size());
+  return std::unique_ptr<MemoryBuffer>(
+      new MemoryBuffer(Begin, Begin + Str.size(), /*IsMapped=*/false));
+}
+
+std::unique_ptr<MemoryBuffer> MemoryBuffer::FromStream(std::istream &Input) {
+  std::string Str((std::istreambuf_iterator<char>(Input)),
+                  std::istreambuf_iterator<char>());
+  return FromString(Str);
+}
+
+std::unique_ptr<MemoryBuffer> MemoryBuffer::FromEdit(const MemoryBuffer &Buf,
+                                                    const TextEdit &Edit) {
+  assert(Edit.Offset + Edit.Length <= Buf.Size() && "Edit is out of range");
+  size_t Size = Buf.Size() - Edit.Length + Edit.Text.size();
+  char *Begin = new char[Size];
+  char *Ptr = Begin;
+  memcpy(Ptr, Buf.Begin(), Edit.Offset);
+  Ptr += Edit.Offset;
+  memcpy(Ptr, Edit.Text.data(), Edit.Text.size());
+  Ptr += Edit.Text.size();
+  size_t Tail = Edit.Offset + Edit.Length;
+  memcpy(Ptr, Buf.Begin() + Tail, Buf.Size() - Tail);
+  return std::unique_ptr<MemoryBuffer>(
+      new MemoryBuffer(Begin, Begin + Size, /*IsMapped=*/false));
+}
+
+}  // namespace lang
@@ -0,0 +1,87 @@
+#ifndef MEMORYBUFFER_H_
+#define MEMORYBUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "LineTable.h"
+
+namespace lang {
+
+/**
+ * Replaces the Length characters at Offset in a buffer with Text.
+ */
+struct TextEdit {
+  uint32_t Offset;
+  uint32_t Length;
+  std::string Text;
+};
+
+/**
+ * A read-only, contiguous block of source text. The contents are either
+ * memory-mapped from a file or copied from an in-memory string. The Lexer can
+ * scan this directly with pointers instead of going through an istream.
+ */
+class MemoryBuffer {
+ public:
+  ~MemoryBuffer();
+
+  MemoryBuffer(const MemoryBuffer &) = delete;
+  MemoryBuffer &operator=(const MemoryBuffer &) = delete;
+
+  /**
+   * Map the contents of a file into memory. Returns nullptr if the file could
+   * not be opened or mapped.
+   */
+  static std::unique_ptr<MemoryBuffer> FromFile(const std::string &Filename);
+
+  /**
+   * Create a buffer that holds a copy of the given string.
+   */
+  static std::unique_ptr<MemoryBuffer> FromString(const std::string &Str);
+
+  /**
+   * Create a buffer that holds a copy of the remaining contents of a stream.
+   */
+  static std::unique_ptr<MemoryBuffer> FromStream(std::istream &Input);
+
+  /**
+   * Create a buffer that holds a copy of Buf with the edit applied. The edit
+   * must lie within Buf.
+   */
+  static std::unique_ptr<MemoryBuffer> FromEdit(const MemoryBuffer &Buf,
+                                                const TextEdit &Edit);
+
+  const char *Begin() const { return Begin_; }
+  const char *End() const { return End_; }
+  size_t Size() const { return End_ - Begin_; }
+
+  /**
+   * The line table for this buffer. It is built the first time this is
+   * called, so buffers that never need a row or col never pay for it. This is
+   * safe to call from multiple threads.
+   */
+  const LineTable &Lines() const;
+
+ private:
+  MemoryBuffer(const char *Begin, const char *End, bool IsMapped)
+      : Begin_(Begin), End_(End), IsMapped_(IsMapped) {}
+
+  const char *Begin_;
+  const char *End_;
+
+  // If true, the buffer was created with mmap() and must be unmapped.
+  // Otherwise, it was allocated with new[].
+  bool IsMapped_;
+
+  mutable std::once_flag LinesBuilt_;
+  mutable std::unique_ptr<LineTable> Lines_;
+};
+
+}  // namespace lang
+
+#endif
@@ -1,7 +1,12 @@
 #include "Parser.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <memory>
 
+#include "AST/ASTWalker.h"
+
+using lang::ast::ASTContext;
 using lang::ast::ArgumentDeclaration;
 using lang::ast::Call;
 using lang::ast::Expr;
@@ -20,21 +25,104 @@ using lang::ast::VarDecl;
 
 namespace lang {
 
+namespace {
+
+// Functions parsed again by Reparse() each get a context of their own, and
+// most need far less than a regular slab.
+constexpr size_t kDeclSlabSize = 4 * 1024;
+
+/**
+ * Find where each top-level declaration starts without parsing anything. A
+ * function runs from its return type to the brace that closes its body, so
+ * only braces need to be matched. Starts gets one extra entry at the end, the
+ * index of the EOF token. Returns false if the tokens cannot be split up this
+ * way, including when the stream stopped on a lexer error.
+ */
+bool SkimDecls(const TokenStream &Toks, std::vector<size_t> &Starts) {
+  size_t Size = Toks.Size();
+  size_t i = 0;
+  while (i < Size && Toks.Kind(i) != TOK_EOF) {
+    Starts.push_back(i);
+    for (; i < Size && Toks.Kind(i) != TOK_LBRACE; ++i) {
+      if (Toks.Kind(i) == TOK_RBRACE || Toks.Kind(i) == TOK_EOF) return false;
+    }
+
+    unsigned Depth = 0;
+    for (; i < Size; ++i) {
+      enum TokenKind Kind = Toks.Kind(i);
+      if (Kind == TOK_LBRACE) {
+        ++Depth;
+      } else if (Kind == TOK_RBRACE) {
+        if (--Depth == 0) break;
+      } else if (Kind == TOK_EOF) {
+        return false;
+      }
+    }
+    if (i == Size) return false;
+    ++i;
+  }
+
+  if (i == Size) return false;
+  Starts.push_back(i);
+  return true;
+}
+
+}  // namespace
+
+bool Parser::NextToken(Token &Tok) {
+  if (Pipe_) return Pipe_->ReadToken(Tok);
+  if (!Toks_) return Lex_.ReadToken(Tok);
+
+  // The stream stops short of EOF on a lexer error.
+  if (TokIdx_ == TokEnd_) return false;
+
+  // Like the lexer, keep returning EOF once we reach it.
+  Tok = Toks_->Get(TokIdx_);
+  if (Tok.Kind != TOK_EOF) ++TokIdx_;
+  return true;
+}
+
+bool Parser::PeekNextToken(Token &Tok) {
+  if (Pipe_) return Pipe_->PeekToken(Tok);
+  if (!Toks_) return Lex_.PeekToken(Tok);
+  if (TokIdx_ == TokEnd_) return false;
+  Tok = Toks_->Get(TokIdx_);
+  return true;
+}
+
+void Parser::SetError(enum ParserStatus Err) {
+#if LANG_PARSE_TRACE
+  if (Status_ == PSTAT_OK) {
+    ErrStack_.clear();
+    for (const TraceFrame *F = Trace_; F; F = F->Parent_) {
+      if (!F->Rules_) {
+        ErrStack_.push_back(F->Rule_);
+        continue;
+      }
+      for (size_t i = F->Rules_->Size(); i--;)
+        ErrStack_.push_back((*F->Rules_)[i]);
+    }
+    std::reverse(ErrStack_.begin(), ErrStack_.end());
+  }
+#endif
+  Status_ = Err;
+}
+
 bool Parser::ReadAndCheckToken(enum TokenKind Expected) {
-  if (!Lex_.ReadToken(LastReadTok_)) {
-    Status_ = PSTAT_LEXER_ERR;
+  if (!NextToken(LastReadTok_)) {
+    SetError(PSTAT_LEXER_ERR);
     return false;
   }
   if (LastReadTok_.Kind != Expected) {
-    Status_ = PSTAT_UNEXPECTED_TOKEN_ERR;
+    SetError(PSTAT_UNEXPECTED_TOKEN_ERR);
     return false;
   }
   return true;
 }
 
 bool Parser::PeekAndCheckToken() {
-  if (!Lex_.PeekToken(LastReadTok_)) {
-    Status_ = PSTAT_LEXER_ERR;
+  if (!PeekNextToken(LastReadTok_)) {
+    SetError(PSTAT_LEXER_ERR);
     return false;
   }
   return true;
@@ -46,54 +134,225 @@ std::unique_ptr<Module> Parser::Parse() { return ParseModule(); }
  * module ::= funcdecl*
  */
 std::unique_ptr<Module> Parser::ParseModule() {
-  ParserStack_.push_back("Module");
-  std::vector<std::unique_ptr<ExternalDeclaration>> ExternDecls;
+  TraceFrame Frame(*this, "Module");
+  std::vector<const ExternalDeclaration *> ExternDecls;
+  std::vector<SourceLocation> DeclLocs;
 
   while (Ok() && !ReachedEOF()) {
-    std::unique_ptr<ExternalDeclaration> Decl = ParseFunctionDeclaration();
+    const ExternalDeclaration *Decl = ParseFunctionDeclaration();
     if (!Decl) return nullptr;
-    ExternDecls.push_back(std::move(Decl));
+    ExternDecls.push_back(Decl);
+    DeclLocs.push_back(DeclStart_);
+  }
+
+  return BuildModule(ExternDecls, DeclLocs);
+}
+
+std::unique_ptr<Module> Parser::ParseLazy() {
+  if (Toks_) Lazy_.reset(new LazyBodyParser(*Toks_));
+  std::unique_ptr<Module> Mod = ParseModule();
+  Lazy_.reset();
+  return Mod;
+}
+
+std::unique_ptr<Module> Parser::ParseParallel(ThreadPool &Pool,
+                                              unsigned NumChunks) {
+  std::vector<size_t> Starts;
+  if (!Toks_ || TokIdx_ != 0 || !Ok() || !SkimDecls(*Toks_, Starts))
+    return ParseModule();
+
+  // Split the declarations into chunks of about the same number of tokens.
+  // Chunk i covers declarations [Bounds[i], Bounds[i + 1]).
+  size_t NumDecls = Starts.size() - 1;
+  size_t NumToks = Starts.back();
+  if (!NumChunks) NumChunks = Pool.NumThreads() * 4;
+  std::vector<size_t> Bounds = {0};
+  for (unsigned i = 1; i < NumChunks; ++i) {
+    size_t Target = NumToks * i / NumChunks;
+    size_t Decl =
+        std::lower_bound(Starts.begin(), Starts.end() - 1, Target) -
+        Starts.begin();
+    if (Decl > Bounds.back() && Decl < NumDecls) Bounds.push_back(Decl);
   }
+  Bounds.push_back(NumDecls);
+
+  size_t NumTasks = Bounds.size() - 1;
+  std::vector<const ExternalDeclaration *> ExternDecls(NumDecls);
+  std::vector<SourceLocation> DeclLocs(NumDecls);
+  std::vector<std::unique_ptr<ASTContext>> Ctxs(NumTasks);
+  std::atomic<bool> Failed(false);
+  for (size_t i = 0; i < NumTasks; ++i) {
+    Pool.Async([&, i] {
+      size_t End = Starts[Bounds[i + 1]];
+      Parser Chunk(*Toks_, Starts[Bounds[i]], End);
+      for (size_t Decl = Bounds[i]; Decl < Bounds[i + 1]; ++Decl) {
+        ExternDecls[Decl] = Chunk.ParseFunctionDeclaration();
+        if (!ExternDecls[Decl] || !Chunk.Ok() ||
+            Failed.load(std::memory_order_relaxed)) {
+          Failed = true;
+          return;
+        }
+        DeclLocs[Decl] = Chunk.DeclStart_;
+      }
+      if (Chunk.TokIdx_ != End) Failed = true;
+      Ctxs[i] = std::move(Chunk.OwnedCtx_);
+    });
+  }
+  Pool.Wait();
+
+  // A declaration can come back with an error set, as when a body recovers
+  // from a bad statement. The serial parse reports the same error it would
+  // have without the chunks.
+  if (Failed) return ParseModule();
+
+  for (auto &Ctx : Ctxs) Ctx_->Adopt(*Ctx);
+  return BuildModule(ExternDecls, DeclLocs);
+}
+
+std::unique_ptr<Module> Parser::Reparse(std::unique_ptr<Module> Old,
+                                        const MemoryBuffer &OldBuf,
+                                        const TextEdit &Edit) {
+  const MemoryBuffer &Buf = Lex_.Buffer();
+  ArrayRef<const ExternalDeclaration *> OldDecls = Old->ExternDecls();
+  size_t NumOld = OldDecls.Size();
+  int64_t Delta = static_cast<int64_t>(Edit.Text.size()) - Edit.Length;
+  if (Toks_ || Pipe_ || Lex_.Offset() != 0 || !Ok() || Old->Bodies() ||
+      !NumOld || Edit.Offset + Edit.Length > OldBuf.Size() ||
+      Buf.Size() + Edit.Length != OldBuf.Size() + Edit.Text.size())
+    return ParseModule();
+
+  // Decl i owns the text from its first token up to the first token of decl
+  // i + 1. Every decl whose text overlaps the edit, or that the edit touches
+  // on either side, is parsed again, since the edit may join tokens across
+  // the boundary. Decls are in source order, so both ends are found with a
+  // binary search.
+  ArrayRef<SourceLocation> OldLocs = Old->DeclLocs();
+  auto Start = [&](size_t i) { return OldLocs[i]; };
+  auto FirstStartingAfter = [&](SourceLocation Loc) {
+    return std::upper_bound(OldLocs.begin(), OldLocs.end(), Loc) -
+           OldLocs.begin();
+  };
+  size_t First = Edit.Offset ? FirstStartingAfter(Edit.Offset - 1) : 0;
+  if (First) --First;
+  size_t Last = FirstStartingAfter(Edit.Offset + Edit.Length);
+
+  // Relex from the first decl until a token lands exactly where an untouched
+  // decl used to start. The text from there on is unchanged, so it lexes and
+  // parses the same as before. If the new text swallows the start of a decl,
+  // as an unclosed string would, that decl is reparsed too.
+  uint32_t Begin = First ? Start(First) : 0;
+  Lexer Lex(Buf, Lex_.File(), Begin, Buf.Size());
+  TokenStream Region(Buf, Lex_.File());
+  while (true) {
+    Token Tok;
+    if (!Lex.ReadToken(Tok)) return ParseModule();
+    while (Last < NumOld && Start(Last) + Delta < Tok.Offset) ++Last;
+    if (Last < NumOld && Start(Last) + Delta == Tok.Offset) {
+      Tok.Kind = TOK_EOF;
+      Tok.Length = 0;
+    }
+    Region.Push(Tok);
+    if (Tok.Kind == TOK_EOF) break;
+  }
+
+  // Reused decls keep the context they were parsed into, and only where they
+  // start changes. Each decl parsed again gets a context of its own, so it
+  // is freed as soon as no module uses it.
+  std::vector<const ExternalDeclaration *> ExternDecls;
+  std::vector<SourceLocation> DeclLocs;
+  std::vector<std::shared_ptr<const ASTContext>> DeclCtxs;
+  ExternDecls.reserve(NumOld + 1);
+  DeclLocs.reserve(NumOld + 1);
+  DeclCtxs.reserve(NumOld + 1);
+  auto Reuse = [&](size_t i, int64_t Shift) {
+    ExternDecls.push_back(OldDecls[i]);
+    DeclLocs.push_back(static_cast<SourceLocation>(Start(i) + Shift));
+    DeclCtxs.push_back(Old->DeclContext(i));
+  };
+  for (size_t i = 0; i < First; ++i) Reuse(i, 0);
+
+  Parser Reparsed(Region);
+  while (true) {
+    auto Ctx = std::make_shared<ASTContext>(kDeclSlabSize);
+    const ExternalDeclaration *Decl = Reparsed.ParseNextDecl(*Ctx);
+    if (!Decl) break;
+    ExternDecls.push_back(Decl);
+    DeclLocs.push_back(Reparsed.DeclStart_);
+    DeclCtxs.push_back(std::move(Ctx));
+  }
+  if (!Reparsed.Ok()) return ParseModule();
+
+  for (size_t i = Last; i < NumOld; ++i) Reuse(i, Delta);
+  return BuildModule(ExternDecls, DeclLocs, std::move(DeclCtxs));
+}
+
+std::unique_ptr<Module> Parser::BuildModule(
+    const std::vector<const ExternalDeclaration *> &ExternDecls,
+    const std::vector<SourceLocation> &DeclLocs,
+    std::vector<std::shared_ptr<const ASTContext>> DeclCtxs) {
+  ArrayRef<const ExternalDeclaration *> Decls = Ctx_->CreateArray(ExternDecls);
+  ArrayRef<SourceLocation> Locs = Ctx_->CreateArray(DeclLocs);
+  std::unique_ptr<ASTContext> Ctx(std::move(OwnedCtx_));
+  OwnedCtx_.reset(new ASTContext);
+  Ctx_ = OwnedCtx_.get();
+  if (!DeclCtxs.empty())
+    return std::make_unique<Module>(std::move(Ctx), Decls, Locs,
+                                    std::move(DeclCtxs));
+  return std::make_unique<Module>(std::move(Ctx), Decls, Locs,
+                                  std::move(Lazy_));
+}
 
-  ParserStack_.pop_back();
-  return std::make_unique<Module>(ExternDecls);
+const ExternalDeclaration *Parser::ParseNextDecl() {
+  Ctx_->Reset();
+  return ParseNextDecl(*Ctx_);
+}
+
+const ExternalDeclaration *Parser::ParseNextDecl(ASTContext &Ctx) {
+  if (!Ok() || ReachedEOF()) return nullptr;
+
+  ASTContext *Prev = Ctx_;
+  Ctx_ = &Ctx;
+  TraceFrame Frame(*this, "Module");
+  const ExternalDeclaration *Decl = ParseFunctionDeclaration();
+  Ctx_ = Prev;
+  return Decl;
 }
 
 /**
  * type ::= ID
  */
-std::unique_ptr<Type> Parser::ParseType() {
-  ParserStack_.push_back("Type");
+Type *Parser::ParseType() {
+  TraceFrame Frame(*this, "Type");
   if (!ReadAndCheckToken(lang::TOK_ID)) return nullptr;
-  ParserStack_.pop_back();
-  return std::make_unique<Typename>(LastReadTok_.Chars);
+  Type *Ty = Ctx_->Create<Typename>(LastReadTok_.Sym);
+  Ty->SetLoc(LocInDecl(LastReadTok_.Offset));
+  return Ty;
 }
 
 /**
  * argdecl ::= type ID
  */
-std::unique_ptr<ArgumentDeclaration> Parser::ParseArgumentDeclaration() {
-  ParserStack_.push_back("ArgumentDeclaration");
-  std::unique_ptr<Type> Ty = ParseType();
+ArgumentDeclaration *Parser::ParseArgumentDeclaration() {
+  TraceFrame Frame(*this, "ArgumentDeclaration");
+  Type *Ty = ParseType();
   if (!Ty) return nullptr;
 
   if (!ReadAndCheckToken(lang::TOK_ID)) return nullptr;
 
-  ParserStack_.pop_back();
-  return std::make_unique<ArgumentDeclaration>(std::move(Ty),
-                                               LastReadTok_.Chars);
+  auto ArgDecl = Ctx_->Create<ArgumentDeclaration>(Ty, LastReadTok_.Sym);
+  ArgDecl->SetLoc(Ty->Loc());
+  return ArgDecl;
 }
 
 /**
  * arglist ::= argdecl
  *         ::= argdecl (',' argdecl)*
  */
-bool Parser::ParseArgList(
-    std::vector<std::unique_ptr<ArgumentDeclaration>> &ArgList) {
-  ParserStack_.push_back("ArgList");
-  std::unique_ptr<ArgumentDeclaration> Arg = ParseArgumentDeclaration();
+bool Parser::ParseArgList(std::vector<const ArgumentDeclaration *> &ArgList) {
+  TraceFrame Frame(*this, "ArgList");
+  const ArgumentDeclaration *Arg = ParseArgumentDeclaration();
   if (!Arg) return false;
-  ArgList.push_back(std::move(Arg));
+  ArgList.push_back(Arg);
 
   if (!PeekAndCheckToken()) return false;
 
@@ -102,22 +361,21 @@ bool Parser::ParseArgList(
           (Arg = ParseArgumentDeclaration())))
       return false;
 
-    ArgList.push_back(std::move(Arg));
+    ArgList.push_back(Arg);
 
     if (!PeekAndCheckToken()) return false;
   }
-  ParserStack_.pop_back();
   return true;
 }
 
 /**
  * stmtlist ::= (stmt ';')+
  */
-bool Parser::ParseStmtList(std::vector<std::unique_ptr<Stmt>> &StmtList) {
-  ParserStack_.push_back("StmtList");
-  std::unique_ptr<Stmt> stmt = ParseStmt();
+bool Parser::ParseStmtList(std::vector<const Stmt *> &StmtList) {
+  TraceFrame Frame(*this, "StmtList");
+  const Stmt *stmt = ParseStmt();
   if (!stmt) return false;
-  StmtList.push_back(std::move(stmt));
+  StmtList.push_back(stmt);
 
   if (!ReadAndCheckToken(lang::TOK_SEMICOL)) return false;
 
@@ -127,11 +385,10 @@ bool Parser::ParseStmtList(std::vector<std::unique_ptr<Stmt>> &StmtList) {
     if (!(ReadAndCheckToken(lang::TOK_SEMICOL) && (stmt = ParseStmt())))
       return false;
 
-    StmtList.push_back(std::move(stmt));
+    StmtList.push_back(stmt);
 
     if (!PeekAndCheckToken()) return false;
   }
-  ParserStack_.pop_back();
   return true;
 }
 
@@ -139,161 +396,275 @@ bool Parser::ParseStmtList(std::vector<std::unique_ptr<Stmt>> &StmtList) {
  * funcdecl ::= type ID '(' ')' '{' stmtlist '}'
  *          ::= type ID '(' arglist ')' '{' stmtlist '}'
  */
-std::unique_ptr<FunctionDeclaration> Parser::ParseFunctionDeclaration() {
-  ParserStack_.push_back("FunctionDeclaration");
-  std::unique_ptr<Type> Ty = ParseType();
+FunctionDeclaration *Parser::ParseFunctionDeclaration() {
+  TraceFrame Frame(*this, "FunctionDeclaration");
+  // Errors are left to ParseType() to report.
+  Token First;
+  if (PeekNextToken(First)) DeclStart_ = First.Offset;
+  Type *Ty = ParseType();
   if (!Ty) return nullptr;
 
   if (!ReadAndCheckToken(lang::TOK_ID)) return nullptr;
 
-  std::string Name = LastReadTok_.Chars;
+  Symbol Name = LastReadTok_.Sym;
 
   if (!ReadAndCheckToken(lang::TOK_LPAR)) return nullptr;
 
   if (!PeekAndCheckToken()) return nullptr;
 
-  std::vector<std::unique_ptr<ArgumentDeclaration>> ArgList;
+  std::vector<const ArgumentDeclaration *> ArgList;
   if (LastReadTok_.Kind != lang::TOK_RPAR && !ParseArgList(ArgList)) {
-    Status_ = PSTAT_UNEXPECTED_TOKEN_ERR;
+    SetError(PSTAT_UNEXPECTED_TOKEN_ERR);
     return nullptr;
   }
 
-  if (!ReadAndCheckToken(lang::TOK_RPAR) ||
-      !ReadAndCheckToken(lang::TOK_LBRACE))
-    return nullptr;
+  if (!ReadAndCheckToken(lang::TOK_RPAR)) return nullptr;
 
-  if (!PeekAndCheckToken()) return nullptr;
+  FunctionDeclaration *FuncDecl;
+  size_t BodyEnd;
+  if (Lazy_ && SkipFunctionBody(BodyEnd)) {
+    FuncDecl = Ctx_->Create<FunctionDeclaration>(
+        Ty, Name, Ctx_->CreateArray(ArgList), *Lazy_, TokIdx_, BodyEnd,
+        DeclStart_);
+    TokIdx_ = BodyEnd;
+    LastReadTok_ = Toks_->Get(BodyEnd - 1);
+  } else {
+    ArrayRef<const Stmt *> Body;
+    if (!ParseFunctionBody(Body)) return nullptr;
+    FuncDecl = Ctx_->Create<FunctionDeclaration>(
+        Ty, Name, Ctx_->CreateArray(ArgList), Body);
+  }
+  FuncDecl->SetLoc(Ty->Loc());
+  return FuncDecl;
+}
 
-  std::vector<std::unique_ptr<Stmt>> StmtList;
+/**
+ * funcbody ::= '{' stmt* '}'
+ */
+bool Parser::ParseFunctionBody(ArrayRef<const Stmt *> &Body) {
+  if (!ReadAndCheckToken(lang::TOK_LBRACE)) return false;
+
+  if (!PeekAndCheckToken()) return false;
+
+  std::vector<const Stmt *> StmtList;
   while (LastReadTok_.Kind != lang::TOK_RBRACE) {
-    std::unique_ptr<Stmt> S = ParseStmt();
-    if (!S || !PeekAndCheckToken()) return nullptr;
-    StmtList.push_back(std::move(S));
+    const Stmt *S = ParseStmt();
+    if (!S || !PeekAndCheckToken()) return false;
+    StmtList.push_back(S);
   }
 
-  if (!ReadAndCheckToken(lang::TOK_RBRACE)) return nullptr;
+  if (!ReadAndCheckToken(lang::TOK_RBRACE)) return false;
 
-  ParserStack_.pop_back();
-  return std::make_unique<FunctionDeclaration>(std::move(Ty), Name, ArgList,
-                                               StmtList);
+  Body = Ctx_->CreateArray(StmtList);
+  return true;
 }
 
-/**
- * expr ::= INT
- *      ::= STR
- *      ::= idexpr
- */
-std::unique_ptr<Expr> Parser::ParseExpr() {
-  ParserStack_.push_back("ParseExpr");
-  if (!PeekAndCheckToken()) return nullptr;
+bool Parser::SkipFunctionBody(size_t &End) {
+  if (TokIdx_ == TokEnd_ || Toks_->Kind(TokIdx_) != TOK_LBRACE) return false;
+
+  unsigned Depth = 0;
+  for (size_t i = TokIdx_; i < TokEnd_; ++i) {
+    enum TokenKind Kind = Toks_->Kind(i);
+    if (Kind == TOK_LBRACE) {
+      ++Depth;
+    } else if (Kind == TOK_RBRACE) {
+      if (--Depth == 0) {
+        End = i + 1;
+        return true;
+      }
+    } else if (Kind == TOK_EOF) {
+      break;
+    }
+  }
+  return false;
+}
 
-  switch (LastReadTok_.Kind) {
-    default:
-      Status_ = PSTAT_UNEXPECTED_TOKEN_ERR;
-      return nullptr;
-    case TOK_INT:
-      ParserStack_.pop_back();
-      ReadAndCheckToken(lang::TOK_INT);
-      return ParseIntegerLiteral(LastReadTok_);
-    case TOK_STR:
-      ParserStack_.pop_back();
-      ReadAndCheckToken(lang::TOK_STR);
-      return ParseStringLiteral(LastReadTok_);
-    case TOK_ID:
-      ParserStack_.pop_back();
-      ReadAndCheckToken(lang::TOK_ID);
-      return ParseIDExpr(LastReadTok_);
+LazyBodyParser::~LazyBodyParser() = default;
+
+bool LazyBodyParser::ParseBody(uint32_t Begin, uint32_t End,
+                               SourceLocation DeclStart,
+                               ArrayRef<const Stmt *> &Body) {
+  std::unique_ptr<Parser> Parse(new Parser(Toks_, Begin, End));
+  Parse->Ctx_ = &Ctx_;
+  Parse->DeclStart_ = DeclStart;
+  bool Ok;
+  {
+    Parser::TraceFrame Frame(*Parse, "FunctionDeclaration");
+    // Some errors still give back a body, so the parser's status decides.
+    Ok = Parse->ParseFunctionBody(Body) && Parse->Ok();
   }
+  if (Ok) return true;
+
+  // Keep the first parser that failed around to report its error.
+  if (!Failed_) Failed_ = std::move(Parse);
+  return false;
+}
+
+bool LazyBodyParser::DebugOk() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return !Failed_ || Failed_->DebugOk();
+}
+
+Expr *Parser::ParseExpr() {
+  TraceFrame Frame(*this, "Expr");
+  return ParseNestedExpr(nullptr);
 }
 
-std::unique_ptr<StringLiteral> Parser::ParseStringLiteral() {
-  ParserStack_.push_back("StringLiteral");
+StringLiteral *Parser::ParseStringLiteral() {
+  TraceFrame Frame(*this, "StringLiteral");
   if (!ReadAndCheckToken(lang::TOK_STR)) return nullptr;
   auto literal = ParseStringLiteral(LastReadTok_);
-  ParserStack_.pop_back();
   return literal;
 }
 
-std::unique_ptr<StringLiteral> Parser::ParseStringLiteral(Token strtok) {
-  return std::make_unique<StringLiteral>(strtok.Chars);
+StringLiteral *Parser::ParseStringLiteral(Token strtok) {
+  auto Literal = Ctx_->Create<StringLiteral>(Ctx_->CopyString(Text(strtok)));
+  Literal->SetLoc(LocInDecl(strtok.Offset));
+  return Literal;
 }
 
-std::unique_ptr<IntegerLiteral> Parser::ParseIntegerLiteral() {
+IntegerLiteral *Parser::ParseIntegerLiteral() {
   if (!ReadAndCheckToken(lang::TOK_INT)) return nullptr;
   return ParseIntegerLiteral(LastReadTok_);
 }
 
-std::unique_ptr<IntegerLiteral> Parser::ParseIntegerLiteral(Token inttok) {
-  ParserStack_.push_back("IntegerLiteral");
-  auto Literal = IntegerLiteral::FromStr(inttok.Chars);
-  if (!Literal) Status_ = PSTAT_BAD_INT_ERR;
-  ParserStack_.pop_back();
+IntegerLiteral *Parser::ParseIntegerLiteral(Token inttok) {
+  TraceFrame Frame(*this, "IntegerLiteral");
+  auto Literal = IntegerLiteral::FromStr(*Ctx_, Text(inttok));
+  if (Literal)
+    Literal->SetLoc(LocInDecl(inttok.Offset));
+  else
+    SetError(PSTAT_BAD_INT_ERR);
   return Literal;
 }
 
-/**
- * exprlist ::= expr (',' expr)*
- */
-bool Parser::ParseExprList(std::vector<std::unique_ptr<Expr>> &ExprList) {
-  ParserStack_.push_back("ExprList");
-  std::unique_ptr<Expr> Arg = ParseExpr();
-  if (!Arg) return false;
-  ExprList.push_back(std::move(Arg));
-
-  if (!PeekAndCheckToken()) return false;
-
-  while (LastReadTok_.Kind == TOK_COMMA) {
-    if (!(ReadAndCheckToken(lang::TOK_COMMA) && (Arg = ParseExpr())))
-      return false;
-
-    ExprList.push_back(std::move(Arg));
-
-    if (!PeekAndCheckToken()) return false;
-  }
-  ParserStack_.pop_back();
-  return true;
-}
+Expr *Parser::ParseIDExpr(Token idtok) { return ParseNestedExpr(&idtok); }
 
 /**
+ * expr ::= INT
+ *      ::= STR
+ *      ::= idexpr
  * idexpr ::= ID ('(' exprlist* ')')*
+ * exprlist ::= expr (',' expr)*
+ *
+ * Calls whose arguments are still being parsed are kept on Calls, innermost
+ * last, and the arguments parsed so far for all of them on Args. The rules
+ * for arguments are kept on Rules behind a single trace frame, so an error is
+ * reported with the same parse stack as if each rule were its own call.
+ * Nothing here allocates unless calls nest deeply.
  */
-std::unique_ptr<Expr> Parser::ParseIDExpr(Token idtok) {
-  auto Caller = std::make_unique<ID>(idtok.Chars);
-
-  if (!PeekAndCheckToken()) return nullptr;
-
-  if (LastReadTok_.Kind != TOK_LPAR) {
-    return Caller;
-  }
-
-  if (!ReadAndCheckToken(lang::TOK_LPAR)) return nullptr;
-
-  if (!PeekAndCheckToken()) return nullptr;
-
-  if (LastReadTok_.Kind == lang::TOK_RPAR) {
-    // Call with no args
-    return std::make_unique<Call>(std::move(Caller));
-  }
-
-  std::vector<std::unique_ptr<Expr>> ExprList;
-  if (!ParseExprList(ExprList)) {
-    Status_ = PSTAT_UNEXPECTED_TOKEN_ERR;
+Expr *Parser::ParseNestedExpr(const Token *IDTok) {
+  struct OpenCall {
+    const ID *Caller;
+    SourceLocation Loc;
+    size_t FirstArg;
+  };
+  InlineStack<OpenCall, 4> Calls;
+  InlineStack<const Expr *, 8> Args;
+  RuleStack Rules;
+  TraceFrame Frame(*this, Rules);
+
+  // Any failure inside the argument list of a call is reported as an
+  // unexpected token.
+  auto Fail = [this](size_t OpenLists) -> Expr * {
+    if (OpenLists) SetError(PSTAT_UNEXPECTED_TOKEN_ERR);
     return nullptr;
-  }
+  };
+
+  Token Tok;
+  if (IDTok) Tok = *IDTok;
+  bool HaveID = IDTok != nullptr;
+  while (true) {
+    Expr *E = nullptr;
+    if (!HaveID) {
+      if (!PeekAndCheckToken()) return Fail(Calls.Size());
+
+      switch (LastReadTok_.Kind) {
+        default:
+          SetError(PSTAT_UNEXPECTED_TOKEN_ERR);
+          return Fail(Calls.Size());
+        case TOK_INT:
+          ReadAndCheckToken(lang::TOK_INT);
+          E = ParseIntegerLiteral(LastReadTok_);
+          if (!E) return Fail(Calls.Size());
+          break;
+        case TOK_STR:
+          ReadAndCheckToken(lang::TOK_STR);
+          E = ParseStringLiteral(LastReadTok_);
+          break;
+        case TOK_ID:
+          ReadAndCheckToken(lang::TOK_ID);
+          Tok = LastReadTok_;
+          HaveID = true;
+          break;
+      }
+    }
 
-  if (!ReadAndCheckToken(lang::TOK_RPAR)) return nullptr;
+    if (HaveID) {
+      HaveID = false;
+      auto Caller = Ctx_->Create<ID>(Tok.Sym);
+      Caller->SetLoc(LocInDecl(Tok.Offset));
+
+      if (!PeekAndCheckToken()) return Fail(Calls.Size());
+      if (LastReadTok_.Kind != TOK_LPAR) {
+        E = Caller;
+      } else {
+        ReadAndCheckToken(lang::TOK_LPAR);
+        if (!PeekAndCheckToken()) return Fail(Calls.Size());
+
+        if (LastReadTok_.Kind != lang::TOK_RPAR) {
+          // Parse the first argument next.
+          Calls.Push({Caller, Caller->Loc(), Args.Size()});
+          Rules.Push("ExprList");
+          Rules.Push("Expr");
+          continue;
+        }
+
+        // Call with no args
+        ReadAndCheckToken(lang::TOK_RPAR);
+        E = Ctx_->Create<Call>(Caller);
+        E->SetLoc(Caller->Loc());
+      }
+    }
 
-  return std::make_unique<Call>(std::move(Caller), ExprList);
+    // E is either the whole expression or the next argument of the innermost
+    // open call, and the argument may be the one that closes it.
+    while (true) {
+      if (Calls.Empty()) return E;
+
+      Args.Push(E);
+      Rules.Pop();
+      if (!PeekAndCheckToken()) return Fail(Calls.Size());
+
+      if (LastReadTok_.Kind == TOK_COMMA) {
+        ReadAndCheckToken(lang::TOK_COMMA);
+        Rules.Push("Expr");
+        break;
+      }
+
+      Rules.Pop();
+      if (!ReadAndCheckToken(lang::TOK_RPAR)) return Fail(Calls.Size() - 1);
+
+      OpenCall C = Calls.Back();
+      Calls.Pop();
+      size_t NumArgs = Args.Size() - C.FirstArg;
+      const Expr **Elems = Ctx_->AllocateArray<const Expr *>(NumArgs);
+      std::copy(Args.begin() + C.FirstArg, Args.end(), Elems);
+      Args.Truncate(C.FirstArg);
+
+      E = Ctx_->Create<Call>(C.Caller, ArrayRef<const Expr *>(Elems, NumArgs));
+      E->SetLoc(C.Loc);
+    }
+  }
 }
 
 /**
  * idexpr ::= ID ('(' exprlist* ')')*
  */
-std::unique_ptr<Expr> Parser::ParseIDExpr() {
-  ParserStack_.push_back("IDExpr");
+Expr *Parser::ParseIDExpr() {
+  TraceFrame Frame(*this, "IDExpr");
   if (!ReadAndCheckToken(lang::TOK_ID)) return nullptr;
   auto expr = ParseIDExpr(LastReadTok_);
-  ParserStack_.pop_back();
   return expr;
 }
 
@@ -302,17 +673,19 @@ std::unique_ptr<Expr> Parser::ParseIDExpr() {
  *      ::= ID ':' type '=' expr ';'
  *      ::= expr ';'
  */
-std::unique_ptr<Stmt> Parser::ParseStmt() {
-  ParserStack_.push_back("Stmt");
+Stmt *Parser::ParseStmt() {
+  TraceFrame Frame(*this, "Stmt");
   if (!PeekAndCheckToken()) return nullptr;
 
-  std::unique_ptr<Stmt> stmt;
+  Stmt *stmt;
   switch (LastReadTok_.Kind) {
     case TOK_RETURN: {
       if (!ReadAndCheckToken(lang::TOK_RETURN)) return nullptr;
-      std::unique_ptr<Expr> E = ParseExpr();
+      SourceLocation Loc = LocInDecl(LastReadTok_.Offset);
+      const Expr *E = ParseExpr();
       if (!E) return nullptr;
-      stmt = std::make_unique<Return>(std::move(E));
+      stmt = Ctx_->Create<Return>(E);
+      stmt->SetLoc(Loc);
       break;
     }
     case TOK_ID:
@@ -320,16 +693,16 @@ std::unique_ptr<Stmt> Parser::ParseStmt() {
       stmt = ParseVarDeclOrIDExprStmt(LastReadTok_);
       break;
     default: {
-      std::unique_ptr<Expr> E = ParseExpr();
+      const Expr *E = ParseExpr();
       if (!E) return nullptr;
-      stmt = std::make_unique<ExprStmt>(std::move(E));
+      stmt = Ctx_->Create<ExprStmt>(E);
+      stmt->SetLoc(E->Loc());
       break;
     }
   }
 
   if (!ReadAndCheckToken(lang::TOK_SEMICOL)) return nullptr;
 
-  ParserStack_.pop_back();
   return stmt;
 }
 
@@ -337,38 +710,40 @@ std::unique_ptr<Stmt> Parser::ParseStmt() {
  * vardecl_or_idexpr ::= ID ':' type '=' expr ';'
  *                   ::= idexpr ';'
  */
-std::unique_ptr<ast::Stmt> Parser::ParseVarDeclOrIDExprStmt(Token idtok) {
-  ParserStack_.push_back("DeclOrIDExprStmt");
+Stmt *Parser::ParseVarDeclOrIDExprStmt(Token idtok) {
+  TraceFrame Frame(*this, "DeclOrIDExprStmt");
   if (!PeekAndCheckToken()) return nullptr;
 
-  ParserStack_.pop_back();
-  if (LastReadTok_.Kind == TOK_COL)
-    return ParseVarDecl(idtok);
-  else
-    return std::make_unique<ExprStmt>(ParseIDExpr(idtok));
+  if (LastReadTok_.Kind == TOK_COL) return ParseVarDecl(idtok);
+
+  auto S = Ctx_->Create<ExprStmt>(ParseIDExpr(idtok));
+  S->SetLoc(LocInDecl(idtok.Offset));
+  return S;
 }
 
 /**
  * vardecl ::= ID ':' type '=' expr ';'
  */
-std::unique_ptr<ast::Stmt> Parser::ParseVarDecl(Token idtok) {
-  ParserStack_.push_back("vardecl");
+Stmt *Parser::ParseVarDecl(Token idtok) {
+  TraceFrame Frame(*this, "vardecl");
   if (!ReadAndCheckToken(lang::TOK_COL)) return nullptr;
 
-  std::unique_ptr<Type> Ty = ParseType();
+  const Type *Ty = ParseType();
 
   if (!PeekAndCheckToken()) return nullptr;
   if (LastReadTok_.Kind == lang::TOK_SEMICOL) {
-    ParserStack_.pop_back();
-    return std::make_unique<VarDecl>(std::move(Ty), idtok.Chars);
+    auto Decl = Ctx_->Create<VarDecl>(Ty, idtok.Sym);
+    Decl->SetLoc(LocInDecl(idtok.Offset));
+    return Decl;
   }
 
   if (!ReadAndCheckToken(lang::TOK_ASSIGN)) return nullptr;
 
-  std::unique_ptr<Expr> E = ParseExpr();
+  const Expr *E = ParseExpr();
 
-  ParserStack_.pop_back();
-  return std::make_unique<VarDecl>(std::move(Ty), idtok.Chars, std::move(E));
+  auto Decl = Ctx_->Create<VarDecl>(Ty, idtok.Sym, E);
+  Decl->SetLoc(LocInDecl(idtok.Offset));
+  return Decl;
 }
 
 bool Parser::DebugOk() const {
@@ -377,12 +752,22 @@ bool Parser::DebugOk() const {
   switch (Status_) {
     case PSTAT_OK:
       return true;
-    case PSTAT_LEXER_ERR:
-      std::cerr << "Lexer error" << std::endl;
+    case PSTAT_LEXER_ERR: {
+      LineCol Loc;
+      if (Toks_) {
+        Loc.Row = Toks_->ErrRow();
+        Loc.Col = Toks_->ErrCol();
+      } else if (Pipe_) {
+        Loc = Lex_.Location(Pipe_->ErrOffset());
+      } else {
+        Loc = Lex_.Location(Lex_.Offset());
+      }
+      std::cerr << "Lexer error at " << Loc.Row << ":" << Loc.Col << std::endl;
       break;
+    }
     case PSTAT_UNEXPECTED_TOKEN_ERR:
       std::cerr << "Unexpected token" << std::endl;
-      LastReadTok().dump(std::cerr);
+      LastReadTok().dump(std::cerr, Lex_);
       std::cerr << std::endl;
       break;
     case PSTAT_BAD_INT_ERR:
@@ -6,11 +6,23 @@
 #include <vector>
 
 #include "AST/ASTCommon.h"
+#include "AST/ASTContext.h"
 #include "AST/ExternDecl.h"
+#include "InlineStack.h"
 #include "Lexer.h"
+#include "ThreadPool.h"
+#include "TokenPipe.h"
+#include "TokenStream.h"
+
+// Set to 0 to compile out the rule names reported by DumpParseStack.
+#ifndef LANG_PARSE_TRACE
+#define LANG_PARSE_TRACE 1
+#endif
 
 namespace lang {
 
+class LazyBodyParser;
+
 enum ParserStatus {
   PSTAT_OK,
   PSTAT_LEXER_ERR,
@@ -20,51 +32,273 @@ enum ParserStatus {
 
 class Parser {
  public:
-  explicit Parser(std::istream &Input) : Lex_(Input) {}
+  explicit Parser(std::istream &Input)
+      : Lex_(Input), OwnedCtx_(new ast::ASTContext), Ctx_(OwnedCtx_.get()) {}
+  explicit Parser(const MemoryBuffer &Buf, FileID File = 0)
+      : Lex_(Buf, File),
+        OwnedCtx_(new ast::ASTContext),
+        Ctx_(OwnedCtx_.get()) {}
+
+  /**
+   * Parse from tokens that were already lexed. The parser walks the stream by
+   * index instead of pulling each token through the lexer. The stream must be
+   * lexed before the parser is created and must outlive it.
+   */
+  explicit Parser(const TokenStream &Toks)
+      : Parser(Toks, 0, Toks.Size()) {}
+
+  /**
+   * Parse only the tokens in [Begin, End) of the stream. Running out of
+   * tokens before End is reached is reported as a lexer error.
+   */
+  Parser(const TokenStream &Toks, size_t Begin, size_t End)
+      : Lex_(Toks.Buffer(), Toks.File()),
+        Toks_(&Toks),
+        TokIdx_(Begin),
+        TokEnd_(End),
+        OwnedCtx_(new ast::ASTContext),
+        Ctx_(OwnedCtx_.get()) {}
+
+  /**
+   * Parse tokens as another thread lexes them into the pipe. This parser is
+   * the pipe's only consumer.
+   */
+  explicit Parser(TokenPipe &Pipe)
+      : Lex_(Pipe.Buffer(), Pipe.File()),
+        Pipe_(&Pipe),
+        OwnedCtx_(new ast::ASTContext),
+        Ctx_(OwnedCtx_.get()) {}
 
+  /**
+   * Parse a whole module. The module takes ownership of every node created
+   * so far, and the parser starts a new ASTContext for anything parsed after.
+   */
   std::unique_ptr<ast::Module> Parse();
   std::unique_ptr<ast::Module> ParseModule();
-  std::unique_ptr<ast::FunctionDeclaration> ParseFunctionDeclaration();
-  std::unique_ptr<ast::ArgumentDeclaration> ParseArgumentDeclaration();
 
-  std::unique_ptr<ast::StringLiteral> ParseStringLiteral();
-  std::unique_ptr<ast::IntegerLiteral> ParseIntegerLiteral();
-  std::unique_ptr<ast::Expr> ParseIDExpr();
-  std::unique_ptr<ast::Type> ParseType();
+  /**
+   * Parse a whole module but only skim over function bodies, matching braces
+   * to find where each one ends. A body is parsed the first time it is asked
+   * for, and errors in it are reported by the module's BodySource instead of
+   * by this parser. The TokenStream must outlive the module.
+   *
+   * Bodies can only be skipped when parsing from a TokenStream. Otherwise this
+   * is the same as ParseModule().
+   */
+  std::unique_ptr<ast::Module> ParseLazy();
 
-  std::unique_ptr<ast::Expr> ParseExpr();
-  std::unique_ptr<ast::Expr> ParseIDExpr(Token idtok);
-  std::unique_ptr<ast::StringLiteral> ParseStringLiteral(Token inttok);
-  std::unique_ptr<ast::IntegerLiteral> ParseIntegerLiteral(Token strtok);
+  /**
+   * Parse a whole module from a TokenStream, with function bodies parsed in
+   * parallel on the pool. A quick skim over the tokens first finds where each
+   * function starts by matching braces. The functions are then split into
+   * NumChunks runs of about the same number of tokens, and each run is parsed
+   * by its own parser into its own ASTContext. If NumChunks is 0, four chunks
+   * are made per thread in the pool.
+   *
+   * The module is the same one ParseModule() would build. If the skim or any
+   * chunk fails, the whole stream is parsed again serially so errors are
+   * reported exactly as ParseModule() reports them.
+   */
+  std::unique_ptr<ast::Module> ParseParallel(ThreadPool &Pool,
+                                             unsigned NumChunks = 0);
 
-  std::unique_ptr<ast::Stmt> ParseStmt();
-  std::unique_ptr<ast::Stmt> ParseVarDeclOrIDExprStmt(Token idtok);
-  std::unique_ptr<ast::Stmt> ParseVarDecl(Token idtok);
+  /**
+   * Parse the buffer this parser was created on, which must be OldBuf with
+   * Edit applied, reusing every function of Old that the edit cannot have
+   * changed. Only the text from the start of the first function the edit
+   * touches to the start of the first untouched function after it is lexed
+   * and parsed again. Locations within a function are relative to its start,
+   * so reused functions are not touched at all; only the module's list of
+   * where each one starts moves. The module is the same one ParseModule()
+   * would build.
+   *
+   * Old is consumed. Every function parsed here gets a context of its own,
+   * and the new module only holds on to the contexts of the functions it
+   * uses, so a function that is replaced by a later edit is freed.
+   *
+   * If Old has deferred bodies, or the text around the edit does not parse on
+   * its own, the whole buffer is parsed with ParseModule() so errors are
+   * reported exactly as it reports them.
+   */
+  std::unique_ptr<ast::Module> Reparse(std::unique_ptr<ast::Module> Old,
+                                       const MemoryBuffer &OldBuf,
+                                       const TextEdit &Edit);
+
+  /**
+   * Parse the next top-level declaration without building a module. Each call
+   * first frees everything the parser allocated before it, so a caller that
+   * is done with one declaration before asking for the next can stream a
+   * file through with only as much AST memory as its largest declaration.
+   * Returns nullptr at the end of the input or on an error.
+   */
+  const ast::ExternalDeclaration *ParseNextDecl();
+
+  /**
+   * Same as ParseNextDecl() but the declaration is allocated in Ctx, which is
+   * not reset first. The declaration stays valid for as long as Ctx does.
+   */
+  const ast::ExternalDeclaration *ParseNextDecl(ast::ASTContext &Ctx);
+
+  /**
+   * Where the last declaration parsed starts in the buffer. The locations of
+   * its nodes are relative to this.
+   */
+  SourceLocation LastDeclLoc() const { return DeclStart_; }
+
+  /**
+   * The nodes returned by the remaining parse methods are allocated in the
+   * parser's ASTContext and are valid until the parser is destroyed or the
+   * next module is parsed.
+   */
+  ast::FunctionDeclaration *ParseFunctionDeclaration();
+  ast::ArgumentDeclaration *ParseArgumentDeclaration();
+
+  ast::StringLiteral *ParseStringLiteral();
+  ast::IntegerLiteral *ParseIntegerLiteral();
+  ast::Expr *ParseIDExpr();
+  ast::Type *ParseType();
+
+  ast::Expr *ParseExpr();
+  ast::Expr *ParseIDExpr(Token idtok);
+  ast::StringLiteral *ParseStringLiteral(Token inttok);
+  ast::IntegerLiteral *ParseIntegerLiteral(Token strtok);
+
+  ast::Stmt *ParseStmt();
+  ast::Stmt *ParseVarDeclOrIDExprStmt(Token idtok);
+  ast::Stmt *ParseVarDecl(Token idtok);
+
+  /**
+   * The context holding every node parsed since the last module or
+   * declaration was started.
+   */
+  const ast::ASTContext &Context() const { return *Ctx_; }
 
   enum ParserStatus Status() const { return Status_; }
   bool Ok() const { return Status_ == PSTAT_OK; }
   bool DebugOk() const;
+  /**
+   * The lexer is only advanced if the parser was not created from a
+   * TokenStream. Otherwise, lexer errors are reported by the stream.
+   */
   const Lexer &Lex() const { return Lex_; }
-  bool ReachedEOF() { return Lex_.ReachedEOF(); }
+  bool ReachedEOF() {
+    if (Pipe_) {
+      Token Tok;
+      return Pipe_->PeekToken(Tok) && Tok.Kind == TOK_EOF;
+    }
+    if (!Toks_) return Lex_.ReachedEOF();
+    return TokIdx_ < TokEnd_ && Toks_->Kind(TokIdx_) == TOK_EOF;
+  }
 
   /**
    * The last token read before an error is thrown.
    */
   Token LastReadTok() const { return LastReadTok_; }
 
+  /**
+   * Print the rules that were being parsed when the first error was hit,
+   * outermost first.
+   */
   void DumpParseStack(std::ostream &out) const {
     out << "Parse stack <";
-    for (const std::string &rule : ParserStack_) {
+    for (const char *rule : ErrStack_) {
       out << rule << "; ";
     }
     out << ">" << std::endl;
   }
 
  private:
-  bool ParseExprList(std::vector<std::unique_ptr<ast::Expr>> &ExprList);
-  bool ParseArgList(
-      std::vector<std::unique_ptr<ast::ArgumentDeclaration>> &ArgList);
-  bool ParseStmtList(std::vector<std::unique_ptr<ast::Stmt>> &StmtList);
+  friend class LazyBodyParser;
+
+#if LANG_PARSE_TRACE
+  /**
+   * Rules a loop stands in for, outermost first. Kept inline so tracking
+   * nested calls only allocates when they nest deeply.
+   */
+  using RuleStack = InlineStack<const char *, 8>;
+#else
+  struct RuleStack {
+    void Push(const char *) {}
+    void Pop() {}
+  };
+#endif
+
+  /**
+   * A rule on the parse stack. Frames live on the C++ stack and link to the
+   * frame of the enclosing rule, so tracking the stack never allocates. The
+   * names are only copied out when an error is hit. A frame made from a
+   * RuleStack stands for every rule on it at the time of the error.
+   */
+  class TraceFrame {
+   public:
+#if LANG_PARSE_TRACE
+    TraceFrame(Parser &P, const char *Rule)
+        : P_(P), Rule_(Rule), Rules_(nullptr), Parent_(P.Trace_) {
+      P.Trace_ = this;
+    }
+    TraceFrame(Parser &P, const RuleStack &Rules)
+        : P_(P), Rule_(nullptr), Rules_(&Rules), Parent_(P.Trace_) {
+      P.Trace_ = this;
+    }
+    ~TraceFrame() { P_.Trace_ = Parent_; }
+#else
+    TraceFrame(Parser &, const char *) {}
+    TraceFrame(Parser &, const RuleStack &) {}
+#endif
+    TraceFrame(const TraceFrame &) = delete;
+    TraceFrame &operator=(const TraceFrame &) = delete;
+
+   private:
+    friend class Parser;
+#if LANG_PARSE_TRACE
+    Parser &P_;
+    const char *Rule_;
+    const RuleStack *Rules_;
+    const TraceFrame *Parent_;
+#endif
+  };
+
+  /**
+   * Set the status to an error. The parse stack is saved on the first error
+   * so DumpParseStack shows where parsing actually failed.
+   */
+  void SetError(enum ParserStatus Err);
+
+  /**
+   * Hand every node parsed so far to a new module with the given top-level
+   * declarations, and start a new context for the parser. If DeclCtxs is
+   * given, it has the context holding each declaration.
+   */
+  std::unique_ptr<ast::Module> BuildModule(
+      const std::vector<const ast::ExternalDeclaration *> &ExternDecls,
+      const std::vector<SourceLocation> &DeclLocs,
+      std::vector<std::shared_ptr<const ast::ASTContext>> DeclCtxs = {});
+
+  /**
+   * The location of a token in the declaration being parsed.
+   */
+  SourceLocation LocInDecl(SourceLocation Loc) const {
+    return Loc - DeclStart_;
+  }
+
+  bool ParseFunctionBody(ArrayRef<const ast::Stmt *> &Body);
+
+  /**
+   * If the next token opens a body, set End to just past the brace that
+   * closes it without moving the parser. Returns false if there is no
+   * complete body to skip, in which case it should be parsed to report the
+   * error.
+   */
+  bool SkipFunctionBody(size_t &End);
+
+  /**
+   * Parse an expression without recursing into call arguments, so how deeply
+   * calls nest is only bounded by the heap. If IDTok is set, the expression
+   * starts with that ID, which was already read.
+   */
+  ast::Expr *ParseNestedExpr(const Token *IDTok);
+  bool ParseArgList(std::vector<const ast::ArgumentDeclaration *> &ArgList);
+  bool ParseStmtList(std::vector<const ast::Stmt *> &StmtList);
 
   // std::unique_ptr<Stmt> ParseVarDeclOrExprStmt();
 
@@ -80,10 +314,59 @@ class Parser {
   bool ReadAndCheckToken(enum TokenKind Expected);
   bool PeekAndCheckToken();
 
+  /**
+   * Read or peek the next token from the lexer, token stream or pipe.
+   */
+  bool NextToken(Token &Tok);
+  bool PeekNextToken(Token &Tok);
+
+  StringRef Text(const Token &Tok) const { return Lex_.Text(Tok); }
+
   Lexer Lex_;
+
+  // If either is set, tokens are read from there instead of Lex_.
+  const TokenStream *Toks_ = nullptr;
+  size_t TokIdx_ = 0;
+  size_t TokEnd_ = 0;
+  TokenPipe *Pipe_ = nullptr;
+
+  // New nodes go in Ctx_. This is the parser's own context except while
+  // parsing into one passed to ParseNextDecl().
+  std::unique_ptr<ast::ASTContext> OwnedCtx_;
+  ast::ASTContext *Ctx_;
+
+  // Set while parsing a module with deferred bodies, which hold on to it.
+  std::unique_ptr<LazyBodyParser> Lazy_;
+
+  // Where the declaration being parsed starts.
+  SourceLocation DeclStart_ = 0;
+
   enum ParserStatus Status_ = PSTAT_OK;
   Token LastReadTok_;
-  std::vector<std::string> ParserStack_;
+  const TraceFrame *Trace_ = nullptr;
+  std::vector<const char *> ErrStack_;
+};
+
+/**
+ * The BodySource for modules parsed by Parser::ParseLazy(). Each body is
+ * parsed by a parser of its own over the body's tokens, and every node goes in
+ * one context that lives as long as the module.
+ */
+class LazyBodyParser : public ast::BodySource {
+ public:
+  explicit LazyBodyParser(const TokenStream &Toks) : Toks_(Toks) {}
+  ~LazyBodyParser() override;
+
+  bool DebugOk() const override;
+
+ protected:
+  bool ParseBody(uint32_t Begin, uint32_t End, SourceLocation DeclStart,
+                 ArrayRef<const ast::Stmt *> &Body) override;
+
+ private:
+  const TokenStream &Toks_;
+  ast::ASTContext Ctx_;
+  std::unique_ptr<Parser> Failed_;
 };
 
 }  // namespace lang
@@ -0,0 +1,77 @@
+#include "Pipeline.h"
+
+#include <chrono>
+#include <thread>
+
+namespace lang {
+
+constexpr size_t Pipeline::kDeclQueueCapacity;
+
+namespace {
+
+void DumpStalls(std::ostream &out, const char *Stage, const StallStats &Stats,
+                double Total) {
+  out << "  " << Stage << ": " << Stats.Stalls << " stalls, " << Stats.Seconds
+      << "s (" << (Total ? 100 * Stats.Seconds / Total : 0) << "%)\n";
+}
+
+}  // namespace
+
+void PipelineStats::Dump(std::ostream &out) const {
+  out << NumDecls << " declarations in " << Seconds << "s\n";
+  DumpStalls(out, "lexer waiting on parser", LexerStalls, Seconds);
+  DumpStalls(out, "parser waiting on lexer", ParserTokenStalls, Seconds);
+  DumpStalls(out, "parser waiting on consumer", ParserDeclStalls, Seconds);
+  DumpStalls(out, "consumer waiting on parser", ConsumerStalls, Seconds);
+}
+
+void Pipeline::ParseAll() {
+  while (true) {
+    std::unique_ptr<ast::ASTContext> Ctx;
+    if (FreeCtxs_.TryPop(Ctx))
+      Ctx->Reset();
+    else
+      Ctx.reset(new ast::ASTContext);
+
+    ParsedDecl Parsed;
+    Parsed.Decl = Parser_.ParseNextDecl(*Ctx);
+    Parsed.Ctx = std::move(Ctx);
+    bool Last = !Parsed.Decl;
+    WaitFor([&] { return Decls_.TryPush(Parsed); }, Stats_.ParserDeclStalls);
+    if (Last) break;
+  }
+
+  // On an error the lexer may still be waiting to push more tokens.
+  Toks_.Cancel();
+}
+
+bool Pipeline::Run(
+    const std::function<void(const ast::ExternalDeclaration &)> &Consume) {
+  auto Start = std::chrono::steady_clock::now();
+  std::thread LexThread([this] { Toks_.LexAll(); });
+  std::thread ParseThread([this] { ParseAll(); });
+
+  while (true) {
+    ParsedDecl Parsed;
+    WaitFor([&] { return Decls_.TryPop(Parsed); }, Stats_.ConsumerStalls);
+    if (!Parsed.Decl) break;
+
+    Consume(*Parsed.Decl);
+    ++Stats_.NumDecls;
+
+    // If the parser already has plenty of contexts, this one is just freed.
+    FreeCtxs_.TryPush(Parsed.Ctx);
+  }
+
+  ParseThread.join();
+  LexThread.join();
+
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  Stats_.Seconds = Elapsed.count();
+  Stats_.LexerStalls = Toks_.ProducerStalls();
+  Stats_.ParserTokenStalls = Toks_.ConsumerStalls();
+  return Parser_.Ok();
+}
+
+}  // namespace lang
@@ -0,0 +1,86 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <functional>
+#include <memory>
+#include <ostream>
+
+#include "AST/ASTContext.h"
+#include "AST/ExternDecl.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "SPSCQueue.h"
+#include "TokenPipe.h"
+
+namespace lang {
+
+struct PipelineStats {
+  double Seconds = 0;
+  unsigned NumDecls = 0;
+
+  StallStats LexerStalls;        // Waiting for room in the token pipe.
+  StallStats ParserTokenStalls;  // Waiting for the next token.
+  StallStats ParserDeclStalls;   // Waiting for room in the declaration queue.
+  StallStats ConsumerStalls;     // Waiting for the next declaration.
+
+  void Dump(std::ostream &out) const;
+};
+
+/**
+ * Runs the front end as a three stage pipeline: a lexer thread feeds tokens
+ * through a TokenPipe to a parser thread, which hands each top-level
+ * declaration through a second queue to the calling thread. Both queues are
+ * bounded, so the amount of source in flight stays the same no matter how big
+ * the input is.
+ *
+ * Each declaration is parsed into its own ASTContext. Once the caller is done
+ * with it, the context goes back to the parser through a third queue to be
+ * reset and reused.
+ */
+class Pipeline {
+ public:
+  static constexpr size_t kDeclQueueCapacity = 64;
+
+  explicit Pipeline(const MemoryBuffer &Buf, FileID File = 0)
+      : Toks_(Buf, File),
+        Parser_(Toks_),
+        Decls_(kDeclQueueCapacity),
+        FreeCtxs_(kDeclQueueCapacity) {}
+
+  /**
+   * Call Consume on this thread with every top-level declaration, in source
+   * order, as they are parsed. A declaration is freed once Consume returns.
+   * Returns false if lexing or parsing failed, after consuming every
+   * declaration before the error.
+   */
+  bool Run(const std::function<void(const ast::ExternalDeclaration &)> &Consume);
+
+  /**
+   * Print why Run() failed. Returns true if it did not.
+   */
+  bool DebugOk() const { return Parser_.DebugOk(); }
+
+  const PipelineStats &Stats() const { return Stats_; }
+
+ private:
+  struct ParsedDecl {
+    // Null once there are no more declarations.
+    const ast::ExternalDeclaration *Decl = nullptr;
+    std::unique_ptr<ast::ASTContext> Ctx;
+  };
+
+  /**
+   * The parser thread.
+   */
+  void ParseAll();
+
+  TokenPipe Toks_;
+  Parser Parser_;
+  SPSCQueue<ParsedDecl> Decls_;
+  SPSCQueue<std::unique_ptr<ast::ASTContext>> FreeCtxs_;
+  PipelineStats Stats_;
+};
+
+}  // namespace lang
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace lang {
+
+/**
+ * A bounded, lock-free queue between exactly one producer thread and one
+ * consumer thread. Neither side ever blocks; TryPush() fails when the queue is
+ * full and TryPop() fails when it is empty, and the caller decides how to
+ * wait.
+ *
+ * Each side keeps a copy of the other side's index and only reloads the
+ * shared one when its copy says the queue is full or empty, so the two
+ * threads rarely touch the same cache line.
+ */
+template <class T>
+class SPSCQueue {
+ public:
+  /**
+   * The capacity is rounded up to a power of two.
+   */
+  explicit SPSCQueue(size_t Capacity) {
+    size_t Size = 1;
+    while (Size < Capacity) Size <<= 1;
+    Slots_.resize(Size);
+    Mask_ = Size - 1;
+  }
+
+  SPSCQueue(const SPSCQueue &) = delete;
+  SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+  /**
+   * Only called by the producer. The value is left untouched on failure.
+   */
+  bool TryPush(T &Val) {
+    size_t Tail = Tail_.load(std::memory_order_relaxed);
+    if (Tail - CachedHead_ == Slots_.size()) {
+      CachedHead_ = Head_.load(std::memory_order_acquire);
+      if (Tail - CachedHead_ == Slots_.size()) return false;
+    }
+    Slots_[Tail & Mask_] = std::move(Val);
+    Tail_.store(Tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Only called by the consumer.
+   */
+  bool TryPop(T &Val) {
+    size_t Head = Head_.load(std::memory_order_relaxed);
+    if (Head == CachedTail_) {
+      CachedTail_ = Tail_.load(std::memory_order_acquire);
+      if (Head == CachedTail_) return false;
+    }
+    Val = std::move(Slots_[Head & Mask_]);
+    Head_.store(Head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Capacity() const { return Slots_.size(); }
+
+ private:
+  std::vector<T> Slots_;
+  size_t Mask_;
+
+  // Written by the consumer.
+  alignas(64) std::atomic<size_t> Head_{0};
+  size_t CachedTail_ = 0;
+
+  // Written by the producer.
+  alignas(64) std::atomic<size_t> Tail_{0};
+  size_t CachedHead_ = 0;
+};
+
+/**
+ * How often, and for how long, one side of a queue had to wait on the other.
+ */
+struct StallStats {
+  uint64_t Stalls = 0;
+  double Seconds = 0;
+};
+
+/**
+ * Call TryOp until it returns true, yielding in between. Only waits that
+ * actually happen are timed, so the common case costs one call.
+ */
+template <class Op>
+void WaitFor(Op TryOp, StallStats &Stats) {
+  if (TryOp()) return;
+
+  auto Start = std::chrono::steady_clock::now();
+  do {
+    std::this_thread::yield();
+  } while (!TryOp());
+  std::chrono::duration<double> Waited =
+      std::chrono::steady_clock::now() - Start;
+  ++Stats.Stalls;
+  Stats.Seconds += Waited.count();
+}
+
+}  // namespace lang
+
+#endif
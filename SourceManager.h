@@ -0,0 +1,48 @@
+#ifndef SOURCEMANAGER_H_
+#define SOURCEMANAGER_H_
+
+#include <memory>
+#include <vector>
+
+#include "Lexer.h"
+#include "LineTable.h"
+#include "MemoryBuffer.h"
+#include "StringRef.h"
+
+namespace lang {
+
+/**
+ * Owns the buffers for every source file in a compilation. Tokens only refer
+ * to their source file by FileID, so their text is resolved through here.
+ */
+class SourceManager {
+ public:
+  FileID AddBuffer(std::unique_ptr<MemoryBuffer> Buf) {
+    Buffers_.push_back(std::move(Buf));
+    return Buffers_.size() - 1;
+  }
+
+  const MemoryBuffer &Buffer(FileID File) const { return *Buffers_[File]; }
+
+  StringRef Text(const Token &Tok) const {
+    return StringRef(Buffer(Tok.File).Begin() + Tok.Offset, Tok.Length);
+  }
+
+  /**
+   * The row and col of a location in a file. The file's line table is built
+   * on the first lookup.
+   */
+  LineCol Location(FileID File, SourceLocation Loc) const {
+    return Buffer(File).Lines().Lookup(Loc);
+  }
+  LineCol Location(const Token &Tok) const {
+    return Location(Tok.File, Tok.Offset);
+  }
+
+ private:
+  std::vector<std::unique_ptr<MemoryBuffer>> Buffers_;
+};
+
+}  // namespace lang
+
+#endif
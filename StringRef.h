@@ -0,0 +1,55 @@
+#ifndef STRINGREF_H_
+#define STRINGREF_H_
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace lang {
+
+/**
+ * A non-owning view of a sequence of characters, usually pointing into a
+ * MemoryBuffer. The underlying characters must outlive the StringRef.
+ */
+class StringRef {
+ public:
+  StringRef() : Data_(nullptr), Size_(0) {}
+  StringRef(const char *Data, size_t Size) : Data_(Data), Size_(Size) {}
+  StringRef(const char *Str) : Data_(Str), Size_(strlen(Str)) {}
+  StringRef(const std::string &Str) : Data_(Str.data()), Size_(Str.size()) {}
+
+  const char *Data() const { return Data_; }
+  size_t Size() const { return Size_; }
+  bool Empty() const { return Size_ == 0; }
+
+  const char *begin() const { return Data_; }
+  const char *end() const { return Data_ + Size_; }
+
+  char operator[](size_t i) const { return Data_[i]; }
+
+  /**
+   * Copy the characters into a new string. This should only be used when the
+   * string actually needs to be owned.
+   */
+  std::string Str() const { return std::string(Data_, Size_); }
+
+ private:
+  const char *Data_;
+  size_t Size_;
+};
+
+inline bool operator==(StringRef LHS, StringRef RHS) {
+  return LHS.Size() == RHS.Size() &&
+         (LHS.Size() == 0 || !memcmp(LHS.Data(), RHS.Data(), LHS.Size()));
+}
+
+inline bool operator!=(StringRef LHS, StringRef RHS) { return !(LHS == RHS); }
+
+inline std::ostream &operator<<(std::ostream &out, StringRef Str) {
+  return out.write(Str.Data(), Str.Size());
+}
+
+}  // namespace lang
+
+#endif
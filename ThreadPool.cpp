@@ -0,0 +1,55 @@
+#include "ThreadPool.h"
+
+namespace lang {
+
+ThreadPool::ThreadPool(unsigned NumThreads) {
+  if (!NumThreads) NumThreads = std::thread::hardware_concurrency();
+  if (!NumThreads) NumThreads = 1;
+  for (unsigned i = 0; i < NumThreads; ++i)
+    Workers_.emplace_back([this] { Work(); });
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    Stopping_ = true;
+  }
+  TaskAvailable_.notify_all();
+  for (std::thread &Worker : Workers_) Worker.join();
+}
+
+void ThreadPool::Async(std::function<void()> Task) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    Tasks_.push(std::move(Task));
+    ++Pending_;
+  }
+  TaskAvailable_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> Lock(Mutex_);
+  TasksDone_.wait(Lock, [this] { return Pending_ == 0; });
+}
+
+void ThreadPool::Work() {
+  while (true) {
+    std::function<void()> Task;
+    {
+      std::unique_lock<std::mutex> Lock(Mutex_);
+      TaskAvailable_.wait(Lock,
+                          [this] { return Stopping_ || !Tasks_.empty(); });
+      if (Tasks_.empty()) return;
+      Task = std::move(Tasks_.front());
+      Tasks_.pop();
+    }
+
+    Task();
+
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    if (--Pending_ == 0) TasksDone_.notify_all();
+  }
+}
+
+}  // namespace lang
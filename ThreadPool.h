@@ -0,0 +1,57 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace lang {
+
+/**
+ * A fixed set of worker threads that run queued tasks in FIFO order.
+ */
+class ThreadPool {
+ public:
+  /**
+   * If NumThreads is 0, one thread is created per hardware thread.
+   */
+  explicit ThreadPool(unsigned NumThreads = 0);
+
+  /**
+   * Waits for every queued task to finish before joining the workers.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void Async(std::function<void()> Task);
+
+  /**
+   * Block until every task queued so far has finished running.
+   */
+  void Wait();
+
+  unsigned NumThreads() const { return Workers_.size(); }
+
+ private:
+  void Work();
+
+  std::vector<std::thread> Workers_;
+  std::queue<std::function<void()>> Tasks_;
+
+  std::mutex Mutex_;
+  std::condition_variable TaskAvailable_;
+  std::condition_variable TasksDone_;
+
+  // Number of tasks queued or running.
+  unsigned Pending_ = 0;
+  bool Stopping_ = false;
+};
+
+}  // namespace lang
+
+#endif
@@ -0,0 +1,53 @@
+#include "TokenPipe.h"
+
+namespace lang {
+
+constexpr size_t TokenPipe::kDefaultCapacity;
+
+void TokenPipe::LexAll() {
+  Token Tok;
+  do {
+    if (!Lex_.ReadToken(Tok)) {
+      ErrOffset_ = Lex_.Offset();
+      break;
+    }
+    WaitFor(
+        [&] {
+          return Queue_.TryPush(Tok) ||
+                 Cancelled_.load(std::memory_order_relaxed);
+        },
+        ProducerStalls_);
+  } while (Tok.Kind != TOK_EOF && !Cancelled_.load(std::memory_order_relaxed));
+  Done_.store(true, std::memory_order_release);
+}
+
+bool TokenPipe::Fill() {
+  if (HasPeeked_) return true;
+
+  WaitFor(
+      [&] {
+        if (Queue_.TryPop(Peeked_)) return HasPeeked_ = true;
+        if (!Done_.load(std::memory_order_acquire)) return false;
+
+        // The producer may have pushed more tokens before finishing.
+        HasPeeked_ = Queue_.TryPop(Peeked_);
+        return true;
+      },
+      ConsumerStalls_);
+  return HasPeeked_;
+}
+
+bool TokenPipe::ReadToken(Token &Tok) {
+  if (!Fill()) return false;
+  Tok = Peeked_;
+  if (Tok.Kind != TOK_EOF) HasPeeked_ = false;
+  return true;
+}
+
+bool TokenPipe::PeekToken(Token &Tok) {
+  if (!Fill()) return false;
+  Tok = Peeked_;
+  return true;
+}
+
+}  // namespace lang
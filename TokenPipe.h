@@ -0,0 +1,91 @@
+#ifndef TOKENPIPE_H_
+#define TOKENPIPE_H_
+
+#include <atomic>
+#include <cstddef>
+
+#include "Lexer.h"
+#include "MemoryBuffer.h"
+#include "SPSCQueue.h"
+
+namespace lang {
+
+/**
+ * Hands tokens from a lexer running on one thread to a parser running on
+ * another. Unlike a TokenStream, only a bounded window of tokens exists at any
+ * time, and the parser can start before the lexer has finished.
+ */
+class TokenPipe {
+ public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  explicit TokenPipe(const MemoryBuffer &Buf, FileID File = 0,
+                     size_t Capacity = kDefaultCapacity)
+      : Lex_(Buf, File), Buf_(Buf), File_(File), Queue_(Capacity) {}
+
+  /**
+   * Lex the buffer into the pipe on the producer thread. This returns after
+   * pushing EOF, on the first lexer error, or once Cancel() is called.
+   */
+  void LexAll();
+
+  /**
+   * The consumer calls this once it will not read any more tokens, so a
+   * producer waiting on a full pipe can stop.
+   */
+  void Cancel() { Cancelled_.store(true, std::memory_order_relaxed); }
+
+  /**
+   * Read or peek the next token on the consumer thread, waiting for the
+   * producer if needed. Like Lexer::ReadToken(), these return false on a
+   * lexer error and keep returning EOF once it is reached.
+   */
+  bool ReadToken(Token &Tok);
+  bool PeekToken(Token &Tok);
+
+  const MemoryBuffer &Buffer() const { return Buf_; }
+  FileID File() const { return File_; }
+
+  /**
+   * Where the lexer stopped. Only valid once ReadToken() or PeekToken()
+   * returned false.
+   */
+  SourceLocation ErrOffset() const { return ErrOffset_; }
+
+  /**
+   * Waits by the producer on a full pipe and by the consumer on an empty one.
+   * Only read these once both threads are done.
+   */
+  const StallStats &ProducerStalls() const { return ProducerStalls_; }
+  const StallStats &ConsumerStalls() const { return ConsumerStalls_; }
+
+ private:
+  /**
+   * Make sure Peeked_ holds the next token. Returns false if the producer
+   * finished without one.
+   */
+  bool Fill();
+
+  // Only used by the producer.
+  Lexer Lex_;
+
+  const MemoryBuffer &Buf_;
+  FileID File_;
+  SPSCQueue<Token> Queue_;
+
+  // ErrOffset_ is written before Done_ is set and only read after it is seen.
+  std::atomic<bool> Done_{false};
+  std::atomic<bool> Cancelled_{false};
+  SourceLocation ErrOffset_ = 0;
+
+  // Only used by the consumer.
+  Token Peeked_;
+  bool HasPeeked_ = false;
+
+  StallStats ProducerStalls_;
+  StallStats ConsumerStalls_;
+};
+
+}  // namespace lang
+
+#endif
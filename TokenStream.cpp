@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CharScan.h"
+#include "TokenStream.h"
+
+namespace lang {
+
+namespace {
+
+/**
+ * Find where each chunk of the buffer starts for parallel lexing. Chunks
+ * start right after a newline that is not inside a string literal, so no token
+ * can span two chunks, and are roughly the same size. This only jumps between
+ * quotes, backslashes and newlines, so it is much cheaper than lexing.
+ *
+ * Strings are tracked the same way the lexer reads them. A backslash outside
+ * of a string is a lexer error, so nothing after it will be used and we just
+ * skip over it.
+ */
+std::vector<uint32_t> FindChunkStarts(const char *Begin, const char *End,
+                                      unsigned NumChunks) {
+  std::vector<uint32_t> Starts = {0};
+  const char *Ptr = Begin;
+  bool InString = false;
+  size_t Size = End - Begin;
+
+  for (unsigned i = 1; i < NumChunks && Ptr != End; ++i) {
+    const char *Target = Begin + Size * i / NumChunks;
+    while (Ptr != End) {
+      if (InString) {
+        Ptr = FindQuoteOrBackslash(Ptr, End);
+        if (Ptr == End) break;
+        if (*Ptr == '"') {
+          InString = false;
+          ++Ptr;
+        } else if (++Ptr != End) {
+          // Skip over the escaped character.
+          ++Ptr;
+        }
+        continue;
+      }
+
+      // Outside of a string, only a quote can change our state. Jump to the
+      // target first, then to the first newline after it.
+      const char *Stop = Target;
+      if (Ptr >= Target) {
+        Stop = static_cast<const char *>(memchr(Ptr, '\n', End - Ptr));
+        if (!Stop) Stop = End;
+      }
+
+      const char *Special = FindQuoteOrBackslash(Ptr, Stop);
+      if (Special != Stop) {
+        InString = *Special == '"';
+        Ptr = Special + 1;
+        continue;
+      }
+
+      if (Stop == Target && Ptr < Target) {
+        Ptr = Target;
+        continue;
+      }
+
+      Ptr = (Stop == End) ? End : Stop + 1;
+      break;
+    }
+
+    if (Ptr != End) Starts.push_back(Ptr - Begin);
+  }
+
+  return Starts;
+}
+
+}  // namespace
+
+bool TokenStream::LexAll() {
+  Lexer Lex(*Buf_, File_);
+  return LexFrom(Lex, Buf_->Size());
+}
+
+bool TokenStream::LexFrom(Lexer &Lex, size_t NumChars) {
+  // A rough guess of the average token size with surrounding whitespace so
+  // the arrays do not need to be regrown too many times.
+  size_t Estimate = NumChars / 4 + 1;
+  Kinds_.reserve(Estimate);
+  Offsets_.reserve(Estimate);
+  Lengths_.reserve(Estimate);
+  Syms_.reserve(Estimate);
+
+  Token Tok;
+  do {
+    if (!Lex.ReadToken(Tok)) {
+      HasError_ = true;
+      CharReadOnErr_ = Lex.CharReadOnErr();
+      ErrOffset_ = Lex.Offset();
+      return false;
+    }
+    Push(Tok);
+  } while (Tok.Kind != TOK_EOF);
+  return true;
+}
+
+bool TokenStream::LexAllParallel(ThreadPool &Pool, unsigned NumChunks) {
+  if (!NumChunks) NumChunks = Pool.NumThreads();
+  std::vector<uint32_t> Starts =
+      FindChunkStarts(Buf_->Begin(), Buf_->End(), NumChunks);
+  NumChunks = Starts.size();
+  Starts.push_back(Buf_->Size());
+
+  // Lex each chunk separately. Offsets are relative to the whole buffer, so
+  // the chunks can be copied into place as is.
+  std::vector<TokenStream> Chunks(NumChunks, TokenStream(*Buf_, File_));
+  for (unsigned i = 0; i < NumChunks; ++i) {
+    Pool.Async([this, i, &Starts, &Chunks] {
+      Lexer Lex(*Buf_, File_, Starts[i], Starts[i + 1]);
+      Chunks[i].LexFrom(Lex, Starts[i + 1] - Starts[i]);
+    });
+  }
+  Pool.Wait();
+
+  // Find where each chunk goes in the stitched stream. Every chunk but the
+  // last ends with its own EOF which is dropped. Nothing after the first
+  // error is kept, just like the serial lexer.
+  std::vector<size_t> TokStarts = {0};
+  unsigned NumUsed = 0;
+  while (NumUsed < NumChunks) {
+    const TokenStream &Chunk = Chunks[NumUsed++];
+    bool IsLast = NumUsed == NumChunks || Chunk.HasError();
+    TokStarts.push_back(TokStarts.back() + Chunk.Size() - (IsLast ? 0 : 1));
+    if (IsLast) break;
+  }
+
+  const TokenStream &LastChunk = Chunks[NumUsed - 1];
+  HasError_ = LastChunk.HasError();
+  if (HasError_) {
+    CharReadOnErr_ = LastChunk.CharReadOnErr();
+    ErrOffset_ = LastChunk.ErrOffset();
+  }
+
+  size_t NumToks = TokStarts.back();
+  Kinds_.resize(NumToks);
+  Offsets_.resize(NumToks);
+  Lengths_.resize(NumToks);
+  Syms_.resize(NumToks);
+
+  for (unsigned i = 0; i < NumUsed; ++i) {
+    Pool.Async([this, i, &TokStarts, &Chunks] {
+      const TokenStream &Chunk = Chunks[i];
+      size_t Dst = TokStarts[i];
+      size_t Count = TokStarts[i + 1] - Dst;
+      std::copy_n(Chunk.Kinds_.begin(), Count, Kinds_.begin() + Dst);
+      std::copy_n(Chunk.Offsets_.begin(), Count, Offsets_.begin() + Dst);
+      std::copy_n(Chunk.Lengths_.begin(), Count, Lengths_.begin() + Dst);
+      std::copy_n(Chunk.Syms_.begin(), Count, Syms_.begin() + Dst);
+    });
+  }
+  Pool.Wait();
+
+  return !HasError_;
+}
+
+bool TokenStream::operator==(const TokenStream &Other) const {
+  return Kinds_ == Other.Kinds_ && Offsets_ == Other.Offsets_ &&
+         Lengths_ == Other.Lengths_ && Syms_ == Other.Syms_ &&
+         HasError_ == Other.HasError_ &&
+         CharReadOnErr_ == Other.CharReadOnErr_ &&
+         ErrOffset_ == Other.ErrOffset_;
+}
+
+}  // namespace lang
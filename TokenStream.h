@@ -0,0 +1,108 @@
+#ifndef TOKENSTREAM_H_
+#define TOKENSTREAM_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Lexer.h"
+#include "MemoryBuffer.h"
+#include "StringRef.h"
+#include "ThreadPool.h"
+
+namespace lang {
+
+/**
+ * Every token of a buffer, lexed up front and stored as parallel arrays
+ * indexed by token number. The last token is TOK_EOF unless lexing stopped
+ * early on an error, in which case the error is recorded and the stream only
+ * holds the tokens before it.
+ */
+class TokenStream {
+ public:
+  explicit TokenStream(const MemoryBuffer &Buf, FileID File = 0)
+      : Buf_(&Buf), File_(File) {}
+
+  /**
+   * Lex every token out of the buffer. Returns false if lexing stopped on an
+   * error.
+   */
+  bool LexAll();
+
+  /**
+   * Same as LexAll() but splits the buffer into chunks that are lexed in
+   * parallel on the pool. The resulting stream is identical to the one
+   * LexAll() would produce. If NumChunks is 0, one chunk is made per thread in
+   * the pool.
+   */
+  bool LexAllParallel(ThreadPool &Pool, unsigned NumChunks = 0);
+
+  size_t Size() const { return Kinds_.size(); }
+
+  enum TokenKind Kind(size_t i) const {
+    return static_cast<enum TokenKind>(Kinds_[i]);
+  }
+  uint32_t Offset(size_t i) const { return Offsets_[i]; }
+  uint32_t Length(size_t i) const { return Lengths_[i]; }
+  Symbol Sym(size_t i) const { return Syms_[i]; }
+  StringRef Text(size_t i) const {
+    return StringRef(Buf_->Begin() + Offsets_[i], Lengths_[i]);
+  }
+
+  /**
+   * Rebuild the full token at an index.
+   */
+  Token Get(size_t i) const {
+    Token Tok;
+    Tok.Kind = Kind(i);
+    Tok.Offset = Offsets_[i];
+    Tok.Length = Lengths_[i];
+    Tok.File = File_;
+    Tok.Sym = Syms_[i];
+    return Tok;
+  }
+
+  void Push(const Token &Tok) {
+    Kinds_.push_back(Tok.Kind);
+    Offsets_.push_back(Tok.Offset);
+    Lengths_.push_back(Tok.Length);
+    Syms_.push_back(Tok.Sym);
+  }
+
+  const MemoryBuffer &Buffer() const { return *Buf_; }
+  FileID File() const { return File_; }
+
+  /**
+   * If lexing stopped on an error, these hold the same values the Lexer
+   * reported for it. The row and col are looked up in the buffer's line table.
+   */
+  bool HasError() const { return HasError_; }
+  int CharReadOnErr() const { return CharReadOnErr_; }
+  SourceLocation ErrOffset() const { return ErrOffset_; }
+  unsigned ErrRow() const { return Buf_->Lines().Lookup(ErrOffset_).Row; }
+  unsigned ErrCol() const { return Buf_->Lines().Lookup(ErrOffset_).Col; }
+
+  bool operator==(const TokenStream &Other) const;
+
+ private:
+  /**
+   * Append every token the lexer reads until EOF or an error. NumChars is
+   * the number of characters left to lex and is only used as a size hint.
+   */
+  bool LexFrom(Lexer &Lex, size_t NumChars);
+
+  const MemoryBuffer *Buf_;
+  FileID File_;
+
+  std::vector<uint8_t> Kinds_;
+  std::vector<uint32_t> Offsets_;
+  std::vector<uint32_t> Lengths_;
+  std::vector<Symbol> Syms_;
+
+  bool HasError_ = false;
+  int CharReadOnErr_ = 0;
+  SourceLocation ErrOffset_ = 0;
+};
+
+}  // namespace lang
+
+#endif
@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+
+#include "AST/Serialize.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::bench::Timer;
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+
+  Timer ParseT;
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) return 1;
+  double ParseSecs = ParseT.Seconds();
+
+  char Filename[] = "/tmp/BenchASTCacheXXXXXX";
+  int FD = mkstemp(Filename);
+  if (FD < 0) return 1;
+  close(FD);
+
+  Timer WriteT;
+  {
+    std::ofstream Out(Filename, std::ios::binary);
+    lang::ast::ASTWriter Writer(Out);
+    if (!Writer.Write(*Mod, lang::ast::HashSource(*Buf))) return 1;
+  }
+  double WriteSecs = WriteT.Seconds();
+
+  // This is everything the compiler does to reuse an AST file.
+  Timer LoadT;
+  uint64_t Hash = lang::ast::HashSource(*Buf);
+  double HashSecs = LoadT.Seconds();
+  std::unique_ptr<MemoryBuffer> File = MemoryBuffer::FromFile(Filename);
+  if (!File) return 1;
+  lang::ast::ASTReader Reader(*File);
+  std::unique_ptr<lang::ast::Module> Loaded = Reader.Read(Hash);
+  if (!Reader.DebugOk()) return 1;
+  double LoadSecs = LoadT.Seconds();
+
+  std::cout << "source: " << Buf->Size() / (1024 * 1024)
+            << "MB, AST file: " << File->Size() / (1024 * 1024) << "MB\n"
+            << "parse: " << ParseSecs << "s, write: " << WriteSecs << "s\n"
+            << "load: " << LoadSecs << "s (hash " << HashSecs << "s), "
+            << ParseSecs / LoadSecs << "x faster than parsing" << std::endl;
+
+  unlink(Filename);
+  return 0;
+}
@@ -0,0 +1,44 @@
+#include <sys/resource.h>
+#include <iostream>
+
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::bench::Timer;
+
+namespace {
+
+long PeakRSSKB() {
+  struct rusage Usage;
+  getrusage(RUSAGE_SELF, &Usage);
+  return Usage.ru_maxrss;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 500000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+  long BaseRSS = PeakRSSKB();
+
+  Timer ParseT;
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) return 1;
+  double ParseSecs = ParseT.Seconds();
+  size_t ArenaBytes = Mod->Context().BytesAllocated();
+
+  Timer FreeT;
+  Mod.reset();
+  double FreeSecs = FreeT.Seconds();
+
+  std::cout << "parse: " << ParseSecs << "s, free: " << FreeSecs
+            << "s, peak RSS: " << PeakRSSKB() / 1024 << "MB ("
+            << (PeakRSSKB() - BaseRSS) / 1024 << "MB over the source), arena: "
+            << ArenaBytes / (1024 * 1024) << "MB" << std::endl;
+  return 0;
+}
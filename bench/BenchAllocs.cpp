@@ -0,0 +1,68 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "AST/Dump.h"
+#include "AST/ExternDecl.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::bench::Timer;
+
+namespace {
+
+size_t NumAllocs = 0;
+size_t NumAllocBytes = 0;
+
+}  // namespace
+
+void *operator new(size_t Size) {
+  ++NumAllocs;
+  NumAllocBytes += Size;
+  if (void *Ptr = std::malloc(Size ? Size : 1)) return Ptr;
+  std::abort();
+}
+
+void operator delete(void *Ptr) noexcept { std::free(Ptr); }
+void operator delete(void *Ptr, size_t) noexcept { std::free(Ptr); }
+
+namespace {
+
+void Report(const char *Name, size_t Allocs, size_t Bytes, unsigned NumFuncs,
+            double Secs) {
+  std::cout << Name << ": " << Allocs << " allocations ("
+            << double(Allocs) / NumFuncs << " per function), " << Bytes
+            << " bytes, " << Secs << "s" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+
+  size_t StartAllocs = NumAllocs, StartBytes = NumAllocBytes;
+  Timer ParseT;
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) return 1;
+  Report("parse", NumAllocs - StartAllocs, NumAllocBytes - StartBytes,
+         NumFuncs, ParseT.Seconds());
+
+  // Walk every name in the tree. The stream has no buffer so nothing is
+  // actually written.
+  std::ostream Null(nullptr);
+  lang::ast::ASTDumper Dumper(Null);
+  StartAllocs = NumAllocs;
+  StartBytes = NumAllocBytes;
+  Timer DumpT;
+  Dumper.Visit(*Mod);
+  Report("dump", NumAllocs - StartAllocs, NumAllocBytes - StartBytes,
+         NumFuncs, DumpT.Seconds());
+
+  return 0;
+}
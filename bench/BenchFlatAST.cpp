@@ -0,0 +1,142 @@
+#include <iostream>
+
+#include "AST/Dump.h"
+#include "AST/ExternDecl.h"
+#include "AST/FlatAST.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::ast::FlatModule;
+using lang::ast::NodeRef;
+using lang::bench::Timer;
+
+namespace {
+
+/**
+ * Visits every node in the pointer tree and sums the leaves so the walk
+ * cannot be optimized away.
+ */
+class LeafSum : public lang::ast::RecursiveASTVisitor<LeafSum> {
+ public:
+  using lang::ast::RecursiveASTVisitor<LeafSum>::Visit;
+
+  void Visit(const lang::ast::ID &id) { Sum += id.Name().ID(); }
+  void Visit(const lang::ast::StringLiteral &str) { Sum += str.Value().Size(); }
+  void Visit(const lang::ast::IntegerLiteral &integer) {
+    Sum += integer.Value();
+  }
+  void Visit(const lang::ast::Typename &type) {
+    Sum += type.Name().ID();
+  }
+
+  uint64_t Sum = 0;
+};
+
+uint64_t FlatLeafSum(const FlatModule &Mod, NodeRef Ref) {
+  switch (Ref.Kind()) {
+    case lang::ast::FLAT_NONE:
+      return 0;
+    case lang::ast::FLAT_FUNC: {
+      const lang::ast::FlatFunc &Func = Mod.AsFunc(Ref);
+      uint64_t Sum = FlatLeafSum(Mod, Func.RetType);
+      for (NodeRef Arg : Mod.Children(Func.Args))
+        Sum += FlatLeafSum(Mod, Arg);
+      for (NodeRef S : Mod.Children(Func.Body)) Sum += FlatLeafSum(Mod, S);
+      return Sum;
+    }
+    case lang::ast::FLAT_ARG:
+      return FlatLeafSum(Mod, Mod.AsArg(Ref).Ty);
+    case lang::ast::FLAT_RETURN:
+      return FlatLeafSum(Mod, Mod.AsReturn(Ref).Value);
+    case lang::ast::FLAT_EXPR_STMT:
+      return FlatLeafSum(Mod, Mod.AsExprStmt(Ref).E);
+    case lang::ast::FLAT_VAR_DECL:
+      // Like RecursiveASTVisitor, skip the declared type.
+      return FlatLeafSum(Mod, Mod.AsVarDecl(Ref).Init);
+    case lang::ast::FLAT_CALL: {
+      const lang::ast::FlatCall &C = Mod.AsCall(Ref);
+      uint64_t Sum = FlatLeafSum(Mod, C.Caller);
+      for (NodeRef Arg : Mod.Children(C.Args))
+        Sum += FlatLeafSum(Mod, Arg);
+      return Sum;
+    }
+    case lang::ast::FLAT_ID:
+      return Mod.AsID(Ref).Name.ID();
+    case lang::ast::FLAT_STR:
+      return Mod.AsStr(Ref).Size;
+    case lang::ast::FLAT_INT:
+      return Mod.AsInt(Ref).Val;
+    case lang::ast::FLAT_TYPENAME:
+      return Mod.AsTypename(Ref).Name.ID();
+  }
+  return 0;
+}
+
+uint64_t FlatLeafSum(const FlatModule &Mod) {
+  uint64_t Sum = 0;
+  for (uint32_t i = 0; i < Mod.Funcs().size(); ++i)
+    Sum += FlatLeafSum(Mod, NodeRef(lang::ast::FLAT_FUNC, i));
+  return Sum;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // Each generated function is about 22 nodes, so this is just over 1M nodes.
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 50000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) return 1;
+
+  Timer BuildT;
+  FlatModule Flat = FlatModule::FromModule(*Mod);
+  double BuildSecs = BuildT.Seconds();
+
+  size_t NumNodes = Flat.NumNodes();
+  size_t TreeBytes = Mod->Context().BytesAllocated();
+  size_t FlatBytes = Flat.BytesAllocated();
+  std::cout << NumNodes << " nodes, flattened in " << BuildSecs << "s\n"
+            << "tree: " << TreeBytes << " bytes ("
+            << double(TreeBytes) / NumNodes << " per node)\n"
+            << "flat: " << FlatBytes << " bytes ("
+            << double(FlatBytes) / NumNodes << " per node)" << std::endl;
+
+  Timer TreeT;
+  LeafSum Sum;
+  Sum.Visit(*Mod);
+  double TreeSecs = TreeT.Seconds();
+
+  Timer FlatT;
+  uint64_t FlatSum = FlatLeafSum(Flat);
+  double FlatSecs = FlatT.Seconds();
+
+  if (Sum.Sum != FlatSum) {
+    std::cerr << "Traversals disagree: " << Sum.Sum << " vs " << FlatSum
+              << std::endl;
+    return 1;
+  }
+  std::cout << "traverse tree: " << TreeSecs << "s, flat: " << FlatSecs << "s"
+            << std::endl;
+
+  // The stream has no buffer so nothing is actually written.
+  std::ostream Null(nullptr);
+  Timer TreeDumpT;
+  lang::ast::ASTDumper Dumper(Null);
+  Dumper.Visit(*Mod);
+  double TreeDumpSecs = TreeDumpT.Seconds();
+
+  Timer FlatDumpT;
+  lang::ast::FlatASTDumper FlatDumper(Flat, Null);
+  FlatDumper.Dump();
+  double FlatDumpSecs = FlatDumpT.Seconds();
+
+  std::cout << "dump tree: " << TreeDumpSecs << "s, flat: " << FlatDumpSecs
+            << "s" << std::endl;
+  return 0;
+}
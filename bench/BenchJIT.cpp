@@ -0,0 +1,151 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "Backend.h"
+#include "CodeGen.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+#include "llvm/Support/FileSystem.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::bench::Timer;
+
+namespace {
+
+const unsigned kRuns = 5;
+
+// A main that prints one line, and a lot of functions it never calls.
+std::string GenerateProgram(unsigned NumFuncs) {
+  std::stringstream Src;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Src << "int func" << i << "() {\n"
+        << "  printf(\"%d %s\\n\", " << i << ", \"str\");\n"
+        << "  return " << i << ";\n"
+        << "}\n";
+  }
+  Src << "int main() {\n"
+      << "  printf(\"hello world\\n\");\n"
+      << "  return 0;\n"
+      << "}\n";
+  return Src.str();
+}
+
+std::unique_ptr<llvm::TargetMachine> TargetMachine(bool PIC) {
+  lang::TargetSpec Spec;
+  Spec.PIC = PIC;
+  std::string Error;
+  std::unique_ptr<llvm::TargetMachine> TM =
+      lang::CreateTargetMachine(Spec, lang::OptLevel(), Error);
+  if (!TM) {
+    std::cerr << "Cannot find target: " << Error << std::endl;
+    _exit(1);
+  }
+  return TM;
+}
+
+/**
+ * Compile and run the program the way --run does. Runs in the child.
+ */
+void RunJIT(const MemoryBuffer &Buf) {
+  Parser Parse(Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) _exit(1);
+  llvm::LLVMContext Context;
+  lang::CodeGen Generator("bench", Context);
+  Generator.Visit(*Mod);
+
+  std::unique_ptr<llvm::TargetMachine> TM = TargetMachine(/*PIC=*/true);
+  lang::OptimizeModule(Generator.Module(), *TM, lang::OptLevel());
+  lang::TargetSpec Spec;
+  Spec.PIC = true;
+  int ExitCode;
+  std::string Error;
+  if (!lang::RunMain(Generator.ReleaseModule(), Spec, lang::OptLevel(),
+                     /*NumThreads=*/0, ExitCode, Error))
+    _exit(1);
+  fflush(stdout);
+  _exit(ExitCode);
+}
+
+/**
+ * Compile the program to an object file, link it and run it. Runs in the
+ * child.
+ */
+void RunObject(const MemoryBuffer &Buf) {
+  Parser Parse(Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) _exit(1);
+  llvm::LLVMContext Context;
+  lang::CodeGen Generator("bench", Context);
+  Generator.Visit(*Mod);
+
+  std::unique_ptr<llvm::TargetMachine> TM = TargetMachine(/*PIC=*/false);
+  lang::OptimizeModule(Generator.Module(), *TM, lang::OptLevel());
+  std::string Obj = "/tmp/bench-jit.o";
+  std::error_code EC;
+  llvm::raw_fd_ostream Out(Obj, EC, llvm::sys::fs::F_None);
+  if (EC || !lang::EmitObjectFile(Generator.Module(), *TM, Out)) _exit(1);
+  Out.close();
+
+  std::string Exe = "/tmp/bench-jit";
+  std::string Link = "cc -no-pie " + Obj + " -o " + Exe;
+  if (system(Link.c_str())) _exit(1);
+  execl(Exe.c_str(), Exe.c_str(), nullptr);
+  _exit(1);
+}
+
+/**
+ * Seconds from starting to compile until the program's first output arrives.
+ */
+double SecondsToFirstOutput(const MemoryBuffer &Buf, bool JIT) {
+  int Pipe[2];
+  if (pipe(Pipe)) exit(1);
+  Timer T;
+  pid_t Pid = fork();
+  if (Pid < 0) exit(1);
+  if (!Pid) {
+    close(Pipe[0]);
+    dup2(Pipe[1], STDOUT_FILENO);
+    if (JIT)
+      RunJIT(Buf);
+    else
+      RunObject(Buf);
+  }
+
+  close(Pipe[1]);
+  char C;
+  if (read(Pipe[0], &C, 1) != 1) exit(1);
+  double Seconds = T.Seconds();
+  while (read(Pipe[0], &C, 1) == 1) {
+  }
+  close(Pipe[0]);
+
+  int Status;
+  waitpid(Pid, &Status, 0);
+  if (!WIFEXITED(Status) || WEXITSTATUS(Status)) exit(1);
+  return Seconds;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 20000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(GenerateProgram(NumFuncs));
+
+  for (bool JIT : {false, true}) {
+    double Min = 1e9;
+    for (unsigned i = 0; i < kRuns; ++i)
+      Min = std::min(Min, SecondsToFirstOutput(*Buf, JIT));
+    std::cout << (JIT ? "jit: " : "object and link: ") << Min
+              << "s to first output" << std::endl;
+  }
+  return 0;
+}
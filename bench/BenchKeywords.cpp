@@ -0,0 +1,107 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "KeywordTable.h"
+#include "StringRef.h"
+#include "bench/BenchUtil.h"
+
+using lang::KeywordEntry;
+using lang::StringRef;
+using lang::bench::Timer;
+
+namespace {
+
+// A small language's 8 keywords, about what the lexer will have once the
+// parser handles control flow and structs.
+constexpr KeywordEntry<int> LexerKeywords[] = {
+    {"return", 1}, {"if", 2},    {"else", 3},     {"while", 4},
+    {"for", 5},    {"break", 6}, {"continue", 7}, {"struct", 8},
+};
+
+// A 30 keyword set along the lines of what C has.
+constexpr KeywordEntry<int> CKeywords[] = {
+    {"auto", 1},      {"break", 2},    {"case", 3},      {"char", 4},
+    {"const", 5},     {"continue", 6}, {"default", 7},   {"do", 8},
+    {"double", 9},    {"else", 10},    {"enum", 11},     {"extern", 12},
+    {"float", 13},    {"for", 14},     {"goto", 15},     {"if", 16},
+    {"int", 17},      {"long", 18},    {"register", 19}, {"return", 20},
+    {"short", 21},    {"signed", 22},  {"sizeof", 23},   {"static", 24},
+    {"struct", 25},   {"switch", 26},  {"typedef", 27},  {"union", 28},
+    {"unsigned", 29}, {"void", 30},
+};
+
+constexpr auto LexerTable = lang::MakeKeywordTable(LexerKeywords, 0);
+constexpr auto CTable = lang::MakeKeywordTable(CKeywords, 0);
+static_assert(LexerTable.Valid(), "Lexer keywords cannot be perfectly hashed");
+static_assert(CTable.Valid(), "C keywords cannot be perfectly hashed");
+
+/**
+ * What TokenKindFromStr() used to do: compare against every keyword in turn.
+ * The lengths are computed up front like they would be for string literals.
+ */
+template <size_t N>
+class CompareChain {
+ public:
+  explicit CompareChain(const KeywordEntry<int> (&Keywords)[N]) {
+    for (const auto &Keyword : Keywords)
+      Keywords_.emplace_back(StringRef(Keyword.Spelling), Keyword.Value);
+  }
+
+  int Lookup(StringRef Str) const {
+    for (const auto &Keyword : Keywords_)
+      if (Str == Keyword.first) return Keyword.second;
+    return 0;
+  }
+
+ private:
+  std::vector<std::pair<StringRef, int>> Keywords_;
+};
+
+/**
+ * Identifiers in the same proportions as the generated benchmark source,
+ * with a keyword every few words.
+ */
+std::vector<std::string> GenerateWords(unsigned NumFuncs) {
+  std::vector<std::string> Words;
+  const char *Keywords[] = {"return", "if", "while", "for", "struct"};
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    for (const char *Word : {"int", "a", "char", "b", "x", "int", "printf",
+                             "x", "a", "b"})
+      Words.push_back(Word);
+    Words.push_back("func" + std::to_string(i));
+    Words.push_back("call" + std::to_string(i));
+    Words.push_back(Keywords[i % 5]);
+  }
+  return Words;
+}
+
+template <class TableT>
+void Run(const char *Name, const TableT &Table,
+         const std::vector<StringRef> &Words, unsigned Repeat) {
+  Timer T;
+  size_t Sum = 0;
+  for (unsigned r = 0; r < Repeat; ++r)
+    for (StringRef Word : Words) Sum += Table.Lookup(Word);
+  double Secs = T.Seconds();
+  std::cout << Name << ": " << Secs * 1e9 / (Words.size() * Repeat)
+            << " ns/lookup (checksum " << Sum << ")" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 100000);
+  std::vector<std::string> Strs = GenerateWords(NumFuncs);
+  std::vector<StringRef> Words(Strs.begin(), Strs.end());
+  const unsigned Repeat = 10;
+
+  Run("8 keywords, compare chain", CompareChain<8>(LexerKeywords), Words,
+      Repeat);
+  Run("8 keywords, perfect hash", LexerTable, Words, Repeat);
+  Run("30 keywords, compare chain", CompareChain<30>(CKeywords), Words,
+      Repeat);
+  Run("30 keywords, perfect hash", CTable, Words, Repeat);
+
+  return 0;
+}
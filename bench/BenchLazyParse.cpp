@@ -0,0 +1,56 @@
+#include <iostream>
+
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "TokenStream.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::TokenStream;
+using lang::ast::FunctionDeclaration;
+using lang::bench::Timer;
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+  TokenStream Toks(*Buf);
+  if (!Toks.LexAll()) return 1;
+
+  double EagerSecs;
+  {
+    Parser Parse(Toks);
+    Timer T;
+    std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+    EagerSecs = T.Seconds();
+    if (!Parse.DebugOk()) return 1;
+    std::cout << "eager: " << EagerSecs << "s, "
+              << Mod->Context().BytesAllocated() / 1024 << "KB of AST"
+              << std::endl;
+  }
+
+  {
+    Parser Parse(Toks);
+    Timer T;
+    std::unique_ptr<lang::ast::Module> Mod = Parse.ParseLazy();
+    double Secs = T.Seconds();
+    if (!Parse.DebugOk()) return 1;
+    std::cout << "signatures only: " << Secs << "s (" << EagerSecs / Secs
+              << "x eager), " << Mod->Context().BytesAllocated() / 1024
+              << "KB of AST" << std::endl;
+
+    // Asking for every body costs the rest of the parse.
+    Timer BodiesT;
+    size_t NumStmts = 0;
+    for (const lang::ast::ExternalDeclaration *Decl : Mod->ExternDecls())
+      NumStmts += lang::cast<FunctionDeclaration>(Decl)->Body().Size();
+    double BodiesSecs = BodiesT.Seconds();
+    if (!Mod->Bodies()->DebugOk()) return 1;
+    std::cout << "then every body: " << BodiesSecs << "s (" << NumStmts
+              << " statements), total " << Secs + BodiesSecs << "s"
+              << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <sstream>
+
+#include "CharScan.h"
+#include "Lexer.h"
+#include "MemoryBuffer.h"
+#include "bench/BenchUtil.h"
+
+using lang::Lexer;
+using lang::MemoryBuffer;
+using lang::Token;
+using lang::bench::Timer;
+
+namespace {
+
+/**
+ * Lex every token and return the number of tokens read, or 0 on a lexer
+ * error.
+ */
+size_t LexAll(Lexer &Lex) {
+  size_t NumToks = 0;
+  Token Tok;
+  do {
+    if (!Lex.ReadToken(Tok)) return 0;
+    ++NumToks;
+  } while (Tok.Kind != lang::TOK_EOF);
+  return NumToks;
+}
+
+void Report(const char *Name, size_t NumToks, size_t NumBytes, double Secs) {
+  std::cout << Name << ": " << NumToks << " tokens in " << Secs << "s ("
+            << NumToks / Secs << " tokens/sec, "
+            << NumBytes / Secs / (1024 * 1024) << " MB/sec)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::string Src = lang::bench::GenerateSource(NumFuncs);
+
+  {
+    // The stream is copied into a buffer owned by the lexer, so include that
+    // in the time.
+    std::stringstream Input(Src);
+    Timer T;
+    Lexer Lex(Input);
+    size_t NumToks = LexAll(Lex);
+    Report("istream", NumToks, Src.size(), T.Seconds());
+  }
+
+  // The buffer path with each of the character scanning kernels the host
+  // supports.
+  const std::pair<lang::ScanImpl, const char *> Impls[] = {
+      {lang::SCAN_SCALAR, "buffer (scalar)"},
+      {lang::SCAN_SSE2, "buffer (sse2)"},
+      {lang::SCAN_AVX2, "buffer (avx2)"},
+  };
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(Src);
+  for (const auto &Impl : Impls) {
+    if (!lang::SetScanImpl(Impl.first)) continue;
+    Lexer Lex(*Buf);
+    Timer T;
+    size_t NumToks = LexAll(Lex);
+    Report(Impl.second, NumToks, Src.size(), T.Seconds());
+  }
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "Backend.h"
+#include "CodeGen.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+#include "llvm/Support/FileSystem.h"
+
+using lang::MemoryBuffer;
+using lang::OptLevel;
+using lang::Parser;
+using lang::bench::Timer;
+
+namespace {
+
+const unsigned kRuns = 5;
+
+// CodeGen can only call printf, so the generated program is one long main
+// whose calls feed each other's return values.
+std::string GenerateProgram(unsigned NumCalls) {
+  std::stringstream Src;
+  Src << "int main() {\n";
+  for (unsigned i = 0; i < NumCalls; ++i) {
+    Src << "  printf(\"%d %d\\n\", " << i << ", printf(\"call " << i
+        << " \"));\n";
+  }
+  Src << "  return 0;\n"
+      << "}\n";
+  return Src.str();
+}
+
+/**
+ * Fastest of a few runs of the executable with its output thrown away.
+ */
+double RunSeconds(const std::string &Exe) {
+  double Min = 1e9;
+  for (unsigned i = 0; i < kRuns; ++i) {
+    Timer T;
+    pid_t Pid = fork();
+    if (Pid < 0) return -1;
+    if (!Pid) {
+      if (!freopen("/dev/null", "w", stdout)) _exit(1);
+      execl(Exe.c_str(), Exe.c_str(), nullptr);
+      _exit(1);
+    }
+    int Status;
+    waitpid(Pid, &Status, 0);
+    if (!WIFEXITED(Status) || WEXITSTATUS(Status)) return -1;
+    Min = std::min(Min, T.Seconds());
+  }
+  return Min;
+}
+
+void Run(const MemoryBuffer &Buf, const std::string &Name) {
+  for (const char *LevelStr : {"0", "1", "2", "3", "s"}) {
+    OptLevel Level;
+    OptLevel::Parse(LevelStr, Level);
+
+    Timer CompileTime;
+    Parser Parse(Buf);
+    std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+    if (!Parse.DebugOk()) exit(1);
+    llvm::LLVMContext Context;
+    lang::CodeGen Generator("bench", Context);
+    Generator.Visit(*Mod);
+
+    std::string Error;
+    std::unique_ptr<llvm::TargetMachine> TM =
+        lang::CreateTargetMachine(lang::TargetSpec(), Level, Error);
+    if (!TM) {
+      std::cerr << "Cannot find target: " << Error << std::endl;
+      exit(1);
+    }
+    lang::OptimizeModule(Generator.Module(), *TM, Level);
+
+    std::string Obj = "/tmp/bench-opt-levels.o";
+    std::error_code EC;
+    llvm::raw_fd_ostream Out(Obj, EC, llvm::sys::fs::F_None);
+    if (EC || !lang::EmitObjectFile(Generator.Module(), *TM, Out)) exit(1);
+    double CompileSeconds = CompileTime.Seconds();
+    uint64_t ObjBytes = Out.tell();
+    Out.close();
+
+    std::string Exe = "/tmp/bench-opt-levels";
+    std::string Link = "cc -no-pie " + Obj + " -o " + Exe;
+    if (system(Link.c_str())) exit(1);
+    double RunTime = RunSeconds(Exe);
+
+    std::cout << Name << " -O" << LevelStr << ": compile " << CompileSeconds
+              << "s, object " << ObjBytes << " bytes, run " << RunTime << "s"
+              << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumCalls = lang::bench::NumFuncsFromArgs(argc, argv, 5000);
+
+  std::unique_ptr<MemoryBuffer> HelloWorld =
+      MemoryBuffer::FromFile("examples/hello_world.lang");
+  if (HelloWorld) Run(*HelloWorld, "hello_world");
+
+  std::unique_ptr<MemoryBuffer> Program =
+      MemoryBuffer::FromString(GenerateProgram(NumCalls));
+  Run(*Program, "generated");
+  return 0;
+}
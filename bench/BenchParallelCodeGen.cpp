@@ -0,0 +1,104 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "Backend.h"
+#include "CodeGen.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+#include "llvm/Support/FileSystem.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::bench::Timer;
+
+namespace {
+
+const char kObjectFile[] = "/tmp/bench-parallel-codegen.o";
+
+// GenerateSource() uses features CodeGen does not lower yet.
+std::string GenerateLowerableSource(unsigned NumFuncs) {
+  std::stringstream Src;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Src << "int func" << i << "() {\n"
+        << "  printf(\"value of func" << i << "\\n\");\n"
+        << "  printf(\"%d %s\\n\", " << i << ", printf(\"nested\"));\n"
+        << "  return " << i << ";\n"
+        << "}\n";
+  }
+  return Src.str();
+}
+
+std::unique_ptr<lang::CodeGen> Lower(const lang::ast::Module &Mod,
+                                     llvm::LLVMContext &Context) {
+  std::unique_ptr<lang::CodeGen> Generator(
+      new lang::CodeGen("bench", Context));
+  Generator->Visit(Mod);
+  return Generator;
+}
+
+std::string ReadObjectFile() {
+  std::ifstream In(kObjectFile, std::ios::binary);
+  std::stringstream Contents;
+  Contents << In.rdbuf();
+  return Contents.str();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 10000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(GenerateLowerableSource(NumFuncs));
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) return 1;
+
+  lang::OptLevel Level;
+  lang::OptLevel::Parse("2", Level);
+  lang::TargetSpec Spec;
+  std::string Error;
+  llvm::LLVMContext Context;
+
+  {
+    std::unique_ptr<lang::CodeGen> Generator = Lower(*Mod, Context);
+    Timer T;
+    std::unique_ptr<llvm::TargetMachine> TM =
+        lang::CreateTargetMachine(Spec, Level, Error);
+    if (!TM) return 1;
+    lang::OptimizeModule(Generator->Module(), *TM, Level);
+    std::error_code EC;
+    llvm::raw_fd_ostream Out(kObjectFile, EC, llvm::sys::fs::F_None);
+    if (EC || !lang::EmitObjectFile(Generator->Module(), *TM, Out)) return 1;
+    std::cout << "whole module: " << T.Seconds() << "s" << std::endl;
+  }
+
+  std::string Expected;
+  double OneThreadSecs = 0;
+  unsigned MaxThreads = std::thread::hardware_concurrency();
+  if (!MaxThreads) MaxThreads = 1;
+  for (unsigned NumThreads = 1; NumThreads <= MaxThreads; NumThreads *= 2) {
+    std::unique_ptr<lang::CodeGen> Generator = Lower(*Mod, Context);
+    Timer T;
+    if (!lang::EmitObjectFileParallel(Generator->ReleaseModule(), Spec, Level,
+                                      NumThreads, kObjectFile, Error)) {
+      std::cerr << Error << std::endl;
+      return 1;
+    }
+    double Secs = T.Seconds();
+    if (NumThreads == 1) {
+      OneThreadSecs = Secs;
+      Expected = ReadObjectFile();
+    } else if (ReadObjectFile() != Expected) {
+      std::cerr << "The object file changed with the number of threads"
+                << std::endl;
+      return 1;
+    }
+    std::cout << NumThreads << " threads: " << Secs << "s ("
+              << OneThreadSecs / Secs << "x 1 thread)" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,42 @@
+#include <iostream>
+#include <thread>
+
+#include "MemoryBuffer.h"
+#include "ThreadPool.h"
+#include "TokenStream.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::ThreadPool;
+using lang::TokenStream;
+using lang::bench::Timer;
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 500000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+
+  TokenStream Serial(*Buf);
+  Timer SerialT;
+  if (!Serial.LexAll()) return 1;
+  double SerialSecs = SerialT.Seconds();
+  std::cout << "serial: " << SerialSecs << "s" << std::endl;
+
+  unsigned MaxThreads = std::thread::hardware_concurrency();
+  if (!MaxThreads) MaxThreads = 1;
+  for (unsigned NumThreads = 1; NumThreads <= MaxThreads; NumThreads *= 2) {
+    ThreadPool Pool(NumThreads);
+    TokenStream Parallel(*Buf);
+    Timer T;
+    if (!Parallel.LexAllParallel(Pool)) return 1;
+    double Secs = T.Seconds();
+    if (!(Parallel == Serial)) {
+      std::cerr << "Parallel lexing did not match serial lexing" << std::endl;
+      return 1;
+    }
+    std::cout << NumThreads << " threads: " << Secs << "s ("
+              << SerialSecs / Secs << "x serial)" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "AST/Dump.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "ThreadPool.h"
+#include "TokenStream.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::ThreadPool;
+using lang::TokenStream;
+using lang::bench::Timer;
+
+namespace {
+
+std::string DumpModule(const lang::ast::Module &Mod) {
+  std::stringstream Out;
+  lang::ast::ASTDumper Dumper(Out);
+  Dumper.Visit(Mod);
+  return Out.str();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+  TokenStream Toks(*Buf);
+  if (!Toks.LexAll()) return 1;
+
+  Parser Serial(Toks);
+  Timer SerialT;
+  std::unique_ptr<lang::ast::Module> Expected = Serial.Parse();
+  double SerialSecs = SerialT.Seconds();
+  if (!Serial.DebugOk()) return 1;
+  std::cout << "serial: " << SerialSecs << "s" << std::endl;
+  std::string ExpectedDump = DumpModule(*Expected);
+
+  unsigned MaxThreads = std::thread::hardware_concurrency();
+  if (!MaxThreads) MaxThreads = 1;
+  for (unsigned NumThreads = 1; NumThreads <= MaxThreads; NumThreads *= 2) {
+    ThreadPool Pool(NumThreads);
+    Parser Parse(Toks);
+    Timer T;
+    std::unique_ptr<lang::ast::Module> Mod = Parse.ParseParallel(Pool);
+    double Secs = T.Seconds();
+    if (!Parse.DebugOk()) return 1;
+    if (DumpModule(*Mod) != ExpectedDump) {
+      std::cerr << "Parallel parsing did not match serial parsing"
+                << std::endl;
+      return 1;
+    }
+    std::cout << NumThreads << " threads: " << Secs << "s ("
+              << SerialSecs / Secs << "x serial)" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,44 @@
+#include <iostream>
+
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "TokenStream.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::TokenStream;
+using lang::bench::Timer;
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+
+  {
+    Timer T;
+    Parser Parse(*Buf);
+    std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+    if (!Parse.DebugOk()) return 1;
+    std::cout << "on-demand lex + parse: " << T.Seconds() << "s" << std::endl;
+  }
+
+  {
+    Timer LexT;
+    TokenStream Toks(*Buf);
+    if (!Toks.LexAll()) return 1;
+    double LexSecs = LexT.Seconds();
+
+    Timer ParseT;
+    Parser Parse(Toks);
+    std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+    if (!Parse.DebugOk()) return 1;
+    double ParseSecs = ParseT.Seconds();
+
+    std::cout << "pre-tokenized: lex " << LexSecs << "s ("
+              << Toks.Size() / LexSecs << " tokens/sec) + parse " << ParseSecs
+              << "s = " << LexSecs + ParseSecs << "s" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <sstream>
+
+#include "CodeGen.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "Pipeline.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::bench::Timer;
+
+namespace {
+
+// GenerateSource() uses features CodeGen does not lower yet.
+std::string GenerateLowerableSource(unsigned NumFuncs) {
+  std::stringstream Src;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Src << "int func" << i << "() {\n"
+        << "  printf(\"value of func" << i << "\\n\");\n"
+        << "  printf(\"%d %s\\n\", " << i << ", \"str \\\"quoted\\\"\");\n"
+        << "  return " << i << ";\n"
+        << "}\n";
+  }
+  return Src.str();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(GenerateLowerableSource(NumFuncs));
+  double MB = double(Buf->Size()) / (1024 * 1024);
+
+  // Lowering is the same in both modes, so the printed IR must match.
+  std::string SerialIR;
+  {
+    Timer T;
+    llvm::LLVMContext Context;
+    lang::CodeGen Generator("bench", Context);
+    Parser Parse(*Buf);
+    while (const lang::ast::ExternalDeclaration *Decl = Parse.ParseNextDecl())
+      Generator.Visit(*Decl);
+    if (!Parse.DebugOk()) return 1;
+    double Secs = T.Seconds();
+    std::cout << "serial: " << Secs << "s (" << MB / Secs << " MB/s)"
+              << std::endl;
+
+    llvm::raw_string_ostream IR(SerialIR);
+    Generator.Module().print(IR, nullptr);
+  }
+
+  std::string PipelineIR;
+  {
+    Timer T;
+    llvm::LLVMContext Context;
+    lang::CodeGen Generator("bench", Context);
+    lang::Pipeline Pipe(*Buf);
+    Pipe.Run([&](const lang::ast::ExternalDeclaration &Decl) {
+      Generator.Visit(Decl);
+    });
+    if (!Pipe.DebugOk()) return 1;
+    double Secs = T.Seconds();
+    std::cout << "pipeline: " << Secs << "s (" << MB / Secs << " MB/s)"
+              << std::endl;
+    Pipe.Stats().Dump(std::cout);
+
+    llvm::raw_string_ostream IR(PipelineIR);
+    Generator.Module().print(IR, nullptr);
+  }
+
+  if (SerialIR != PipelineIR) {
+    std::cerr << "Pipeline output differs from the serial output" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include <iostream>
+
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::TextEdit;
+using lang::bench::Timer;
+
+int main(int argc, char **argv) {
+  // Each generated function is six lines, so this is about 100k lines.
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 17000);
+  std::string Src = lang::bench::GenerateSource(NumFuncs);
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(Src);
+
+  // Typing one character at the start, middle and end of the file. The
+  // earlier the edit, the more reused nodes have to be moved.
+  std::string Mid = "func" + std::to_string(NumFuncs / 2) + "(";
+  std::string Last = "func" + std::to_string(NumFuncs - 1) + "(";
+  struct {
+    const char *Name;
+    TextEdit Edit;
+  } Edits[] = {
+      {"start", {static_cast<uint32_t>(Src.find("12345")), 0, "6"}},
+      {"middle",
+       {static_cast<uint32_t>(Src.find("12345", Src.find(Mid))), 0, "6"}},
+      {"end",
+       {static_cast<uint32_t>(Src.find("12345", Src.find(Last))), 0, "6"}},
+  };
+
+  for (auto &E : Edits) {
+    std::unique_ptr<MemoryBuffer> NewBuf =
+        MemoryBuffer::FromEdit(*Buf, E.Edit);
+
+    Parser Full(*NewBuf);
+    Timer FullT;
+    std::unique_ptr<lang::ast::Module> Expected = Full.Parse();
+    double FullSecs = FullT.Seconds();
+    if (!Full.DebugOk()) return 1;
+
+    std::unique_ptr<lang::ast::Module> Old = Parser(*Buf).Parse();
+    Parser Parse(*NewBuf);
+    Timer T;
+    std::unique_ptr<lang::ast::Module> Mod =
+        Parse.Reparse(std::move(Old), *Buf, E.Edit);
+    double Secs = T.Seconds();
+    if (!Parse.DebugOk()) return 1;
+
+    std::cout << "edit at " << E.Name << ": full parse " << FullSecs * 1000
+              << "ms, reparse " << Secs * 1000 << "ms (" << FullSecs / Secs
+              << "x)" << std::endl;
+  }
+
+  return 0;
+}
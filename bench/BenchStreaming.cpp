@@ -0,0 +1,87 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include "CodeGen.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::bench::Timer;
+
+namespace {
+
+// GenerateSource() uses features CodeGen does not lower yet.
+std::string GenerateLowerableSource(unsigned NumFuncs) {
+  std::stringstream Src;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Src << "int func" << i << "() {\n"
+        << "  printf(\"value of func" << i << "\\n\");\n"
+        << "  printf(\"%d %s\\n\", " << i << ", \"str \\\"quoted\\\"\");\n"
+        << "  return " << i << ";\n"
+        << "}\n";
+  }
+  return Src.str();
+}
+
+long RSSKB() {
+  struct rusage Usage;
+  getrusage(RUSAGE_SELF, &Usage);
+  return Usage.ru_maxrss;
+}
+
+void Run(const MemoryBuffer &Buf, bool Stream) {
+  long BaseRSS = RSSKB();
+  Timer T;
+  llvm::LLVMContext Context;
+  lang::CodeGen Generator("bench", Context);
+  size_t ASTBytes = 0;
+  if (Stream) {
+    Parser Parse(Buf);
+    while (const lang::ast::ExternalDeclaration *Decl = Parse.ParseNextDecl()) {
+      Generator.Visit(*Decl);
+      ASTBytes = std::max(ASTBytes, Parse.Context().BytesAllocated());
+    }
+    if (!Parse.DebugOk()) _exit(1);
+  } else {
+    Parser Parse(Buf);
+    std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+    if (!Parse.DebugOk()) _exit(1);
+    Generator.Visit(*Mod);
+    ASTBytes = Mod->Context().BytesAllocated();
+  }
+
+  std::cout << (Stream ? "stream: " : "module: ") << T.Seconds()
+            << "s, AST memory: " << ASTBytes / 1024
+            << "KB, peak RSS: " << (RSSKB() - BaseRSS) / 1024
+            << "MB over the source" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(GenerateLowerableSource(NumFuncs));
+
+  // Peak RSS never goes down, so each mode runs in its own process.
+  for (bool Stream : {false, true}) {
+    pid_t Pid = fork();
+    if (Pid < 0) return 1;
+    if (!Pid) {
+      Run(*Buf, Stream);
+      _exit(0);
+    }
+
+    int Status;
+    if (waitpid(Pid, &Status, 0) < 0 || !WIFEXITED(Status) ||
+        WEXITSTATUS(Status))
+      return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+
+#include "AST/Dump.h"
+#include "AST/RecursiveASTVisitor.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::ast::Node;
+using lang::bench::Timer;
+
+namespace {
+
+class NodeCounter : public lang::ast::RecursiveASTVisitor<NodeCounter> {
+ public:
+  using RecursiveASTVisitor<NodeCounter>::Visit;
+
+  void Visit(const Node &N) {
+    ++Count;
+    RecursiveASTVisitor<NodeCounter>::Visit(N);
+  }
+
+  size_t Count = 0;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned NumFuncs = lang::bench::NumFuncsFromArgs(argc, argv, 200000);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(NumFuncs));
+
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.DebugOk()) return 1;
+
+  const unsigned kRepeat = 10;
+  size_t NumNodes = 0;
+  Timer CountT;
+  for (unsigned i = 0; i < kRepeat; ++i) {
+    NodeCounter Counter;
+    Counter.Visit(static_cast<const Node &>(*Mod));
+    NumNodes = Counter.Count;
+  }
+  double CountSecs = CountT.Seconds();
+  std::cout << "count: " << NumNodes << " nodes, "
+            << NumNodes * kRepeat / CountSecs << " nodes/sec" << std::endl;
+
+  // The stream has no buffer so nothing is actually written.
+  std::ostream Null(nullptr);
+  Timer DumpT;
+  lang::ast::ASTDumper Dumper(Null);
+  Dumper.Visit(*Mod);
+  double DumpSecs = DumpT.Seconds();
+  std::cout << "dump: " << NumNodes / DumpSecs << " nodes/sec" << std::endl;
+  return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef BENCH_BENCHUTIL_H_
+#define BENCH_BENCHUTIL_H_
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+namespace lang {
+namespace bench {
+
+/**
+ * Generate a machine-generated looking source file with the given number of
+ * functions.
+ */
+inline std::string GenerateSource(unsigned NumFuncs) {
+  std::stringstream Src;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Src << "int func" << i << "(int a, char b) {\n"
+        << "  x : int = " << i << ";\n"
+        << "  printf(\"value %d of func" << i << "\\n\", x);\n"
+        << "  call" << i << "(a, b, \"str \\\"quoted\\\"\", 12345);\n"
+        << "  return 0;\n"
+        << "}\n";
+  }
+  return Src.str();
+}
+
+/**
+ * Number of functions to generate. Can be overridden with the first command
+ * line argument.
+ */
+inline unsigned NumFuncsFromArgs(int argc, char **argv, unsigned Default) {
+  if (argc > 1) return std::strtoul(argv[1], nullptr, /*base=*/10);
+  return Default;
+}
+
+class Timer {
+ public:
+  Timer() : Start_(std::chrono::steady_clock::now()) {}
+
+  double Seconds() const {
+    std::chrono::duration<double> Elapsed =
+        std::chrono::steady_clock::now() - Start_;
+    return Elapsed.count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point Start_;
+};
+
+}  // namespace bench
+}  // namespace lang
+
+#endif
@@ -1,24 +1,159 @@
+#include <sys/resource.h>
+#include <algorithm>
 #include <fstream>
+#include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "AST/Dump.h"
+#include "AST/Serialize.h"
 #include "ArgParser.h"
+#include "Backend.h"
 #include "CodeGen.h"
+#include "MemoryBuffer.h"
 #include "Parser.h"
+#include "Pipeline.h"
+#include "SourceManager.h"
+#include "TokenStream.h"
 #include "llvm/ADT/ArrayRef.h"
-#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/FileSystem.h"
-#include "llvm/Support/TargetRegistry.h"
-#include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
-#include "llvm/Target/TargetMachine.h"
-#include "llvm/Target/TargetOptions.h"
 
 constexpr char SRC_FLAG[] = "src";
 constexpr char OUTPUT_FLAG[] = "output";
 constexpr char AST_DUMP_FLAG[] = "ast-dump";
 constexpr char LLVM_DUMP_FLAG[] = "llvm-dump";
+constexpr char EMIT_AST_FLAG[] = "emit-ast";
+constexpr char LOAD_AST_FLAG[] = "load-ast";
+constexpr char STREAM_FLAG[] = "stream";
+constexpr char MEM_STATS_FLAG[] = "mem-stats";
+constexpr char PIPELINE_FLAG[] = "pipeline";
+constexpr char PIPELINE_STATS_FLAG[] = "pipeline-stats";
+constexpr char SIGNATURES_FLAG[] = "signatures";
+constexpr char DUMP_FUNC_FLAG[] = "dump-func";
+constexpr char OPT_LEVEL_FLAG[] = "opt-level";
+constexpr char MARCH_FLAG[] = "march";
+constexpr char MCPU_FLAG[] = "mcpu";
+constexpr char MATTR_FLAG[] = "mattr";
+constexpr char RUN_FLAG[] = "run";
+constexpr char JOBS_FLAG[] = "jobs";
+
+/**
+ * Read the AST for a source file from an AST file. Returns nullptr if the file
+ * is missing, invalid, or was written for different source.
+ */
+std::unique_ptr<lang::ast::Module> LoadAST(const std::string &Filename,
+                                           uint64_t SrcHash, bool Verbose) {
+  std::unique_ptr<lang::MemoryBuffer> Buf =
+      lang::MemoryBuffer::FromFile(Filename);
+  if (!Buf) {
+    if (Verbose) std::cerr << "Could not open file: " << Filename << std::endl;
+    return nullptr;
+  }
+
+  lang::ast::ASTReader Reader(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Reader.Read(SrcHash);
+  if (!Mod && Verbose) {
+    Reader.DebugOk();
+    std::cerr << "Parsing the source instead" << std::endl;
+  }
+  return Mod;
+}
+
+/**
+ * Parse the whole source file, or load its AST from the file given by
+ * --load-ast or --emit-ast. Returns nullptr if the AST file could not be
+ * written.
+ */
+std::unique_ptr<lang::ast::Module> ParseModule(
+    const lang::ParsedArgs &parsed_args, const lang::MemoryBuffer &Src,
+    lang::FileID File) {
+  uint64_t SrcHash = lang::ast::HashSource(Src);
+
+  // An AST file written for this exact source is used instead of parsing.
+  // --emit-ast reuses its output file the same way, so it only writes a new
+  // one when the source changed.
+  std::unique_ptr<lang::ast::Module> Mod;
+  if (parsed_args.HasArg(LOAD_AST_FLAG)) {
+    Mod = LoadAST(
+        parsed_args.GetArg<lang::StringArgument>(LOAD_AST_FLAG).getValue(),
+        SrcHash, /*Verbose=*/true);
+  } else if (parsed_args.HasArg(EMIT_AST_FLAG)) {
+    Mod = LoadAST(
+        parsed_args.GetArg<lang::StringArgument>(EMIT_AST_FLAG).getValue(),
+        SrcHash, /*Verbose=*/false);
+  }
+
+  if (!Mod) {
+    lang::Parser Parse(Src, File);
+    Mod = Parse.Parse();
+    ASSERT(Parse.DebugOk());  // TODO: Error checking
+
+    if (parsed_args.HasArg(EMIT_AST_FLAG)) {
+      std::string ASTFilename =
+          parsed_args.GetArg<lang::StringArgument>(EMIT_AST_FLAG).getValue();
+      std::ofstream ASTFile(ASTFilename, std::ios::binary);
+      lang::ast::ASTWriter Writer(ASTFile);
+      if (!Writer.Write(*Mod, SrcHash)) {
+        std::cerr << "Could not write AST file: " << ASTFilename << std::endl;
+        return nullptr;
+      }
+    }
+  }
+  return Mod;
+}
+
+void PrintSignature(const lang::ast::FunctionDeclaration &Func) {
+  const auto *RetType = lang::cast<lang::ast::Typename>(Func.ReturnType());
+  std::cout << RetType->Name() << " " << Func.Name() << "(";
+  for (size_t i = 0; i < Func.Args().Size(); ++i) {
+    const lang::ast::ArgumentDeclaration *Arg = Func.Args()[i];
+    if (i) std::cout << ", ";
+    std::cout << lang::cast<lang::ast::Typename>(Arg->ArgType())->Name() << " "
+              << Arg->Name();
+  }
+  std::cout << ")" << std::endl;
+}
+
+/**
+ * Print the signature of every function, or dump the AST of the one named by
+ * --dump-func. Function bodies are skipped while parsing, so at most the one
+ * that is dumped ever gets parsed.
+ */
+int InspectFunctions(const lang::ParsedArgs &parsed_args,
+                     const lang::MemoryBuffer &Src, lang::FileID File) {
+  lang::TokenStream Toks(Src, File);
+  Toks.LexAll();
+  lang::Parser Parse(Toks);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.ParseLazy();
+  if (!Parse.DebugOk()) return 1;
+
+  if (!parsed_args.HasArg(DUMP_FUNC_FLAG)) {
+    for (const lang::ast::ExternalDeclaration *Decl : Mod->ExternDecls())
+      PrintSignature(*lang::cast<lang::ast::FunctionDeclaration>(Decl));
+    return 0;
+  }
+
+  lang::Symbol Name = lang::Symbol::Intern(
+      parsed_args.GetArg<lang::StringArgument>(DUMP_FUNC_FLAG).getValue());
+  for (const lang::ast::ExternalDeclaration *Decl : Mod->ExternDecls()) {
+    const auto *Func = lang::cast<lang::ast::FunctionDeclaration>(Decl);
+    if (Func->Name() != Name) continue;
+    lang::ast::ASTDumper dumper(std::cerr);
+    dumper.Visit(*Func);
+    return !Mod->Bodies() || Mod->Bodies()->DebugOk() ? 0 : 1;
+  }
+
+  std::cerr << "No function named " << Name << std::endl;
+  return 1;
+}
+
+long PeakRSSKB() {
+  struct rusage Usage;
+  getrusage(RUSAGE_SELF, &Usage);
+  return Usage.ru_maxrss;
+}
 
 int main(int argc, char **argv) {
   lang::ArgParser parser;
@@ -30,6 +165,30 @@ int main(int argc, char **argv) {
                                                        output_params);
   parser.AddEmptyKeywordArgument(AST_DUMP_FLAG);
   parser.AddEmptyKeywordArgument(LLVM_DUMP_FLAG);
+  parser.AddKeywordArgument<lang::StringParsingMethod>(EMIT_AST_FLAG);
+  parser.AddKeywordArgument<lang::StringParsingMethod>(LOAD_AST_FLAG);
+  parser.AddEmptyKeywordArgument(STREAM_FLAG);
+  parser.AddEmptyKeywordArgument(MEM_STATS_FLAG);
+  parser.AddEmptyKeywordArgument(PIPELINE_FLAG);
+  parser.AddEmptyKeywordArgument(PIPELINE_STATS_FLAG);
+  parser.AddEmptyKeywordArgument(SIGNATURES_FLAG);
+  parser.AddKeywordArgument<lang::StringParsingMethod>(DUMP_FUNC_FLAG);
+
+  // -O2 is the same as --opt-level=2.
+  struct lang::KWArgParams opt_level_params = {};
+  opt_level_params.short_argname = 'O';
+  parser.AddKeywordArgument<lang::StringParsingMethod>(OPT_LEVEL_FLAG,
+                                                       opt_level_params);
+  parser.AddKeywordArgument<lang::StringParsingMethod>(MARCH_FLAG);
+  parser.AddKeywordArgument<lang::StringParsingMethod>(MCPU_FLAG);
+  parser.AddKeywordArgument<lang::StringParsingMethod>(MATTR_FLAG);
+  parser.AddEmptyKeywordArgument(RUN_FLAG);
+
+  // -j4 is the same as --jobs=4.
+  struct lang::KWArgParams jobs_params = {};
+  jobs_params.short_argname = 'j';
+  parser.AddKeywordArgument<lang::IntegerParsingMethod>(JOBS_FLAG,
+                                                        jobs_params);
 
   lang::ParsedArgs parsed_args = parser.Parse(argc, argv);
   if (!parser.DebugOk()) {
@@ -41,14 +200,114 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  std::ifstream input(
-      parsed_args.GetArg<lang::StringArgument>(SRC_FLAG).getValue());
-  lang::Parser Parse(input);
-  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
-  ASSERT(Parse.DebugOk());  // TODO: Error checking
+  std::string SrcFilename =
+      parsed_args.GetArg<lang::StringArgument>(SRC_FLAG).getValue();
+  std::unique_ptr<lang::MemoryBuffer> Input =
+      lang::MemoryBuffer::FromFile(SrcFilename);
+  if (!Input) {
+    std::cerr << "Could not open file: " << SrcFilename << std::endl;
+    return 1;
+  }
+
+  lang::OptLevel Level;
+  if (parsed_args.HasArg(OPT_LEVEL_FLAG)) {
+    std::string LevelStr =
+        parsed_args.GetArg<lang::StringArgument>(OPT_LEVEL_FLAG).getValue();
+    if (!lang::OptLevel::Parse(LevelStr, Level)) {
+      std::cerr << "Unknown optimization level: -O" << LevelStr << std::endl;
+      return 1;
+    }
+  }
+
+  unsigned Jobs = 0;
+  if (parsed_args.HasArg(JOBS_FLAG)) {
+    int64_t JobsArg =
+        parsed_args.GetArg<lang::IntegerArgument>(JOBS_FLAG).getValue();
+    if (JobsArg < 1) {
+      std::cerr << "Expected at least 1 job: -j" << JobsArg << std::endl;
+      return 1;
+    }
+    Jobs = JobsArg;
+  }
+
+  lang::TargetSpec Target;
+  if (parsed_args.HasArg(MARCH_FLAG)) {
+    Target.Arch =
+        parsed_args.GetArg<lang::StringArgument>(MARCH_FLAG).getValue();
+  }
+  if (parsed_args.HasArg(MCPU_FLAG))
+    Target.CPU = parsed_args.GetArg<lang::StringArgument>(MCPU_FLAG).getValue();
+  if (parsed_args.HasArg(MATTR_FLAG)) {
+    Target.Features =
+        parsed_args.GetArg<lang::StringArgument>(MATTR_FLAG).getValue();
+  }
+  Target.PIC = parsed_args.HasArg(RUN_FLAG);
+
+  lang::SourceManager SM;
+  lang::FileID File = SM.AddBuffer(std::move(Input));
+  if (parsed_args.HasArg(SIGNATURES_FLAG) || parsed_args.HasArg(DUMP_FUNC_FLAG))
+    return InspectFunctions(parsed_args, SM.Buffer(File), File);
+
+  bool Pipelined = parsed_args.HasArg(PIPELINE_FLAG);
+  bool Stream = parsed_args.HasArg(STREAM_FLAG) || Pipelined;
+  if (Stream &&
+      (parsed_args.HasArg(AST_DUMP_FLAG) || parsed_args.HasArg(EMIT_AST_FLAG) ||
+       parsed_args.HasArg(LOAD_AST_FLAG))) {
+    std::cerr << "--stream and --pipeline cannot be used with flags that need "
+                 "the whole AST"
+              << std::endl;
+    return 1;
+  }
+
+  llvm::LLVMContext Context;
+  lang::CodeGen Generator("asdf", Context);
+  std::unique_ptr<lang::ast::Module> Mod;
+  size_t ASTBytes = 0;
+  if (Pipelined) {
+    // Lex and parse on their own threads while this one lowers each function.
+    lang::Pipeline Pipe(SM.Buffer(File), File);
+    Pipe.Run([&](const lang::ast::ExternalDeclaration &Decl) {
+      Generator.Visit(Decl);
+    });
+    ASSERT(Pipe.DebugOk());  // TODO: Error checking
+    if (parsed_args.HasArg(PIPELINE_STATS_FLAG)) Pipe.Stats().Dump(std::cerr);
+  } else if (Stream) {
+    // Lower each function as soon as it is parsed. The next ParseNextDecl()
+    // frees its AST, so only one function is held in memory at a time.
+    lang::Parser Parse(SM.Buffer(File), File);
+    while (const lang::ast::ExternalDeclaration *Decl = Parse.ParseNextDecl()) {
+      Generator.Visit(*Decl);
+      ASTBytes = std::max(ASTBytes, Parse.Context().BytesAllocated());
+    }
+    ASSERT(Parse.DebugOk());  // TODO: Error checking
+  } else {
+    Mod = ParseModule(parsed_args, SM.Buffer(File), File);
+    if (!Mod) return 1;
+    Generator.Visit(*Mod);
+    ASTBytes = Mod->Context().BytesAllocated();
+  }
+
+  if (parsed_args.HasArg(MEM_STATS_FLAG)) {
+    // The pipeline's contexts live on the parser thread and are not measured.
+    if (!Pipelined) std::cerr << "AST memory: " << ASTBytes / 1024 << "KB, ";
+    std::cerr << "peak RSS after codegen: " << PeakRSSKB() / 1024 << "MB"
+              << std::endl;
+  }
+
+  std::string Error;
+  std::unique_ptr<llvm::TargetMachine> TargetMachine =
+      lang::CreateTargetMachine(Target, Level, Error);
+  if (!TargetMachine) {
+    std::cerr << "Cannot find target: " << Error << std::endl;
+    return 1;
+  }
+
+  // With -j the module is optimized in parts, on the threads that compile it.
+  bool Parallel = Jobs && !parsed_args.HasArg(LLVM_DUMP_FLAG) &&
+                  !parsed_args.HasArg(RUN_FLAG);
+  if (!Parallel)
+    lang::OptimizeModule(Generator.Module(), *TargetMachine, Level);
 
-  lang::CodeGen Generator("asdf");
-  Generator.Visit(*Mod);
   if (parsed_args.HasArg(LLVM_DUMP_FLAG)) {
     Generator.Module().print(llvm::errs(), nullptr);
     return 0;
@@ -56,12 +315,29 @@ int main(int argc, char **argv) {
     lang::ast::ASTDumper dumper(std::cerr);
     dumper.Visit(*Mod);
     return 0;
+  } else if (parsed_args.HasArg(RUN_FLAG)) {
+    int ExitCode;
+    if (!lang::RunMain(Generator.ReleaseModule(), Target, Level, Jobs,
+                       ExitCode, Error)) {
+      std::cerr << "Cannot run program: " << Error << std::endl;
+      return 1;
+    }
+    return ExitCode;
   }
 
   std::string Filename =
       parsed_args.GetArg<lang::StringArgument>(OUTPUT_FLAG, "output.o")
           .getValue();
 
+  if (Parallel) {
+    if (!lang::EmitObjectFileParallel(Generator.ReleaseModule(), Target, Level,
+                                      Jobs, Filename, Error)) {
+      std::cerr << "Cannot emit object file: " << Error << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   std::error_code EC;
   llvm::raw_fd_ostream dest(Filename, EC, llvm::sys::fs::F_None);
   if (EC) {
@@ -69,44 +345,10 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  // Initialize the target registry etc.
-  llvm::InitializeAllTargetInfos();
-  llvm::InitializeAllTargets();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmParsers();
-  llvm::InitializeAllAsmPrinters();
-
-  std::string Error;
-  auto Target = llvm::TargetRegistry::lookupTarget(
-      llvm::sys::getDefaultTargetTriple(), Error);
-
-  // Print an error and exit if we couldn't find the requested target.
-  // This generally occurs if we've forgotten to initialise the
-  // TargetRegistry or we have a bogus target triple.
-  if (!Target) {
-    std::cerr << "Cannot find target: " << Error << std::endl;
-    return 1;
-  }
-
-  auto TargetTriple = llvm::sys::getDefaultTargetTriple();
-  auto CPU = "generic";
-  auto Features = "";
-
-  llvm::TargetOptions opt;
-  auto RM = llvm::Optional<llvm::Reloc::Model>();
-  auto TargetMachine =
-      Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM);
-
-  llvm::legacy::PassManager pass;
-  auto FileType = llvm::TargetMachine::CGFT_ObjectFile;
-
-  if (TargetMachine->addPassesToEmitFile(pass, dest, FileType)) {
+  if (!lang::EmitObjectFile(Generator.Module(), *TargetMachine, dest)) {
     std::cerr << "TargetMachine can't emit a file of this type" << std::endl;
     return 1;
   }
 
-  pass.run(Generator.Module());
-  dest.flush();
-
   return 0;
 }
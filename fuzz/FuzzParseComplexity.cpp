@@ -0,0 +1,178 @@
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include "MemoryBuffer.h"
+#include "Parser.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+
+/**
+ * A libFuzzer harness that looks for inputs whose lexing and parsing cost
+ * grows faster than their size.
+ *
+ * The first two bytes of an input split the rest into a prefix, a middle and
+ * a suffix. The middle is repeated K and 2K times, and Parser::Parse() is
+ * timed on the prefix, the repeats and the suffix. Doubling the repeats of a
+ * linear parser doubles the cost on top of the prefix and suffix, so anything
+ * well past that is reported and the input aborts. libFuzzer then saves the
+ * input, and with -artifact_prefix=fuzz/regressions/ it becomes a regression
+ * case that check-fuzz-regressions replays.
+ *
+ * Cost is the number of instructions this thread retires, read from the
+ * hardware counter. Where that counter cannot be opened, as in most VMs, the
+ * thread's CPU time in nanoseconds is used instead and each measurement is
+ * the fastest of a few runs.
+ *
+ * The cost per repeated byte and the growth ratio are fed back to libFuzzer
+ * as extra coverage counters, so inputs that are slower per byte or grow
+ * faster than any seen so far are kept in the corpus and mutated further.
+ */
+
+namespace {
+
+// Roughly how many bytes the middle is repeated out to for K repeats. The
+// hardware counter is exact, so it gets away with a much smaller input.
+const size_t kPumpedBytesInstrs = 1 << 12;
+const size_t kPumpedBytesTime = 1 << 15;
+
+// How many times slower 2K repeats may be than K repeats. A linear parser is
+// at 2 and a quadratic one at 4.
+const double kMaxGrowth = 3;
+
+// Growth below this much cost is noise, not a trend.
+const uint64_t kMinCost = 100000;
+
+const unsigned kTimeRuns = 5;
+
+class CostCounter {
+ public:
+  CostCounter() {
+    perf_event_attr Attr;
+    memset(&Attr, 0, sizeof(Attr));
+    Attr.type = PERF_TYPE_HARDWARE;
+    Attr.size = sizeof(Attr);
+    Attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    Attr.exclude_kernel = 1;
+    Attr.exclude_hv = 1;
+    FD_ = syscall(SYS_perf_event_open, &Attr, /*pid=*/0, /*cpu=*/-1,
+                  /*group_fd=*/-1, /*flags=*/0);
+  }
+
+  ~CostCounter() {
+    if (FD_ >= 0) close(FD_);
+  }
+
+  bool CountsInstructions() const { return FD_ >= 0; }
+  const char *Unit() const { return CountsInstructions() ? "instrs" : "ns"; }
+
+  /**
+   * The cost of parsing Src, which has no side effects worth keeping.
+   */
+  uint64_t Measure(const std::string &Src) {
+    std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(Src);
+    if (CountsInstructions()) return MeasureOnce(*Buf);
+
+    uint64_t Min = UINT64_MAX;
+    for (unsigned i = 0; i < kTimeRuns; ++i)
+      Min = std::min(Min, MeasureOnce(*Buf));
+    return Min;
+  }
+
+ private:
+  uint64_t MeasureOnce(const MemoryBuffer &Buf) {
+    uint64_t Start = Read();
+    Parser(Buf).Parse();
+    return Read() - Start;
+  }
+
+  uint64_t Read() const {
+    if (CountsInstructions()) {
+      uint64_t Count = 0;
+      if (read(FD_, &Count, sizeof(Count)) != sizeof(Count)) abort();
+      return Count;
+    }
+    timespec Now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Now);
+    return Now.tv_sec * 1000000000ull + Now.tv_nsec;
+  }
+
+  int FD_;
+};
+
+// The first half buckets the growth ratio in eighths, the second half the
+// log2 of the cost per repeated byte.
+const size_t kNumGrowthBuckets = 32;
+__attribute__((used, section("__libfuzzer_extra_counters")))
+uint8_t CostCounters[2 * kNumGrowthBuckets];
+
+double MaxCostPerByte = 0;
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
+  if (Size < 3) return 0;
+
+  std::string Rest(reinterpret_cast<const char *>(Data) + 2, Size - 2);
+  size_t PrefixLen = Data[0] % Rest.size();
+  size_t MiddleLen = 1 + Data[1] % (Rest.size() - PrefixLen);
+  std::string Prefix = Rest.substr(0, PrefixLen);
+  std::string Middle = Rest.substr(PrefixLen, MiddleLen);
+  std::string Suffix = Rest.substr(PrefixLen + MiddleLen);
+
+  static CostCounter Cost;
+  size_t PumpedBytes = Cost.CountsInstructions() ? kPumpedBytesInstrs
+                                                  : kPumpedBytesTime;
+  size_t K = std::max<size_t>(1, PumpedBytes / Middle.size());
+  auto Pumped = [&](size_t Repeats) {
+    std::string Src = Prefix;
+    Src.reserve(Prefix.size() + Middle.size() * Repeats + Suffix.size());
+    for (size_t i = 0; i < Repeats; ++i) Src += Middle;
+    return Src + Suffix;
+  };
+  std::string Once = Pumped(K);
+  std::string Twice = Pumped(2 * K);
+
+  // Intern every symbol and warm the allocator before anything is measured.
+  Cost.Measure(Twice);
+  uint64_t Base = Cost.Measure(Pumped(0));
+  uint64_t CostOnce = Cost.Measure(Once);
+  uint64_t CostTwice = Cost.Measure(Twice);
+  uint64_t GrowthOnce = CostOnce > Base ? CostOnce - Base : 1;
+  uint64_t GrowthTwice = CostTwice > Base ? CostTwice - Base : 0;
+  double Ratio = static_cast<double>(GrowthTwice) / GrowthOnce;
+
+  double CostPerByte =
+      static_cast<double>(GrowthTwice) / (Middle.size() * 2 * K);
+  if (CostPerByte > MaxCostPerByte) {
+    MaxCostPerByte = CostPerByte;
+    fprintf(stderr, "new max cost: %.1f %s per byte over %zu bytes\n",
+            CostPerByte, Cost.Unit(), Twice.size());
+  }
+
+  CostCounters[std::min<size_t>(kNumGrowthBuckets - 1, Ratio * 8)] = 1;
+  size_t Log2 = 0;
+  while ((2ull << Log2) <= CostPerByte) ++Log2;
+  CostCounters[kNumGrowthBuckets +
+               std::min<size_t>(kNumGrowthBuckets - 1, Log2)] = 1;
+
+  if (GrowthTwice >= kMinCost && Ratio > kMaxGrowth) {
+    fprintf(stderr,
+            "superlinear parse: %zu bytes cost %llu %s, %zu bytes cost %llu "
+            "%s (%.2fx for 2x the bytes)\n",
+            Once.size(), static_cast<unsigned long long>(CostOnce),
+            Cost.Unit(), Twice.size(),
+            static_cast<unsigned long long>(CostTwice), Cost.Unit(), Ratio);
+    abort();
+  }
+  return 0;
+}
@@ -1,7 +1,12 @@
+#include <pthread.h>
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 
+#include "AST/ASTWalker.h"
 #include "AST/Dump.h"
 #include "AST/Expr.h"
 #include "Parser.h"
@@ -21,6 +26,7 @@
 
 using lang::Parser;
 using lang::ast::ASTDumper;
+using lang::ast::Node;
 
 namespace {
 
@@ -30,6 +36,218 @@ TEST(ASTTest, IntegerLiteral) {
   ASTDumper dumper(input);
 }
 
+TEST(ASTTest, Casting) {
+  lang::ast::ASTContext Ctx;
+  const lang::ast::Expr *Int = Ctx.Create<lang::ast::IntegerLiteral>(2);
+  const Node *Stmt = Ctx.Create<lang::ast::Return>(Int);
+
+  ASSERT_TRUE(lang::isa<lang::ast::Expr>(Int));
+  ASSERT_TRUE(lang::isa<lang::ast::IntegerLiteral>(Int));
+  ASSERT_FALSE(lang::isa<lang::ast::StringLiteral>(Int));
+  ASSERT_FALSE(lang::isa<lang::ast::Stmt>(Int));
+
+  ASSERT_TRUE(lang::isa<lang::ast::Stmt>(Stmt));
+  ASSERT_EQ(lang::dyn_cast<lang::ast::Expr>(Stmt), nullptr);
+  ASSERT_EQ(lang::cast<lang::ast::Return>(Stmt)->Value(), Int);
+}
+
+/**
+ * Counts every node by hooking the dispatch method.
+ */
+class NodeCounter : public lang::ast::RecursiveASTVisitor<NodeCounter> {
+ public:
+  using RecursiveASTVisitor<NodeCounter>::Visit;
+
+  void Visit(const Node &N) {
+    ++Count;
+    RecursiveASTVisitor<NodeCounter>::Visit(N);
+  }
+
+  unsigned Count = 0;
+};
+
+TEST(ASTTest, RecursiveASTVisitor) {
+  std::stringstream input;
+  input << "int main(int a) {\n"
+           "  printf(\"%d\\n\", a);\n"
+           "  return 0;\n"
+           "}\n";
+  Parser parser(input);
+  std::unique_ptr<lang::ast::Module> Mod = parser.Parse();
+  ASSERT_TRUE(parser.Ok());
+
+  // Module, function, return type, argument and its type, expr stmt, call,
+  // printf, the string, a, return and 0.
+  NodeCounter Counter;
+  Counter.Visit(static_cast<const Node &>(*Mod));
+  ASSERT_EQ(Counter.Count, 12);
+}
+
+TEST(ASTTest, Dump) {
+  std::stringstream input;
+  input << "int main() {\n"
+           "  printf(\"hi\");\n"
+           "  return 0;\n"
+           "}\n";
+  Parser parser(input);
+  std::unique_ptr<lang::ast::Module> Mod = parser.Parse();
+  ASSERT_TRUE(parser.Ok());
+
+  std::stringstream out;
+  ASTDumper dumper(out);
+  dumper.Visit(*Mod);
+
+  // This file defines a str() macro so read the stream directly.
+  std::string Dumped((std::istreambuf_iterator<char>(out)),
+                     std::istreambuf_iterator<char>());
+  ASSERT_EQ(Dumped,
+            "Module\n"
+            "|-FunctionDeclaration<\"main\" -> \"int\">()\n"
+            "  |-ExprStmt\n"
+            "    |-Call\n"
+            "      |-Caller\n"
+            "        |-ID<\"printf\">\n"
+            "      |-Args\n"
+            "        |-StringLiteral<\"hi\">\n"
+            "  |-Return\n"
+            "    |-IntegerLiteral<0>\n");
+}
+
+TEST(ASTTest, DumpNestedCalls) {
+  std::stringstream input;
+  input << "int main() { f(g(1, h()), 2); }";
+  Parser parser(input);
+  std::unique_ptr<lang::ast::Module> Mod = parser.Parse();
+  ASSERT_TRUE(parser.Ok());
+
+  std::stringstream out;
+  ASTDumper dumper(out);
+  dumper.Visit(*Mod);
+  std::string Dumped((std::istreambuf_iterator<char>(out)),
+                     std::istreambuf_iterator<char>());
+  ASSERT_EQ(Dumped,
+            "Module\n"
+            "|-FunctionDeclaration<\"main\" -> \"int\">()\n"
+            "  |-ExprStmt\n"
+            "    |-Call\n"
+            "      |-Caller\n"
+            "        |-ID<\"f\">\n"
+            "      |-Args\n"
+            "        |-Call\n"
+            "          |-Caller\n"
+            "            |-ID<\"g\">\n"
+            "          |-Args\n"
+            "            |-IntegerLiteral<1>\n"
+            "            |-Call\n"
+            "              |-Caller\n"
+            "                |-ID<\"h\">\n"
+            "              |-Args\n"
+            "        |-IntegerLiteral<2>\n");
+}
+
+std::unique_ptr<lang::ast::Module> ParseNestedCalls(unsigned Depth) {
+  std::stringstream input;
+  input << "int main() {\n  return ";
+  for (unsigned i = 0; i < Depth; ++i) input << "f(";
+  input << "1" << std::string(Depth, ')') << ";\n}\n";
+  Parser parser(input);
+  std::unique_ptr<lang::ast::Module> Mod = parser.Parse();
+  EXPECT_TRUE(parser.Ok());
+  return Mod;
+}
+
+/**
+ * Run Fn on a thread with a stack small enough that recursing once per
+ * nested call would overflow it.
+ */
+void RunWithSmallStack(std::function<void()> Fn) {
+  pthread_attr_t Attr;
+  pthread_attr_init(&Attr);
+  pthread_attr_setstacksize(&Attr, 64 * 1024);
+  pthread_t Thread;
+  pthread_create(&Thread, &Attr,
+                 [](void *Arg) -> void * {
+                   (*static_cast<std::function<void()> *>(Arg))();
+                   return nullptr;
+                 },
+                 &Fn);
+  pthread_join(Thread, nullptr);
+  pthread_attr_destroy(&Attr);
+}
+
+TEST(ASTTest, DumpDeeplyNestedCalls) {
+  // The indentation makes the dump quadratic in the depth, so keep it small
+  // and shrink the stack instead.
+  const unsigned Depth = 2000;
+  std::unique_ptr<lang::ast::Module> Mod = ParseNestedCalls(Depth);
+  std::string Dumped;
+  RunWithSmallStack([&] {
+    std::stringstream out;
+    ASTDumper dumper(out);
+    dumper.Visit(*Mod);
+    Dumped.assign(std::istreambuf_iterator<char>(out),
+                  std::istreambuf_iterator<char>());
+  });
+
+  // Each call prints 3 lines.
+  ASSERT_EQ(std::count(Dumped.begin(), Dumped.end(), '\n'), 3 + 4 * Depth + 1);
+  ASSERT_NE(Dumped.find(std::string(4 * Depth + 4, ' ') + "|-IntegerLiteral<1>"),
+            std::string::npos);
+}
+
+/**
+ * Counts every node and the deepest nesting seen.
+ */
+class DepthCounter : public lang::ast::ASTWalker<DepthCounter> {
+ public:
+  template <class T>
+  bool Enter(const T &) {
+    ++Count;
+    MaxDepth = std::max(MaxDepth, ++Depth);
+    return true;
+  }
+
+  template <class T>
+  void Leave(const T &) {
+    --Depth;
+  }
+
+  unsigned Count = 0;
+  unsigned Depth = 0;
+  unsigned MaxDepth = 0;
+};
+
+TEST(ASTTest, ASTWalker) {
+  std::stringstream input;
+  input << "int main(int a) {\n"
+           "  printf(\"%d\\n\", a);\n"
+           "  x : int = 1;\n"
+           "  return 0;\n"
+           "}\n";
+  Parser parser(input);
+  std::unique_ptr<lang::ast::Module> Mod = parser.Parse();
+  ASSERT_TRUE(parser.Ok());
+
+  // Same as the RecursiveASTVisitor test plus the VarDecl, its type and 1.
+  DepthCounter Counter;
+  Counter.Walk(*Mod);
+  ASSERT_EQ(Counter.Count, 15);
+  ASSERT_EQ(Counter.Depth, 0);
+  ASSERT_EQ(Counter.MaxDepth, 5);
+}
+
+TEST(ASTTest, ASTWalkerDeeplyNestedCalls) {
+  const unsigned Depth = 1000000;
+  std::unique_ptr<lang::ast::Module> Mod = ParseNestedCalls(Depth);
+  DepthCounter Counter;
+  Counter.Walk(*Mod);
+
+  // Module, function, return type and return, then a call and its caller for
+  // each level, and the innermost 1.
+  ASSERT_EQ(Counter.Count, 4 + 2 * Depth + 1);
+  ASSERT_EQ(Counter.MaxDepth, 3 + Depth + 1);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,159 @@
+#include <cstring>
+#include <sstream>
+
+#include "AST/Dump.h"
+#include "AST/Serialize.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+#include "gtest/gtest.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::ast::ASTReader;
+using lang::ast::ASTWriter;
+using lang::ast::Module;
+
+namespace {
+
+std::string Dump(const Module &Mod) {
+  std::stringstream Out;
+  lang::ast::ASTDumper Dumper(Out);
+  Dumper.Visit(Mod);
+  return Out.str();
+}
+
+std::string WriteAST(const Module &Mod, uint64_t Hash) {
+  std::stringstream Out;
+  ASTWriter Writer(Out);
+  EXPECT_TRUE(Writer.Write(Mod, Hash));
+  return Out.str();
+}
+
+TEST(TestASTSerialize, RoundTrip) {
+  std::unique_ptr<MemoryBuffer> Src =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(20) +
+                               "int main() { x : int; return 0; }");
+  Parser Parse(*Src);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+
+  uint64_t Hash = lang::ast::HashSource(*Src);
+  std::unique_ptr<MemoryBuffer> File =
+      MemoryBuffer::FromString(WriteAST(*Mod, Hash));
+
+  ASTReader Reader(*File);
+  std::unique_ptr<Module> Loaded = Reader.Read(Hash);
+  ASSERT_TRUE(Loaded);
+  ASSERT_EQ(Reader.Status(), lang::ast::ASTFILE_OK);
+
+  // The loaded module must not depend on the file once it is built.
+  File.reset();
+  ASSERT_EQ(Dump(*Loaded), Dump(*Mod));
+
+  const auto *Main = lang::cast<lang::ast::FunctionDeclaration>(
+      Loaded->ExternDecls()[20]);
+  ASSERT_EQ(Loaded->DeclLoc(20), Mod->DeclLoc(20));
+  const auto *Decl = lang::cast<lang::ast::VarDecl>(Main->Body()[0]);
+  ASSERT_FALSE(Decl->HasInit());
+  ASSERT_EQ(lang::cast<lang::ast::Typename>(Decl->VarType()).Name(),
+            lang::SYM_INT);
+}
+
+TEST(TestASTSerialize, Deterministic) {
+  std::stringstream Input(lang::bench::GenerateSource(5));
+  Parser Parse(Input);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+  ASSERT_EQ(WriteAST(*Mod, 1), WriteAST(*Mod, 1));
+}
+
+TEST(TestASTSerialize, Stale) {
+  std::stringstream Input("int main() { return 0; }");
+  Parser Parse(Input);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+
+  std::unique_ptr<MemoryBuffer> File =
+      MemoryBuffer::FromString(WriteAST(*Mod, 1));
+  ASTReader Reader(*File);
+  ASSERT_FALSE(Reader.Read(2));
+  ASSERT_EQ(Reader.Status(), lang::ast::ASTFILE_STALE);
+}
+
+TEST(TestASTSerialize, BadFormat) {
+  std::stringstream Input("int main() { return 0; }");
+  Parser Parse(Input);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+  std::string Contents = WriteAST(*Mod, 1);
+
+  std::unique_ptr<MemoryBuffer> Source =
+      MemoryBuffer::FromString("int main() { return 0; }");
+  ASTReader SourceReader(*Source);
+  ASSERT_FALSE(SourceReader.Read(1));
+  ASSERT_EQ(SourceReader.Status(), lang::ast::ASTFILE_BAD_FORMAT);
+
+  // Every truncation is rejected rather than read past the end.
+  for (size_t Size = 0; Size < Contents.size(); Size += 4) {
+    std::unique_ptr<MemoryBuffer> File =
+        MemoryBuffer::FromString(Contents.substr(0, Size));
+    ASTReader Reader(*File);
+    ASSERT_FALSE(Reader.Read(1));
+    ASSERT_EQ(Reader.Status(), lang::ast::ASTFILE_BAD_FORMAT);
+  }
+
+  std::string Future = Contents;
+  Future[8] = static_cast<char>(lang::ast::kASTFileVersion + 1);
+  std::unique_ptr<MemoryBuffer> FutureFile = MemoryBuffer::FromString(Future);
+  ASTReader FutureReader(*FutureFile);
+  ASSERT_FALSE(FutureReader.Read(1));
+  ASSERT_EQ(FutureReader.Status(), lang::ast::ASTFILE_VERSION_MISMATCH);
+}
+
+TEST(TestASTSerialize, CorruptNodes) {
+  std::stringstream Input("int main() { printf(\"a\", f(g(1))); return 0; }");
+  Parser Parse(Input);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+  std::string Contents = WriteAST(*Mod, 1);
+
+  // Flipping any byte after the header must never crash the reader. Most
+  // flips are caught; the rest only change names, locations or values.
+  for (size_t i = 0; i < Contents.size(); ++i) {
+    std::string Corrupt = Contents;
+    Corrupt[i] ^= 0x80;
+    std::unique_ptr<MemoryBuffer> File = MemoryBuffer::FromString(Corrupt);
+    ASTReader Reader(*File);
+    Reader.Read(1);
+  }
+}
+
+TEST(TestASTSerialize, DeeplyNestedCalls) {
+  const unsigned Depth = 1000000;
+  std::string Src = "int main() {\n  return ";
+  for (unsigned i = 0; i < Depth; ++i) Src += "f(";
+  Src += "1" + std::string(Depth, ')') + ";\n}\n";
+  std::stringstream Input(Src);
+  Parser Parse(Input);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+
+  std::unique_ptr<MemoryBuffer> File =
+      MemoryBuffer::FromString(WriteAST(*Mod, 1));
+  ASTReader Reader(*File);
+  std::unique_ptr<Module> Loaded = Reader.Read(1);
+  ASSERT_TRUE(Reader.DebugOk());
+
+  // Both trees flatten to the same arrays.
+  std::string Rewritten = WriteAST(*Loaded, 1);
+  ASSERT_EQ(Rewritten.size(), File->Size());
+  ASSERT_EQ(memcmp(Rewritten.data(), File->Begin(), Rewritten.size()), 0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "AST/ASTContext.h"
+#include "AST/Expr.h"
+#include "Arena.h"
+#include "gtest/gtest.h"
+
+using lang::Arena;
+using lang::ArrayRef;
+using lang::StringRef;
+using lang::ast::ASTContext;
+using lang::ast::Expr;
+using lang::ast::IntegerLiteral;
+
+namespace {
+
+TEST(TestArena, Alignment) {
+  Arena Alloc;
+  for (size_t Align : {1, 2, 4, 8, 16, 64}) {
+    Alloc.Allocate(1, 1);
+    void *Ptr = Alloc.Allocate(3, Align);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(Ptr) % Align, 0);
+  }
+}
+
+TEST(TestArena, AllocationsDoNotOverlap) {
+  Arena Alloc;
+  std::vector<char *> Ptrs;
+  for (unsigned i = 0; i < 10000; ++i) {
+    char *Ptr = static_cast<char *>(Alloc.Allocate(16, 8));
+    memset(Ptr, i & 0xFF, 16);
+    Ptrs.push_back(Ptr);
+  }
+  for (unsigned i = 0; i < Ptrs.size(); ++i) {
+    for (unsigned j = 0; j < 16; ++j)
+      ASSERT_EQ(static_cast<unsigned char>(Ptrs[i][j]), i & 0xFF);
+  }
+
+  // Small allocations share slabs.
+  ASSERT_LT(Alloc.NumSlabs(), 10);
+}
+
+TEST(TestArena, LargeAllocation) {
+  Arena Alloc;
+  char *Small = static_cast<char *>(Alloc.Allocate(8, 8));
+  char *Large = static_cast<char *>(Alloc.Allocate(1 << 20, 16));
+  memset(Large, 'x', 1 << 20);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(Large) % 16, 0);
+  ASSERT_GE(Alloc.BytesAllocated(), 1 << 20);
+
+  // The large allocation gets its own slab and does not use up the current
+  // one.
+  char *Next = static_cast<char *>(Alloc.Allocate(8, 8));
+  ASSERT_EQ(Next, Small + 8);
+}
+
+TEST(TestArena, Reset) {
+  Arena Alloc;
+  char *First = static_cast<char *>(Alloc.Allocate(8, 8));
+  Alloc.Allocate(1 << 20, 16);
+  for (unsigned i = 0; i < 10000; ++i) Alloc.Allocate(16, 8);
+  ASSERT_GT(Alloc.NumSlabs(), 2);
+
+  // Only the current slab is kept, and it is reused from the start.
+  Alloc.Reset();
+  ASSERT_EQ(Alloc.NumSlabs(), 1);
+  ASSERT_LT(Alloc.BytesAllocated(), 1 << 20);
+  char *Reused = static_cast<char *>(Alloc.Allocate(8, 8));
+  ASSERT_NE(Reused, First);
+  ASSERT_EQ(Alloc.NumSlabs(), 1);
+
+  Arena Empty;
+  Empty.Reset();
+  ASSERT_EQ(Empty.NumSlabs(), 0);
+  ASSERT_NE(Empty.Allocate(8, 8), nullptr);
+}
+
+TEST(TestArena, Adopt) {
+  Arena Alloc;
+  Alloc.Allocate(8, 8);
+  {
+    Arena Other;
+    for (unsigned i = 0; i < 10000; ++i) Other.Allocate(16, 8);
+    size_t OtherSlabs = Other.NumSlabs();
+    size_t OtherBytes = Other.BytesAllocated();
+    size_t Bytes = Alloc.BytesAllocated();
+
+    Alloc.Adopt(Other);
+    ASSERT_EQ(Alloc.NumSlabs(), OtherSlabs + 1);
+    ASSERT_EQ(Alloc.BytesAllocated(), Bytes + OtherBytes);
+    ASSERT_EQ(Other.NumSlabs(), 0);
+    ASSERT_EQ(Other.BytesAllocated(), 0);
+    ASSERT_NE(Other.Allocate(8, 8), nullptr);
+  }
+
+  // Allocation carries on in the arena's own slab.
+  Alloc.Allocate(8, 8);
+  Alloc.Reset();
+  ASSERT_EQ(Alloc.NumSlabs(), 1);
+}
+
+TEST(TestArena, SlabSize) {
+  Arena Alloc(1024);
+  Alloc.Allocate(16, 8);
+  ASSERT_EQ(Alloc.BytesAllocated(), 1024);
+  for (unsigned i = 0; i < 100; ++i) Alloc.Allocate(16, 8);
+  ASSERT_EQ(Alloc.NumSlabs(), 2);
+
+  // Anything over a quarter of a slab still gets a slab of its own.
+  Alloc.Allocate(512, 1);
+  ASSERT_EQ(Alloc.NumSlabs(), 3);
+  Alloc.Allocate(16, 8);
+  ASSERT_EQ(Alloc.NumSlabs(), 3);
+
+  Alloc.Reset();
+  ASSERT_EQ(Alloc.NumSlabs(), 1);
+  ASSERT_EQ(Alloc.BytesAllocated(), 1024);
+}
+
+TEST(TestArena, ASTContext) {
+  ASTContext Ctx;
+  IntegerLiteral *Int = Ctx.Create<IntegerLiteral>(42);
+  ASSERT_EQ(Int->Value(), 42);
+
+  std::vector<const Expr *> Elems = {Int, Int};
+  ArrayRef<const Expr *> Arr = Ctx.CreateArray(Elems);
+  Elems.clear();
+  ASSERT_EQ(Arr.Size(), 2);
+  ASSERT_EQ(Arr[0], Int);
+  ASSERT_EQ(Arr[1], Int);
+  ASSERT_TRUE(Ctx.CreateArray(Elems).Empty());
+
+  std::string Str = "\"abc\"";
+  StringRef Copy = Ctx.CopyString(Str);
+  Str[1] = 'x';
+  ASSERT_EQ(Copy, "\"abc\"");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
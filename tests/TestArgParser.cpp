@@ -22,6 +22,53 @@ TEST(TestArgParser, StringArgument) {
   ASSERT_STREQ(arg.getValue().c_str(), "arg");
 }
 
+TEST(TestArgParser, ArgAfterKeywordArg) {
+  std::vector<std::string> strargs = {
+      "exe", "--foo", "arg", "--bar", "2", "baz",
+  };
+  ArgParser parser;
+  parser.AddKeywordArgument<StringParsingMethod>("foo");
+  parser.AddKeywordArgument<IntegerParsingMethod>("bar");
+  parser.AddPositionalArgument<StringParsingMethod>("baz");
+
+  ParsedArgs parsed_args = parser.Parse(strargs);
+  ASSERT_TRUE(parser.DebugOk());
+  ASSERT_STREQ(parsed_args.GetArg<StringArgument>("foo").getValue().c_str(),
+               "arg");
+  ASSERT_EQ(parsed_args.GetArg<IntegerArgument>("bar").getValue(), 2);
+  ASSERT_STREQ(parsed_args.GetArg<StringArgument>("baz").getValue().c_str(),
+               "baz");
+}
+
+TEST(TestArgParser, InlineValue) {
+  std::vector<std::string> strargs = {
+      "exe",
+      "--foo=arg",
+      "--bar=2",
+  };
+  ArgParser parser;
+  parser.AddKeywordArgument<StringParsingMethod>("foo");
+  parser.AddKeywordArgument<IntegerParsingMethod>("bar");
+
+  ParsedArgs parsed_args = parser.Parse(strargs);
+  ASSERT_TRUE(parser.DebugOk());
+  ASSERT_STREQ(parsed_args.GetArg<StringArgument>("foo").getValue().c_str(),
+               "arg");
+  ASSERT_EQ(parsed_args.GetArg<IntegerArgument>("bar").getValue(), 2);
+}
+
+TEST(TestArgParser, InlineValueUnknownArg) {
+  std::vector<std::string> strargs = {
+      "exe",
+      "--baz=arg",
+  };
+  ArgParser parser;
+  parser.AddKeywordArgument<StringParsingMethod>("foo");
+
+  parser.Parse(strargs);
+  ASSERT_FALSE(parser.DebugOk());
+}
+
 TEST(TestArgParser, IntegerArgument) {
   std::vector<std::string> strargs = {
       "exe",
@@ -135,6 +182,35 @@ TEST(TestArgParser, ShortArgName) {
   ASSERT_STREQ(foo.getValue().c_str(), "abc");
 }
 
+TEST(TestArgParser, ShortArgInlineValue) {
+  std::vector<std::string> strargs = {
+      "exe",
+      "-O2",
+      "-fabc",
+  };
+  ArgParser parser;
+  struct KWArgParams opt_params = {};
+  opt_params.short_argname = 'O';
+  parser.AddKeywordArgument<IntegerParsingMethod>("opt", opt_params);
+  struct KWArgParams foo_params = {};
+  foo_params.short_argname = 'f';
+  parser.AddKeywordArgument<StringParsingMethod>("foo", foo_params);
+
+  ParsedArgs parsed_args = parser.Parse(strargs);
+  ASSERT_TRUE(parser.DebugOk());
+  ASSERT_EQ(parsed_args.GetArg<IntegerArgument>("opt").getValue(), 2);
+  ASSERT_STREQ(parsed_args.GetArg<StringArgument>("foo").getValue().c_str(),
+               "abc");
+
+  // Only arguments that take a value can have one attached.
+  ArgParser empty_parser;
+  struct KWArgParams verbose_params = {};
+  verbose_params.short_argname = 'v';
+  empty_parser.AddEmptyKeywordArgument("verbose", verbose_params);
+  empty_parser.Parse(std::vector<std::string>{"exe", "-v2"});
+  ASSERT_EQ(empty_parser.GetStatus(), lang::UNKNOWN_ARG);
+}
+
 TEST(TestArgParser, EmptyArg) {
   std::vector<std::string> strargs = {
       "exe",
@@ -0,0 +1,93 @@
+#include <string>
+#include <vector>
+
+#include "CharScan.h"
+#include "gtest/gtest.h"
+
+using lang::ScanImpl;
+
+namespace {
+
+const ScanImpl AllImpls[] = {lang::SCAN_SCALAR, lang::SCAN_SSE2,
+                             lang::SCAN_AVX2};
+
+typedef const char *(*ScanFunc)(const char *, const char *);
+
+/**
+ * Check that a scan function stops at the first character for which InRun
+ * is false for every supported implementation. Runs of every length up to a
+ * few vectors wide are checked, along with a few different terminators, so
+ * both the vector loops and the scalar tails are covered.
+ */
+template <class Pred>
+void CheckScan(ScanFunc Scan, const std::string &RunChars,
+               const std::string &StopChars, Pred InRun) {
+  ScanImpl Original = lang::GetScanImpl();
+  for (ScanImpl Impl : AllImpls) {
+    if (!lang::SetScanImpl(Impl)) continue;
+    for (unsigned Len = 0; Len < 100; ++Len) {
+      std::string Run;
+      for (unsigned i = 0; i < Len; ++i) Run += RunChars[i % RunChars.size()];
+
+      // Without a terminator, the whole buffer is consumed.
+      const char *Begin = Run.data();
+      ASSERT_EQ(Scan(Begin, Begin + Run.size()) - Begin, Len)
+          << "Impl " << Impl << ", length " << Len;
+
+      for (char Stop : StopChars) {
+        ASSERT_FALSE(InRun(Stop));
+        std::string Str = Run + Stop + RunChars;
+        Begin = Str.data();
+        ASSERT_EQ(Scan(Begin, Begin + Str.size()) - Begin, Len)
+            << "Impl " << Impl << ", length " << Len << ", stop '" << Stop
+            << "'";
+      }
+    }
+  }
+  lang::SetScanImpl(Original);
+}
+
+TEST(CharScanTest, ClassTableMatchesLocale) {
+  for (unsigned C = 0; C < 256; ++C) {
+    char Ch = static_cast<char>(C);
+    ASSERT_EQ(lang::CharClasses.Is(Ch, lang::CC_SPACE), isspace(C) != 0) << C;
+    ASSERT_EQ(lang::CharClasses.Is(Ch, lang::CC_DIGIT), isdigit(C) != 0) << C;
+    ASSERT_EQ(lang::CharClasses.Is(Ch, lang::CC_ALPHA), isalpha(C) != 0) << C;
+    ASSERT_EQ(lang::CharClasses.Is(Ch, lang::CC_IDENT), isalnum(C) != 0) << C;
+  }
+}
+
+TEST(CharScanTest, ScalarAlwaysSupported) {
+  ScanImpl Original = lang::GetScanImpl();
+  ASSERT_TRUE(lang::SetScanImpl(lang::SCAN_SCALAR));
+  ASSERT_EQ(lang::GetScanImpl(), lang::SCAN_SCALAR);
+  lang::SetScanImpl(Original);
+}
+
+TEST(CharScanTest, SkipWhitespace) {
+  CheckScan(lang::SkipWhitespace, " \t\n\v\f\r", "a0;\"\x80\x08\x0e",
+            [](char C) { return isspace(static_cast<unsigned char>(C)); });
+}
+
+TEST(CharScanTest, SkipIdentChars) {
+  CheckScan(lang::SkipIdentChars,
+            "abcxyzABCXYZ0189mM", " _;@[`{/:\x80\xe1\xfa",
+            [](char C) { return isalnum(static_cast<unsigned char>(C)); });
+}
+
+TEST(CharScanTest, SkipDigits) {
+  CheckScan(lang::SkipDigits, "0123456789", " a/:;\x80\xb0",
+            [](char C) { return isdigit(static_cast<unsigned char>(C)); });
+}
+
+TEST(CharScanTest, FindQuoteOrBackslash) {
+  CheckScan(lang::FindQuoteOrBackslash, "abc 123\n\t'", "\"\\",
+            [](char C) { return C != '"' && C != '\\'; });
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
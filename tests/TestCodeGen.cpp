@@ -0,0 +1,302 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "Backend.h"
+#include "CodeGen.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using lang::CodeGen;
+using lang::MemoryBuffer;
+using lang::Parser;
+
+namespace {
+
+// A different program for each seed.
+std::string GenerateSource(unsigned Seed) {
+  std::stringstream Src;
+  for (unsigned i = 0; i < 20 + Seed; ++i) {
+    Src << "int func" << i << "() {\n"
+        << "  printf(\"module " << Seed << " func " << i << "\\n\");\n"
+        << "  printf(\"%d %d\\n\", " << i << ", printf(\"nested\"));\n"
+        << "  return " << i * Seed << ";\n"
+        << "}\n";
+  }
+  return Src.str();
+}
+
+struct Compiled {
+  std::string IR;
+  std::string Object;
+  bool Ok = false;
+};
+
+/**
+ * Parse, lower, optimize and compile Src with nothing shared with any other
+ * compilation.
+ */
+Compiled Compile(const std::string &Src) {
+  Compiled Result;
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(Src);
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  if (!Parse.Ok()) return Result;
+
+  llvm::LLVMContext Context;
+  CodeGen Generator("test", Context);
+  Generator.Visit(*Mod);
+  if (llvm::verifyModule(Generator.Module(), &llvm::errs())) return Result;
+
+  lang::OptLevel Level;
+  lang::OptLevel::Parse("2", Level);
+  std::string Error;
+  std::unique_ptr<llvm::TargetMachine> TM =
+      lang::CreateTargetMachine(lang::TargetSpec(), Level, Error);
+  if (!TM) return Result;
+  lang::OptimizeModule(Generator.Module(), *TM, Level);
+
+  llvm::raw_string_ostream IR(Result.IR);
+  Generator.Module().print(IR, nullptr);
+  IR.flush();
+  llvm::SmallVector<char, 0> Object;
+  llvm::raw_svector_ostream Out(Object);
+  if (!lang::EmitObjectFile(Generator.Module(), *TM, Out)) return Result;
+  Result.Object.assign(Object.begin(), Object.end());
+  Result.Ok = true;
+  return Result;
+}
+
+TEST(TestCodeGen, HelloWorld) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      "int main() {\n"
+      "  printf(\"hello world\\n\");\n"
+      "  return 0;\n"
+      "}\n");
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.DebugOk());
+
+  llvm::LLVMContext Context;
+  CodeGen Generator("test", Context);
+  Generator.Visit(*Mod);
+  ASSERT_FALSE(llvm::verifyModule(Generator.Module(), &llvm::errs()));
+  ASSERT_EQ(&Generator.Module().getContext(), &Context);
+  ASSERT_NE(Generator.Module().getFunction("main"), nullptr);
+  ASSERT_NE(Generator.Module().getFunction("printf"), nullptr);
+}
+
+TEST(TestCodeGen, OptLevels) {
+  // Without -O the code generator runs at the level it always has.
+  lang::OptLevel Default;
+  ASSERT_EQ(Default.Speed, 0u);
+  ASSERT_EQ(Default.CodeGenLevel(), llvm::CodeGenOpt::Default);
+
+  lang::OptLevel Level;
+  ASSERT_TRUE(lang::OptLevel::Parse("0", Level));
+  ASSERT_EQ(Level.CodeGenLevel(), llvm::CodeGenOpt::None);
+  ASSERT_TRUE(lang::OptLevel::Parse("1", Level));
+  ASSERT_EQ(Level.CodeGenLevel(), llvm::CodeGenOpt::Less);
+  ASSERT_TRUE(lang::OptLevel::Parse("3", Level));
+  ASSERT_EQ(Level.CodeGenLevel(), llvm::CodeGenOpt::Aggressive);
+  ASSERT_TRUE(lang::OptLevel::Parse("s", Level));
+  ASSERT_EQ(Level.Speed, 2u);
+  ASSERT_EQ(Level.Size, 1u);
+  ASSERT_EQ(Level.CodeGenLevel(), llvm::CodeGenOpt::Default);
+
+  ASSERT_FALSE(lang::OptLevel::Parse("4", Level));
+  ASSERT_FALSE(lang::OptLevel::Parse("", Level));
+  ASSERT_FALSE(lang::OptLevel::Parse("22", Level));
+}
+
+TEST(TestCodeGen, ConcurrentCompilations) {
+  const unsigned kNumThreads = 8;
+  const unsigned kRounds = 3;
+
+  std::vector<std::string> Sources;
+  std::vector<Compiled> Expected;
+  for (unsigned i = 0; i < kNumThreads; ++i) {
+    Sources.push_back(GenerateSource(i));
+    Expected.push_back(Compile(Sources.back()));
+    ASSERT_TRUE(Expected.back().Ok);
+  }
+
+  // Every thread compiles its own program over and over, with all of them
+  // running at once.
+  std::vector<std::vector<Compiled>> Results(kNumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned i = 0; i < kNumThreads; ++i) {
+    Threads.emplace_back([&, i] {
+      for (unsigned Round = 0; Round < kRounds; ++Round)
+        Results[i].push_back(Compile(Sources[i]));
+    });
+  }
+  for (std::thread &T : Threads) T.join();
+
+  for (unsigned i = 0; i < kNumThreads; ++i) {
+    ASSERT_EQ(Results[i].size(), kRounds);
+    for (const Compiled &Result : Results[i]) {
+      ASSERT_TRUE(Result.Ok);
+      ASSERT_EQ(Result.IR, Expected[i].IR);
+      ASSERT_EQ(Result.Object, Expected[i].Object);
+    }
+  }
+}
+
+TEST(TestCodeGen, ParallelObjectIsTheSameForAnyThreadCount) {
+  // Enough functions that the module is split into several parts.
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      GenerateSource(600));
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.DebugOk());
+
+  lang::OptLevel Level;
+  lang::OptLevel::Parse("2", Level);
+  llvm::SmallString<128> TempPath;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("parallel", "o", TempPath));
+  std::string Path = TempPath.str().str();
+
+  std::string Expected;
+  for (unsigned NumThreads : {1, 2, 4}) {
+    llvm::LLVMContext Context;
+    CodeGen Generator("test", Context);
+    Generator.Visit(*Mod);
+    std::string Error;
+    ASSERT_TRUE(lang::EmitObjectFileParallel(Generator.ReleaseModule(),
+                                             lang::TargetSpec(), Level,
+                                             NumThreads, Path, Error))
+        << Error;
+
+    std::ifstream In(Path, std::ios::binary);
+    std::stringstream Object;
+    Object << In.rdbuf();
+    ASSERT_FALSE(Object.str().empty());
+    if (NumThreads == 1)
+      Expected = Object.str();
+    else
+      ASSERT_EQ(Object.str(), Expected) << NumThreads << " threads";
+  }
+  llvm::sys::fs::remove(Path);
+}
+
+TEST(TestCodeGen, PartitionNamesSharedLocalsForTheModule) {
+  // Two functions in different parts use the same unnamed private string.
+  auto Build = [](llvm::LLVMContext &Context, const char *Name) {
+    std::unique_ptr<llvm::Module> M(new llvm::Module("test", Context));
+    llvm::IRBuilder<> Builder(Context);
+    llvm::GlobalVariable *Str = nullptr;
+    for (const char *FuncName : {"main", Name}) {
+      llvm::Function *F = llvm::Function::Create(
+          llvm::FunctionType::get(Builder.getInt8PtrTy(), false),
+          llvm::GlobalValue::ExternalLinkage, FuncName, M.get());
+      Builder.SetInsertPoint(llvm::BasicBlock::Create(Context, "", F));
+      if (!Str) {
+        Str = Builder.CreateGlobalString("shared", "");
+        Str->setName("");
+      }
+      Builder.CreateRet(Builder.CreateBitCast(Str, Builder.getInt8PtrTy()));
+    }
+    return M;
+  };
+
+  llvm::LLVMContext Context;
+  std::vector<std::string> Names;
+  for (const char *Name : {"one", "two"}) {
+    std::vector<std::unique_ptr<llvm::Module>> Parts =
+        lang::PartitionModule(Build(Context, Name), 2);
+    ASSERT_EQ(Parts.size(), 2u);
+    for (const std::unique_ptr<llvm::Module> &Part : Parts)
+      ASSERT_FALSE(llvm::verifyModule(*Part, &llvm::errs()));
+
+    // The string is now visible to the other part, under a name that only
+    // this module uses.
+    llvm::GlobalVariable &Str = *Parts[0]->global_begin();
+    ASSERT_FALSE(Str.hasLocalLinkage());
+    ASSERT_EQ(Str.getVisibility(), llvm::GlobalValue::HiddenVisibility);
+    ASSERT_TRUE(Str.getName().startswith("__part_global."));
+    ASSERT_NE(Parts[1]->getNamedGlobal(Str.getName()), nullptr);
+    Names.push_back(Str.getName().str());
+  }
+  ASSERT_NE(Names[0], Names[1]);
+}
+
+TEST(TestCodeGen, RunMainCompilesFunctionsWhenCalled) {
+  // Each of 20 functions bumps a shared counter and calls the next one, so
+  // every call goes through a function that was not compiled yet.
+  auto Build = [](llvm::LLVMContext &Context) {
+    std::unique_ptr<llvm::Module> M(new llvm::Module("test", Context));
+    llvm::IRBuilder<> Builder(Context);
+    llvm::FunctionType *Type =
+        llvm::FunctionType::get(Builder.getInt32Ty(), false);
+    llvm::GlobalVariable *Calls = new llvm::GlobalVariable(
+        *M, Builder.getInt32Ty(), false, llvm::GlobalValue::InternalLinkage,
+        Builder.getInt32(0), "calls");
+    llvm::Function *Next = nullptr;
+    for (int i = 20; i >= 0; --i) {
+      llvm::Function *F = llvm::Function::Create(
+          Type, llvm::GlobalValue::ExternalLinkage,
+          i ? "func" + std::to_string(i) : "main", M.get());
+      Builder.SetInsertPoint(llvm::BasicBlock::Create(Context, "", F));
+      llvm::Value *Count = Builder.CreateAdd(
+          Builder.CreateLoad(Builder.getInt32Ty(), Calls), Builder.getInt32(1));
+      Builder.CreateStore(Count, Calls);
+      llvm::Value *Result = Builder.getInt32(i);
+      if (Next) Result = Builder.CreateAdd(Result, Builder.CreateCall(Next));
+      if (!i) {
+        Result = Builder.CreateAdd(
+            Result, Builder.CreateLoad(Builder.getInt32Ty(), Calls));
+      }
+      Builder.CreateRet(Result);
+      Next = F;
+    }
+    return M;
+  };
+
+  lang::TargetSpec Spec;
+  Spec.PIC = true;
+  for (unsigned NumThreads : {0, 1, 4}) {
+    llvm::LLVMContext Context;
+    std::unique_ptr<llvm::Module> M = Build(Context);
+    ASSERT_FALSE(llvm::verifyModule(*M, &llvm::errs()));
+    int ExitCode = 0;
+    std::string Error;
+    ASSERT_TRUE(lang::RunMain(std::move(M), Spec, lang::OptLevel(), NumThreads,
+                              ExitCode, Error))
+        << Error;
+    // The sum of 0 to 20 and one count for each of the 21 calls.
+    ASSERT_EQ(ExitCode, 210 + 21) << NumThreads << " threads";
+  }
+}
+
+TEST(TestCodeGen, RunMainWithoutMain) {
+  llvm::LLVMContext Context;
+  std::unique_ptr<llvm::Module> M(new llvm::Module("test", Context));
+  llvm::IRBuilder<> Builder(Context);
+  llvm::Function *F = llvm::Function::Create(
+      llvm::FunctionType::get(Builder.getInt32Ty(), false),
+      llvm::GlobalValue::ExternalLinkage, "start", M.get());
+  Builder.SetInsertPoint(llvm::BasicBlock::Create(Context, "", F));
+  Builder.CreateRet(Builder.getInt32(0));
+
+  lang::TargetSpec Spec;
+  Spec.PIC = true;
+  int ExitCode = 0;
+  std::string Error;
+  ASSERT_FALSE(lang::RunMain(std::move(M), Spec, lang::OptLevel(), 0, ExitCode,
+                             Error));
+  ASSERT_EQ(Error, "No main function");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <sstream>
+
+#include "AST/Dump.h"
+#include "AST/FlatAST.h"
+#include "Parser.h"
+#include "bench/BenchUtil.h"
+#include "gtest/gtest.h"
+
+using lang::Parser;
+using lang::Symbol;
+using lang::ast::FlatModule;
+using lang::ast::Module;
+using lang::ast::NodeRef;
+
+namespace {
+
+TEST(TestFlatAST, NodeRef) {
+  NodeRef Ref(lang::ast::FLAT_CALL, NodeRef::kMaxIdx);
+  ASSERT_EQ(Ref.Kind(), lang::ast::FLAT_CALL);
+  ASSERT_EQ(Ref.Idx(), NodeRef::kMaxIdx);
+  ASSERT_TRUE(Ref.Valid());
+  ASSERT_FALSE(NodeRef().Valid());
+}
+
+TEST(TestFlatAST, HelloWorld) {
+  std::stringstream Input;
+  Input << "int main(int a) {"
+           "  x : int;"
+           "  printf(\"hello world\\n\", a);"
+           "  return 0;"
+           "}";
+  Parser Parse(Input);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+
+  FlatModule Flat = FlatModule::FromModule(*Mod);
+  Mod.reset();
+
+  // Function, return type, argument and its type, var decl and its type,
+  // expr stmt, call, printf, string, a, return, 0.
+  ASSERT_EQ(Flat.NumNodes(), 13);
+  ASSERT_EQ(Flat.Funcs().size(), 1);
+  const lang::ast::FlatFunc &Func = Flat.Funcs()[0];
+  ASSERT_EQ(Func.Name, Symbol::Intern("main"));
+  ASSERT_EQ(Flat.AsTypename(Func.RetType).Name, lang::SYM_INT);
+
+  ASSERT_EQ(Func.Args.Size, 1);
+  const lang::ast::FlatArg &Arg = Flat.AsArg(Flat.Children(Func.Args)[0]);
+  ASSERT_EQ(Arg.Name, Symbol::Intern("a"));
+
+  lang::ArrayRef<NodeRef> Body = Flat.Children(Func.Body);
+  ASSERT_EQ(Body.Size(), 3);
+  ASSERT_EQ(Body[0].Kind(), lang::ast::FLAT_VAR_DECL);
+  ASSERT_FALSE(Flat.AsVarDecl(Body[0]).Init.Valid());
+
+  ASSERT_EQ(Body[1].Kind(), lang::ast::FLAT_EXPR_STMT);
+  const lang::ast::FlatCall &C = Flat.AsCall(Flat.AsExprStmt(Body[1]).E);
+  ASSERT_EQ(Flat.AsID(C.Caller).Name, lang::SYM_PRINTF);
+  lang::ArrayRef<NodeRef> CallArgs = Flat.Children(C.Args);
+  ASSERT_EQ(CallArgs.Size(), 2);
+  ASSERT_EQ(Flat.StrValue(Flat.AsStr(CallArgs[0])), "\"hello world\\n\"");
+  ASSERT_EQ(Flat.AsID(CallArgs[1]).Name, Symbol::Intern("a"));
+
+  ASSERT_EQ(Body[2].Kind(), lang::ast::FLAT_RETURN);
+  ASSERT_EQ(Flat.AsInt(Flat.AsReturn(Body[2]).Value).Val, 0);
+}
+
+TEST(TestFlatAST, DumpMatchesTree) {
+  std::string Src = lang::bench::GenerateSource(20);
+  std::stringstream Input(Src);
+  Parser Parse(Input);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+
+  std::stringstream TreeDump;
+  lang::ast::ASTDumper Dumper(TreeDump);
+  Dumper.Visit(*Mod);
+
+  FlatModule Flat = FlatModule::FromModule(*Mod);
+  std::stringstream FlatDump;
+  lang::ast::FlatASTDumper FlatDumper(Flat, FlatDump);
+  FlatDumper.Dump();
+
+  ASSERT_EQ(FlatDump.str(), TreeDump.str());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Interner.h"
+#include "gtest/gtest.h"
+
+using lang::Interner;
+using lang::Symbol;
+
+namespace {
+
+TEST(TestInterner, SameSpellingSameSymbol) {
+  std::string Spelling = "some_identifier";
+  Symbol Sym = Symbol::Intern(Spelling);
+  ASSERT_EQ(Sym, Symbol::Intern("some_identifier"));
+  ASSERT_NE(Sym, Symbol::Intern("some_other_identifier"));
+
+  // The interner keeps its own copy of the characters.
+  Spelling[0] = 'x';
+  ASSERT_EQ(Sym.Str(), "some_identifier");
+  ASSERT_NE(Sym.Str().Data(), Spelling.data());
+}
+
+TEST(TestInterner, WellKnownSymbols) {
+  ASSERT_EQ(Symbol::Intern(""), lang::SYM_EMPTY);
+  ASSERT_EQ(Symbol::Intern("int"), lang::SYM_INT);
+  ASSERT_EQ(Symbol::Intern("char"), lang::SYM_CHAR);
+  ASSERT_EQ(Symbol::Intern("printf"), lang::SYM_PRINTF);
+  ASSERT_TRUE(Symbol().Empty());
+  ASSERT_EQ(Symbol().Str(), "");
+}
+
+TEST(TestInterner, LongSpelling) {
+  std::string Spelling(100000, 'a');
+  Symbol Sym = Symbol::Intern(Spelling);
+  ASSERT_EQ(Sym.Str(), Spelling);
+  ASSERT_EQ(Sym, Symbol::Intern(Spelling));
+}
+
+TEST(TestInterner, ConcurrentInterning) {
+  const unsigned NumThreads = 4;
+  const unsigned NumSpellings = 1000;
+  std::vector<std::vector<Symbol>> Syms(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned i = 0; i < NumThreads; ++i) {
+    Threads.emplace_back([i, &Syms] {
+      for (unsigned j = 0; j < NumSpellings; ++j)
+        Syms[i].push_back(Symbol::Intern("concurrent" + std::to_string(j)));
+    });
+  }
+  for (auto &Thread : Threads) Thread.join();
+
+  size_t Size = Interner::Global().Size();
+  for (unsigned j = 0; j < NumSpellings; ++j) {
+    for (unsigned i = 1; i < NumThreads; ++i) ASSERT_EQ(Syms[i][j], Syms[0][j]);
+    ASSERT_EQ(Syms[0][j].Str(), "concurrent" + std::to_string(j));
+  }
+  ASSERT_EQ(Interner::Global().Size(), Size);
+}
+
+TEST(TestInterner, SpellingsWhileInterning) {
+  // Enough symbols that their spellings span several chunks.
+  const unsigned NumSpellings = 20000;
+  std::vector<Symbol> Syms(NumSpellings);
+  std::thread Writer([&Syms] {
+    for (unsigned j = 0; j < NumSpellings; ++j)
+      Syms[j] = Symbol::Intern("many" + std::to_string(j));
+  });
+
+  // Look up spellings that already exist while new ones are being added.
+  Symbol Int = Symbol::Intern("int");
+  for (unsigned j = 0; j < NumSpellings; ++j) ASSERT_EQ(Int.Str(), "int");
+  Writer.join();
+
+  for (unsigned j = 0; j < NumSpellings; ++j) {
+    ASSERT_EQ(Syms[j].Str(), "many" + std::to_string(j));
+    ASSERT_EQ(Syms[j], Symbol::Intern("many" + std::to_string(j)));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -3,33 +3,51 @@
 #include <cstdlib>
 #include <fstream>
 #include <sstream>
+#include <type_traits>
 
 #include "Lexer.h"
+#include "SourceManager.h"
+#include "ThreadPool.h"
+#include "TokenStream.h"
 #include "gtest/gtest.h"
 
-#define TEST_SINGLE_TOKEN(STR, KIND, TEST_NAME) \
-  TEST_F(LexerTest, TEST_NAME) {                \
-    Input_ << STR;                              \
-    Lexer Lex(Input_);                          \
-    Token Tok;                                  \
-    ASSERT_TRUE(Lex.ReadToken(Tok));            \
-    ASSERT_STREQ(Tok.Chars.c_str(), STR);       \
-    ASSERT_EQ(Tok.Kind, KIND);                  \
-    ASSERT_EQ(Tok.Row, 0);                      \
-    ASSERT_EQ(Tok.Col, 0);                      \
-    ASSERT_EQ(Lex.Row(), 0);                    \
-    ASSERT_EQ(Lex.Col(), Tok.Chars.length());   \
-    unsigned Len = Tok.Chars.length();          \
-    ASSERT_TRUE(Lex.ReadToken(Tok));            \
-    ASSERT_EQ(Tok.Kind, lang::TOK_EOF);         \
-    ASSERT_EQ(Tok.Row, 0);                      \
-    ASSERT_EQ(Tok.Col, Len);                    \
-    ASSERT_EQ(Lex.Row(), 0);                    \
-    ASSERT_EQ(Lex.Col(), Len);                  \
+#define CHECK_SINGLE_TOKEN(STR, KIND, LEX) \
+  Token Tok;                               \
+  ASSERT_TRUE(LEX.ReadToken(Tok));         \
+  ASSERT_EQ(LEX.Text(Tok), STR);           \
+  ASSERT_EQ(Tok.Kind, KIND);               \
+  ASSERT_EQ(LEX.Location(Tok).Row, 0);     \
+  ASSERT_EQ(LEX.Location(Tok).Col, 0);     \
+  ASSERT_EQ(LEX.Row(), 0);                 \
+  ASSERT_EQ(LEX.Col(), Tok.Length);        \
+  unsigned Len = Tok.Length;               \
+  ASSERT_TRUE(LEX.ReadToken(Tok));         \
+  ASSERT_EQ(Tok.Kind, lang::TOK_EOF);      \
+  ASSERT_EQ(LEX.Location(Tok).Row, 0);     \
+  ASSERT_EQ(LEX.Location(Tok).Col, Len);   \
+  ASSERT_EQ(LEX.Row(), 0);                 \
+  ASSERT_EQ(LEX.Col(), Len);
+
+#define TEST_SINGLE_TOKEN(STR, KIND, TEST_NAME)                        \
+  TEST_F(LexerTest, TEST_NAME) {                                       \
+    Input_ << STR;                                                     \
+    Lexer Lex(Input_);                                                 \
+    CHECK_SINGLE_TOKEN(STR, KIND, Lex)                                 \
+  }                                                                    \
+  TEST_F(LexerTest, TEST_NAME##FromBuffer) {                           \
+    std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(STR); \
+    Lexer Lex(*Buf);                                                   \
+    CHECK_SINGLE_TOKEN(STR, KIND, Lex)                                 \
   }
 
+using lang::FileID;
 using lang::Lexer;
+using lang::MemoryBuffer;
+using lang::SourceManager;
+using lang::Symbol;
+using lang::ThreadPool;
 using lang::Token;
+using lang::TokenStream;
 
 namespace {
 
@@ -43,8 +61,8 @@ TEST_F(LexerTest, ValidFile) {
   Lexer Lex(Input_);
   Token Tok;
   ASSERT_TRUE(Lex.ReadToken(Tok));
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
   ASSERT_EQ(Lex.Row(), 0);
   ASSERT_EQ(Lex.Col(), 1);
 }
@@ -54,8 +72,8 @@ TEST_F(LexerTest, EmptyFile) {
   Token Tok;
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
   ASSERT_EQ(Lex.Row(), 0);
   ASSERT_EQ(Lex.Col(), 0);
 }
@@ -65,14 +83,14 @@ TEST_F(LexerTest, MultipleEOFReads) {
   Token Tok;
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
   ASSERT_EQ(Lex.Row(), 0);
   ASSERT_EQ(Lex.Col(), 0);
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
   ASSERT_EQ(Lex.Row(), 0);
   ASSERT_EQ(Lex.Col(), 0);
 }
@@ -85,18 +103,18 @@ TEST_F(LexerTest, NewlineRowUpdate) {
   Token Tok;
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 3);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 3);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
@@ -110,6 +128,19 @@ TEST_SINGLE_TOKEN("return123", lang::TOK_ID, WholeWordGrabbed)
 
 TEST_SINGLE_TOKEN("return", lang::TOK_RETURN, ReadReturn)
 
+// The parser has no control flow or structs yet, so these are still
+// identifiers.
+TEST_SINGLE_TOKEN("if", lang::TOK_ID, IfIsIdentifier)
+TEST_SINGLE_TOKEN("while", lang::TOK_ID, WhileIsIdentifier)
+TEST_SINGLE_TOKEN("struct", lang::TOK_ID, StructIsIdentifier)
+
+// These hash to the same slot as a keyword or differ from one by a single
+// character.
+TEST_SINGLE_TOKEN("rn", lang::TOK_ID, KeywordFirstAndLastChar)
+TEST_SINGLE_TOKEN("retarn", lang::TOK_ID, KeywordSameLengthAndEnds)
+TEST_SINGLE_TOKEN("returns", lang::TOK_ID, KeywordPrefix)
+TEST_SINGLE_TOKEN("retur", lang::TOK_ID, KeywordTruncated)
+
 TEST_SINGLE_TOKEN("128", lang::TOK_INT, ReadInt)
 
 TEST_SINGLE_TOKEN(";", lang::TOK_SEMICOL, ReadSemicol)
@@ -123,6 +154,7 @@ TEST_SINGLE_TOKEN("\"abcde\"", lang::TOK_STR, ReadStr)
 TEST_SINGLE_TOKEN("\"ab cd e\"", lang::TOK_STR, ReadStrWithSpaces)
 TEST_SINGLE_TOKEN("\"ab \\n e\"", lang::TOK_STR, ReadStrWithEscape)
 TEST_SINGLE_TOKEN("\"a \\\"b \\\" c\"", lang::TOK_STR, ReadStrWithEscapedQuote)
+TEST_SINGLE_TOKEN("\"a \\\\\"", lang::TOK_STR, ReadStrWithEscapedBackslash)
 
 TEST_F(LexerTest, SkipWhitespace) {
   Input_ << "return var";
@@ -131,7 +163,7 @@ TEST_F(LexerTest, SkipWhitespace) {
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RETURN);
   ASSERT_TRUE(Lex.ReadToken(Tok));
-  ASSERT_STREQ(Tok.Chars.c_str(), "var");
+  ASSERT_EQ(Lex.Text(Tok), "var");
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
 }
 
@@ -197,78 +229,78 @@ TEST_F(LexerTest, HelloWorld) {
   Token Tok;
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_STREQ(Tok.Chars.c_str(), "int");
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Text(Tok), "int");
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_STREQ(Tok.Chars.c_str(), "main");
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 4);
+  ASSERT_EQ(Lex.Text(Tok), "main");
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 4);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_LPAR);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 8);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 8);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RPAR);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 9);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 9);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_LBRACE);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 11);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 11);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_STREQ(Tok.Chars.c_str(), "printf");
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 2);
+  ASSERT_EQ(Lex.Text(Tok), "printf");
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 2);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_LPAR);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 8);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 8);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_STR);
-  ASSERT_STREQ(Tok.Chars.c_str(), "\"hello world\\n\"");
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 9);
+  ASSERT_EQ(Lex.Text(Tok), "\"hello world\\n\"");
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 9);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RPAR);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 24);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 24);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_SEMICOL);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 25);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 25);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RETURN);
-  ASSERT_EQ(Tok.Row, 2);
-  ASSERT_EQ(Tok.Col, 2);
+  ASSERT_EQ(Lex.Location(Tok).Row, 2);
+  ASSERT_EQ(Lex.Location(Tok).Col, 2);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_INT);
-  ASSERT_STREQ(Tok.Chars.c_str(), "0");
-  ASSERT_EQ(Tok.Row, 2);
-  ASSERT_EQ(Tok.Col, 9);
+  ASSERT_EQ(Lex.Text(Tok), "0");
+  ASSERT_EQ(Lex.Location(Tok).Row, 2);
+  ASSERT_EQ(Lex.Location(Tok).Col, 9);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_SEMICOL);
-  ASSERT_EQ(Tok.Row, 2);
-  ASSERT_EQ(Tok.Col, 10);
+  ASSERT_EQ(Lex.Location(Tok).Row, 2);
+  ASSERT_EQ(Lex.Location(Tok).Col, 10);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RBRACE);
-  ASSERT_EQ(Tok.Row, 3);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 3);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
 
   ASSERT_TRUE(Lex.ReachedEOF());
   ASSERT_TRUE(Lex.ReadToken(Tok));
@@ -287,23 +319,23 @@ TEST_F(LexerTest, PeekToken) {
   Token Tok;
   ASSERT_TRUE(Lex.PeekToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RETURN);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RETURN);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
 
   ASSERT_TRUE(Lex.PeekToken(Tok));
-  ASSERT_STREQ(Tok.Chars.c_str(), "var");
+  ASSERT_EQ(Lex.Text(Tok), "var");
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 7);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 7);
   ASSERT_TRUE(Lex.ReadToken(Tok));
-  ASSERT_STREQ(Tok.Chars.c_str(), "var");
+  ASSERT_EQ(Lex.Text(Tok), "var");
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 7);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 7);
 
   ASSERT_TRUE(Lex.PeekToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
@@ -317,78 +349,78 @@ TEST_F(LexerTest, HelloWorldFromFile) {
   Token Tok;
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_STREQ(Tok.Chars.c_str(), "int");
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Text(Tok), "int");
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_STREQ(Tok.Chars.c_str(), "main");
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 4);
+  ASSERT_EQ(Lex.Text(Tok), "main");
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 4);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_LPAR);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 8);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 8);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RPAR);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 9);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 9);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_LBRACE);
-  ASSERT_EQ(Tok.Row, 0);
-  ASSERT_EQ(Tok.Col, 11);
+  ASSERT_EQ(Lex.Location(Tok).Row, 0);
+  ASSERT_EQ(Lex.Location(Tok).Col, 11);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_ID);
-  ASSERT_STREQ(Tok.Chars.c_str(), "printf");
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 2);
+  ASSERT_EQ(Lex.Text(Tok), "printf");
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 2);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_LPAR);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 8);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 8);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_STR);
-  ASSERT_STREQ(Tok.Chars.c_str(), "\"hello world\\n\"");
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 9);
+  ASSERT_EQ(Lex.Text(Tok), "\"hello world\\n\"");
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 9);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RPAR);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 24);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 24);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_SEMICOL);
-  ASSERT_EQ(Tok.Row, 1);
-  ASSERT_EQ(Tok.Col, 25);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 25);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RETURN);
-  ASSERT_EQ(Tok.Row, 2);
-  ASSERT_EQ(Tok.Col, 2);
+  ASSERT_EQ(Lex.Location(Tok).Row, 2);
+  ASSERT_EQ(Lex.Location(Tok).Col, 2);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_INT);
-  ASSERT_STREQ(Tok.Chars.c_str(), "0");
-  ASSERT_EQ(Tok.Row, 2);
-  ASSERT_EQ(Tok.Col, 9);
+  ASSERT_EQ(Lex.Text(Tok), "0");
+  ASSERT_EQ(Lex.Location(Tok).Row, 2);
+  ASSERT_EQ(Lex.Location(Tok).Col, 9);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_SEMICOL);
-  ASSERT_EQ(Tok.Row, 2);
-  ASSERT_EQ(Tok.Col, 10);
+  ASSERT_EQ(Lex.Location(Tok).Row, 2);
+  ASSERT_EQ(Lex.Location(Tok).Col, 10);
 
   ASSERT_TRUE(Lex.ReadToken(Tok));
   ASSERT_EQ(Tok.Kind, lang::TOK_RBRACE);
-  ASSERT_EQ(Tok.Row, 3);
-  ASSERT_EQ(Tok.Col, 0);
+  ASSERT_EQ(Lex.Location(Tok).Row, 3);
+  ASSERT_EQ(Lex.Location(Tok).Col, 0);
 
   ASSERT_TRUE(Lex.ReachedEOF());
   ASSERT_TRUE(Lex.ReadToken(Tok));
@@ -396,6 +428,250 @@ TEST_F(LexerTest, HelloWorldFromFile) {
   ASSERT_TRUE(Lex.ReachedEOF());
 }
 
+TEST_F(LexerTest, BufferMatchesStream) {
+  std::ifstream Input("examples/hello_world.lang");
+  Lexer StreamLex(Input);
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromFile("examples/hello_world.lang");
+  ASSERT_NE(Buf, nullptr);
+  Lexer BufLex(*Buf);
+
+  Token StreamTok, BufTok;
+  do {
+    ASSERT_TRUE(StreamLex.ReadToken(StreamTok));
+    ASSERT_TRUE(BufLex.ReadToken(BufTok));
+    ASSERT_EQ(StreamTok.Kind, BufTok.Kind);
+    ASSERT_EQ(StreamLex.Text(StreamTok), BufLex.Text(BufTok));
+    ASSERT_EQ(StreamLex.Location(StreamTok).Row, BufLex.Location(BufTok).Row);
+    ASSERT_EQ(StreamLex.Location(StreamTok).Col, BufLex.Location(BufTok).Col);
+  } while (BufTok.Kind != lang::TOK_EOF);
+  ASSERT_TRUE(BufLex.ReachedEOF());
+}
+
+TEST_F(LexerTest, MissingFileBuffer) {
+  ASSERT_EQ(MemoryBuffer::FromFile("examples/does_not_exist.lang"), nullptr);
+}
+
+TEST_F(LexerTest, EmptyBuffer) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString("");
+  Lexer Lex(*Buf);
+  ASSERT_TRUE(Lex.ReachedEOF());
+  Token Tok;
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
+}
+
+TEST_F(LexerTest, BufferLexErrorLoc) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(std::string("\nab ") + static_cast<char>(128));
+  Lexer Lex(*Buf);
+  Token Tok;
+
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_ID);
+
+  ASSERT_FALSE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Lex.CharReadOnErr(), 128);
+  ASSERT_EQ(Lex.Row(), 1);
+  ASSERT_EQ(Lex.Col(), 3);
+
+  ASSERT_FALSE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Lex.CharReadOnErr(), 128);
+  ASSERT_EQ(Lex.Row(), 1);
+  ASSERT_EQ(Lex.Col(), 3);
+}
+
+TEST_F(LexerTest, BufferMultiLineStr) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString("\"a\nb\" c");
+  Lexer Lex(*Buf);
+  Token Tok;
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_STR);
+  ASSERT_EQ(Lex.Text(Tok), "\"a\nb\"");
+
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_ID);
+  ASSERT_EQ(Lex.Location(Tok).Row, 1);
+  ASSERT_EQ(Lex.Location(Tok).Col, 3);
+}
+
+TEST_F(LexerTest, EscapedBackslashEndsStr) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString("\"a\\\\\" \"b\"");
+  Lexer Lex(*Buf);
+  Token Tok;
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_STR);
+  ASSERT_EQ(Lex.Text(Tok), "\"a\\\\\"");
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_STR);
+  ASSERT_EQ(Lex.Text(Tok), "\"b\"");
+}
+
+TEST_F(LexerTest, TrailingBackslashInStr) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString("\"abc\\");
+  Lexer Lex(*Buf);
+  Token Tok;
+  ASSERT_FALSE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Lex.CharReadOnErr(), EOF);
+}
+
+TEST_F(LexerTest, BufferUnterminatedStr) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString("a \"abc");
+  Lexer Lex(*Buf);
+  Token Tok;
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_FALSE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Lex.CharReadOnErr(), EOF);
+  ASSERT_EQ(Lex.Row(), 0);
+  ASSERT_EQ(Lex.Col(), 2);
+}
+
+TEST_F(LexerTest, TokensPointIntoSourceBuffer) {
+  static_assert(std::is_trivially_copyable<Token>::value,
+                "Tokens should be cheap to copy");
+
+  SourceManager SM;
+  SM.AddBuffer(MemoryBuffer::FromString("unused"));
+  FileID File = SM.AddBuffer(MemoryBuffer::FromString("abc def"));
+  Lexer Lex(SM.Buffer(File), File);
+  Token Tok;
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.File, File);
+  ASSERT_EQ(Tok.Offset, 4);
+  ASSERT_EQ(Tok.Length, 3);
+  ASSERT_EQ(SM.Text(Tok), "def");
+  ASSERT_EQ(SM.Text(Tok).Data(), SM.Buffer(File).Begin() + 4);
+}
+
+TEST_F(LexerTest, IdentifiersAreInterned) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString("printf abc return abc 12");
+  Lexer Lex(*Buf);
+  Token Tok;
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Sym, lang::SYM_PRINTF);
+
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  Symbol ABC = Tok.Sym;
+  ASSERT_EQ(ABC.Str(), "abc");
+
+  // Only identifiers get symbols.
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_RETURN);
+  ASSERT_TRUE(Tok.Sym.Empty());
+
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Sym, ABC);
+
+  ASSERT_TRUE(Lex.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_INT);
+  ASSERT_TRUE(Tok.Sym.Empty());
+}
+
+TEST_F(LexerTest, TokenStreamMatchesLexer) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromFile("examples/hello_world.lang");
+  ASSERT_NE(Buf, nullptr);
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+  ASSERT_FALSE(Toks.HasError());
+
+  Lexer Lex(*Buf);
+  Token Tok;
+  size_t i = 0;
+  do {
+    ASSERT_TRUE(Lex.ReadToken(Tok));
+    ASSERT_LT(i, Toks.Size());
+    Token StreamTok = Toks.Get(i);
+    ASSERT_EQ(StreamTok.Kind, Tok.Kind);
+    ASSERT_EQ(StreamTok.Offset, Tok.Offset);
+    ASSERT_EQ(StreamTok.Length, Tok.Length);
+    ASSERT_EQ(Toks.Text(i), Lex.Text(Tok));
+    ++i;
+  } while (Tok.Kind != lang::TOK_EOF);
+  ASSERT_EQ(i, Toks.Size());
+  ASSERT_EQ(Toks.Kind(Toks.Size() - 1), lang::TOK_EOF);
+}
+
+TEST_F(LexerTest, TokenStreamEmpty) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString("  ");
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+  ASSERT_EQ(Toks.Size(), 1);
+  ASSERT_EQ(Toks.Kind(0), lang::TOK_EOF);
+}
+
+TEST_F(LexerTest, TokenStreamError) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(std::string("\nab ") + static_cast<char>(128));
+  TokenStream Toks(*Buf);
+  ASSERT_FALSE(Toks.LexAll());
+  ASSERT_TRUE(Toks.HasError());
+  ASSERT_EQ(Toks.Size(), 1);
+  ASSERT_EQ(Toks.Kind(0), lang::TOK_ID);
+  ASSERT_EQ(Toks.CharReadOnErr(), 128);
+  ASSERT_EQ(Toks.ErrRow(), 1);
+  ASSERT_EQ(Toks.ErrCol(), 3);
+}
+
+/**
+ * Lex the string serially and in parallel with different numbers of chunks
+ * and check that the streams are identical.
+ */
+void CheckParallelLexMatchesSerial(const std::string &Src) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(Src);
+  TokenStream Serial(*Buf);
+  bool SerialOk = Serial.LexAll();
+
+  ThreadPool Pool(4);
+  for (unsigned NumChunks = 1; NumChunks <= 32; ++NumChunks) {
+    TokenStream Parallel(*Buf);
+    ASSERT_EQ(Parallel.LexAllParallel(Pool, NumChunks), SerialOk);
+    ASSERT_TRUE(Parallel == Serial) << NumChunks << " chunks";
+  }
+}
+
+std::string GenerateSource(unsigned NumFuncs) {
+  std::stringstream Src;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Src << "int func" << i << "(int a) {\n"
+        << "  printf(\"multi\nline \\\" string\n\\\\\", " << i << ");\n"
+        << "\n\t return a;\n"
+        << "}\n";
+  }
+  return Src.str();
+}
+
+TEST_F(LexerTest, ParallelTokenStreamMatchesSerial) {
+  CheckParallelLexMatchesSerial(GenerateSource(50));
+}
+
+TEST_F(LexerTest, ParallelTokenStreamEdgeCases) {
+  CheckParallelLexMatchesSerial("");
+  CheckParallelLexMatchesSerial("\n\n\n");
+  CheckParallelLexMatchesSerial("abc");
+  CheckParallelLexMatchesSerial("\"\n\n\n\n\n\n\n\n\n\n\n\n\"\n");
+  CheckParallelLexMatchesSerial("\"\\\n\\\"\n\n\n\n\n\n\n\"\n\nabc\n");
+}
+
+TEST_F(LexerTest, ParallelTokenStreamErrors) {
+  std::string Src = GenerateSource(20);
+
+  // An unknown character in the middle of the file
+  std::string BadChar = Src;
+  BadChar[BadChar.size() / 2] = static_cast<char>(128);
+  CheckParallelLexMatchesSerial(BadChar);
+
+  // An unterminated string that swallows the rest of the file
+  std::string Unterminated = Src;
+  Unterminated.insert(Unterminated.size() / 3, "\"");
+  CheckParallelLexMatchesSerial(Unterminated);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
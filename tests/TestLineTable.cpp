@@ -0,0 +1,73 @@
+#include <string>
+
+#include "CharScan.h"
+#include "LineTable.h"
+#include "MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using lang::LineCol;
+using lang::LineTable;
+using lang::MemoryBuffer;
+using lang::ScanImpl;
+
+namespace {
+
+/**
+ * Check every offset in the string, including one past the end, against a
+ * row and col counted one character at a time.
+ */
+void CheckLineTable(const std::string &Src) {
+  LineTable Lines(Src.data(), Src.data() + Src.size());
+  unsigned Row = 0, Col = 0;
+  for (size_t i = 0; i <= Src.size(); ++i) {
+    LineCol Loc = Lines.Lookup(i);
+    ASSERT_EQ(Loc.Row, Row) << "offset " << i;
+    ASSERT_EQ(Loc.Col, Col) << "offset " << i;
+    if (i < Src.size() && Src[i] == '\n') {
+      ++Row;
+      Col = 0;
+    } else {
+      ++Col;
+    }
+  }
+  ASSERT_EQ(Lines.NumLines(), Row + 1);
+}
+
+TEST(LineTableTest, Empty) { CheckLineTable(""); }
+
+TEST(LineTableTest, NoNewlines) { CheckLineTable("abc def"); }
+
+TEST(LineTableTest, OnlyNewlines) { CheckLineTable("\n\n\n"); }
+
+TEST(LineTableTest, EveryImplementation) {
+  // Long enough to cover the vector loops and the scalar tails, with lines
+  // of every length up to a couple of vectors wide.
+  std::string Src;
+  for (unsigned Len = 0; Len < 70; ++Len) Src += std::string(Len, 'a') + "\n";
+  Src += "no newline at the end";
+
+  ScanImpl Original = lang::GetScanImpl();
+  for (ScanImpl Impl : {lang::SCAN_SCALAR, lang::SCAN_SSE2, lang::SCAN_AVX2}) {
+    if (!lang::SetScanImpl(Impl)) continue;
+    CheckLineTable(Src);
+  }
+  lang::SetScanImpl(Original);
+}
+
+TEST(LineTableTest, BuiltLazilyByBuffer) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString("a\nbc\nd");
+  const LineTable &Lines = Buf->Lines();
+  ASSERT_EQ(&Lines, &Buf->Lines());
+  ASSERT_EQ(Lines.NumLines(), 3);
+  ASSERT_EQ(Lines.Lookup(4).Row, 1);
+  ASSERT_EQ(Lines.Lookup(4).Col, 2);
+  ASSERT_EQ(Lines.Lookup(5).Row, 2);
+  ASSERT_EQ(Lines.Lookup(5).Col, 0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,9 +1,21 @@
+#include <cassert>
+#include <chrono>
 #include <fstream>
+#include <sstream>
 
+#include "AST/ASTWalker.h"
+#include "AST/Dump.h"
 #include "Parser.h"
 #include "gtest/gtest.h"
 
+using lang::ArrayRef;
+using lang::MemoryBuffer;
 using lang::Parser;
+using lang::StringRef;
+using lang::TextEdit;
+using lang::Symbol;
+using lang::ThreadPool;
+using lang::TokenStream;
 using lang::ast::ArgumentDeclaration;
 using lang::ast::Call;
 using lang::ast::Expr;
@@ -20,30 +32,30 @@ using lang::ast::Type;
 using lang::ast::Typename;
 using lang::ast::VarDecl;
 
-#define TEST_PARSER_ERR(CLASS, INPUT, TOK_KIND, PERR, PERR_NAME)   \
-  TEST_F(ParserTest, Parse##CLASS##_##PERR_NAME) {                 \
-    Input_ << INPUT;                                               \
-    Parser Parse(Input_);                                          \
-    std::unique_ptr<lang::ast::CLASS> node = Parse.Parse##CLASS(); \
-    ASSERT_FALSE(Parse.Ok());                                      \
-    ASSERT_EQ(node, nullptr);                                      \
-    ASSERT_EQ(Parse.Status(), PERR);                               \
-    ASSERT_EQ(Parse.LastReadTok().Kind, TOK_KIND);                 \
-    ASSERT_STREQ(Parse.LastReadTok().Chars.c_str(), INPUT);        \
+#define TEST_PARSER_ERR(CLASS, INPUT, TOK_KIND, PERR, PERR_NAME) \
+  TEST_F(ParserTest, Parse##CLASS##_##PERR_NAME) {               \
+    Input_ << INPUT;                                             \
+    Parser Parse(Input_);                                        \
+    lang::ast::CLASS *node = Parse.Parse##CLASS();               \
+    ASSERT_FALSE(Parse.Ok());                                    \
+    ASSERT_EQ(node, nullptr);                                    \
+    ASSERT_EQ(Parse.Status(), PERR);                             \
+    ASSERT_EQ(Parse.LastReadTok().Kind, TOK_KIND);               \
+    ASSERT_EQ(Parse.Lex().Text(Parse.LastReadTok()), INPUT);     \
   }
 
 #define TEST_UNEXPECTED_TOKEN(CLASS, INPUT, TOK_KIND)                       \
   TEST_PARSER_ERR(CLASS, INPUT, TOK_KIND, lang::PSTAT_UNEXPECTED_TOKEN_ERR, \
                   UnexpectedError)
 
-#define TEST_PARSE_EXPR(CLASS, INPUT)                      \
-  TEST_F(ParserTest, ParseExpr##CLASS) {                   \
-    Input_ << INPUT;                                       \
-    Parser Parse(Input_);                                  \
-    std::unique_ptr<Expr> expr = Parse.ParseExpr();        \
-    ASSERT_TRUE(Parse.Ok());                               \
-    ASSERT_NE(expr, nullptr);                              \
-    ASSERT_NE(dynamic_cast<CLASS *>(expr.get()), nullptr); \
+#define TEST_PARSE_EXPR(CLASS, INPUT)                \
+  TEST_F(ParserTest, ParseExpr##CLASS) {             \
+    Input_ << INPUT;                                 \
+    Parser Parse(Input_);                            \
+    Expr *expr = Parse.ParseExpr();                  \
+    ASSERT_TRUE(Parse.Ok());                         \
+    ASSERT_NE(expr, nullptr);                        \
+    ASSERT_TRUE(lang::isa<CLASS>(expr));             \
   }
 
 namespace {
@@ -57,7 +69,7 @@ TEST_F(ParserTest, ParseBadToken) {
   Input_ << "\n\"abcde\"" << static_cast<char>(128);
   Parser Parse(Input_);
 
-  std::unique_ptr<StringLiteral> Str = Parse.ParseStringLiteral();
+  StringLiteral *Str = Parse.ParseStringLiteral();
   ASSERT_TRUE(Parse.Ok());
 
   Str = Parse.ParseStringLiteral();
@@ -69,13 +81,32 @@ TEST_F(ParserTest, ParseBadToken) {
   ASSERT_EQ(Parse.Lex().Col(), 7);
 }
 
+TEST_F(ParserTest, ParseBadTokenFromTokenStream) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      std::string("\n\"abcde\"") + static_cast<char>(128));
+  TokenStream Toks(*Buf);
+  ASSERT_FALSE(Toks.LexAll());
+  Parser Parse(Toks);
+
+  StringLiteral *Str = Parse.ParseStringLiteral();
+  ASSERT_TRUE(Parse.Ok());
+
+  Str = Parse.ParseStringLiteral();
+  ASSERT_FALSE(Parse.Ok());
+  ASSERT_EQ(Str, nullptr);
+  ASSERT_EQ(Parse.Status(), lang::PSTAT_LEXER_ERR);
+  ASSERT_EQ(Toks.CharReadOnErr(), 128);
+  ASSERT_EQ(Toks.ErrRow(), 1);
+  ASSERT_EQ(Toks.ErrCol(), 7);
+}
+
 TEST_F(ParserTest, ParseStringLiteral) {
   Input_ << "\"abcde\"";
   Parser Parse(Input_);
-  std::unique_ptr<StringLiteral> Str = Parse.ParseStringLiteral();
+  StringLiteral *Str = Parse.ParseStringLiteral();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(Str, nullptr);
-  ASSERT_STREQ(Str->Value().c_str(), "\"abcde\"");
+  ASSERT_EQ(Str->Value(), StringRef("\"abcde\""));
 }
 
 TEST_UNEXPECTED_TOKEN(StringLiteral, "123", lang::TOK_INT)
@@ -83,7 +114,7 @@ TEST_UNEXPECTED_TOKEN(StringLiteral, "123", lang::TOK_INT)
 TEST_F(ParserTest, ParseIntegerLiteral) {
   Input_ << "123";
   Parser Parse(Input_);
-  std::unique_ptr<IntegerLiteral> Int = Parse.ParseIntegerLiteral();
+  IntegerLiteral *Int = Parse.ParseIntegerLiteral();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(Int, nullptr);
   ASSERT_EQ(Int->Value(), 123);
@@ -96,97 +127,97 @@ TEST_PARSER_ERR(IntegerLiteral, "36893488147419103232" /*2^65*/, lang::TOK_INT,
 TEST_F(ParserTest, ParseID) {
   Input_ << "abcde";
   Parser Parse(Input_);
-  std::unique_ptr<Expr> id = Parse.ParseIDExpr();
+  Expr *id = Parse.ParseIDExpr();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(id, nullptr);
-  ASSERT_NE(dynamic_cast<const ID *>(id.get()), nullptr);
-  ASSERT_STREQ(dynamic_cast<const ID *>(id.get())->Name().c_str(), "abcde");
+  ASSERT_NE(lang::dyn_cast<ID>(id), nullptr);
+  ASSERT_EQ(lang::dyn_cast<ID>(id)->Name(), Symbol::Intern("abcde"));
 }
 
 TEST_F(ParserTest, ParseCallNoArgs) {
   Input_ << "printf()";
   Parser Parse(Input_);
-  std::unique_ptr<Expr> Func = Parse.ParseIDExpr();
+  Expr *Func = Parse.ParseIDExpr();
   ASSERT_TRUE(Parse.Ok());
 
   const Call &call = static_cast<const Call &>(*Func);
 
   const ID &caller = static_cast<const ID &>(call.Caller());
-  ASSERT_STREQ(caller.Name().c_str(), "printf");
+  ASSERT_EQ(caller.Name(), Symbol::Intern("printf"));
 
-  ASSERT_TRUE(call.Args().empty());
+  ASSERT_TRUE(call.Args().Empty());
 }
 
 TEST_F(ParserTest, ParseCallOneArg) {
   Input_ << "printf(abc)";
   Parser Parse(Input_);
-  std::unique_ptr<Expr> Func = Parse.ParseIDExpr();
+  Expr *Func = Parse.ParseIDExpr();
   ASSERT_TRUE(Parse.Ok());
 
   const Call &call = static_cast<const Call &>(*Func);
 
   const ID caller = static_cast<const ID &>(call.Caller());
-  ASSERT_STREQ(caller.Name().c_str(), "printf");
+  ASSERT_EQ(caller.Name(), Symbol::Intern("printf"));
 
-  const std::vector<std::unique_ptr<Expr>> &Args = call.Args();
-  ASSERT_EQ(Args.size(), 1);
+  ArrayRef<const Expr *> Args = call.Args();
+  ASSERT_EQ(Args.Size(), 1);
 
-  const ID &Arg = static_cast<const ID &>(*Args.front());
-  ASSERT_STREQ(Arg.Name().c_str(), "abc");
+  const ID &Arg = static_cast<const ID &>(*Args[0]);
+  ASSERT_EQ(Arg.Name(), Symbol::Intern("abc"));
 }
 
 TEST_F(ParserTest, ParseCallMultipleArgs) {
   Input_ << "printf(abc, 123, \"str\")";
   Parser Parse(Input_);
-  std::unique_ptr<Expr> Func = Parse.ParseIDExpr();
+  Expr *Func = Parse.ParseIDExpr();
   ASSERT_TRUE(Parse.Ok());
 
   const Call &call = static_cast<const Call &>(*Func);
 
   const ID &caller = static_cast<const ID &>(call.Caller());
-  ASSERT_STREQ(caller.Name().c_str(), "printf");
+  ASSERT_EQ(caller.Name(), Symbol::Intern("printf"));
 
-  const std::vector<std::unique_ptr<Expr>> &Args = call.Args();
-  ASSERT_EQ(Args.size(), 3);
+  ArrayRef<const Expr *> Args = call.Args();
+  ASSERT_EQ(Args.Size(), 3);
 
   const ID &Arg = static_cast<const ID &>(*Args[0]);
-  ASSERT_STREQ(Arg.Name().c_str(), "abc");
+  ASSERT_EQ(Arg.Name(), Symbol::Intern("abc"));
 
   const IntegerLiteral &Arg2 = static_cast<const IntegerLiteral &>(*Args[1]);
   ASSERT_EQ(Arg2.Value(), 123);
 
   const StringLiteral &Arg3 = static_cast<const StringLiteral &>(*Args[2]);
-  ASSERT_STREQ(Arg3.Value().c_str(), "\"str\"");
+  ASSERT_EQ(Arg3.Value(), "\"str\"");
 }
 
 TEST_F(ParserTest, ParseCallNested) {
   Input_ << "printf(abc, call(\"str\"), 123)";
   Parser Parse(Input_);
-  std::unique_ptr<Expr> Func = Parse.ParseIDExpr();
+  Expr *Func = Parse.ParseIDExpr();
   ASSERT_TRUE(Parse.Ok());
 
   const Call &call = static_cast<const Call &>(*Func);
 
   const ID &caller = static_cast<const ID &>(call.Caller());
-  ASSERT_STREQ(caller.Name().c_str(), "printf");
+  ASSERT_EQ(caller.Name(), Symbol::Intern("printf"));
 
-  const std::vector<std::unique_ptr<Expr>> &Args = call.Args();
-  ASSERT_EQ(Args.size(), 3);
+  ArrayRef<const Expr *> Args = call.Args();
+  ASSERT_EQ(Args.Size(), 3);
 
   const ID &Arg = static_cast<const ID &>(*Args[0]);
-  ASSERT_STREQ(Arg.Name().c_str(), "abc");
+  ASSERT_EQ(Arg.Name(), Symbol::Intern("abc"));
 
   const Call &Arg2 = static_cast<const Call &>(*Args[1]);
 
-  const std::vector<std::unique_ptr<Expr>> &NestedArgs = Arg2.Args();
-  ASSERT_EQ(NestedArgs.size(), 1);
+  ArrayRef<const Expr *> NestedArgs = Arg2.Args();
+  ASSERT_EQ(NestedArgs.Size(), 1);
 
   const ID &NestedCaller = static_cast<const ID &>(Arg2.Caller());
-  ASSERT_STREQ(NestedCaller.Name().c_str(), "call");
+  ASSERT_EQ(NestedCaller.Name(), Symbol::Intern("call"));
 
   const StringLiteral &NestedArg =
       static_cast<const StringLiteral &>(*NestedArgs[0]);
-  ASSERT_STREQ(NestedArg.Value().c_str(), "\"str\"");
+  ASSERT_EQ(NestedArg.Value(), "\"str\"");
 
   const IntegerLiteral &Arg3 = static_cast<const IntegerLiteral &>(*Args[2]);
   ASSERT_EQ(Arg3.Value(), 123);
@@ -195,23 +226,23 @@ TEST_F(ParserTest, ParseCallNested) {
 TEST_F(ParserTest, ParseExprStmt) {
   Input_ << "printf(\"str\");";
   Parser Parse(Input_);
-  std::unique_ptr<Stmt> Stmt = Parse.ParseStmt();
+  Stmt *Stmt = Parse.ParseStmt();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(Stmt, nullptr);
 
-  const auto *EStmt = static_cast<const ExprStmt *>(Stmt.get());
+  const auto *EStmt = static_cast<const ExprStmt *>(Stmt);
   ASSERT_NE(EStmt, nullptr);
 
   const Call *Func = static_cast<const Call *>(EStmt->Expression());
   ASSERT_NE(Func, nullptr);
-  ASSERT_EQ(Func->Args().size(), 1);
+  ASSERT_EQ(Func->Args().Size(), 1);
 
   const ID &Caller = static_cast<const ID &>(Func->Caller());
-  ASSERT_STREQ(Caller.Name().c_str(), "printf");
+  ASSERT_EQ(Caller.Name(), Symbol::Intern("printf"));
 
   const StringLiteral &Arg =
       static_cast<const StringLiteral &>(*(Func->Args()[0]));
-  ASSERT_STREQ(Arg.Value().c_str(), "\"str\"");
+  ASSERT_EQ(Arg.Value(), "\"str\"");
 
   ASSERT_TRUE(Parse.ReachedEOF());
 }
@@ -219,14 +250,14 @@ TEST_F(ParserTest, ParseExprStmt) {
 TEST_F(ParserTest, ParseReturn) {
   Input_ << "return 0;";
   Parser Parse(Input_);
-  std::unique_ptr<Stmt> Stmt = Parse.ParseStmt();
+  Stmt *Stmt = Parse.ParseStmt();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(Stmt, nullptr);
 
-  const auto *Ret = static_cast<const Return *>(Stmt.get());
+  const auto *Ret = static_cast<const Return *>(Stmt);
   ASSERT_NE(Ret, nullptr);
 
-  const auto *RetVal = dynamic_cast<const IntegerLiteral *>(Ret->Value());
+  const auto *RetVal = lang::dyn_cast<IntegerLiteral>(Ret->Value());
   ASSERT_NE(RetVal, nullptr);
   ASSERT_EQ(RetVal->Value(), 0);
 
@@ -236,27 +267,27 @@ TEST_F(ParserTest, ParseReturn) {
 TEST_F(ParserTest, Typename) {
   Input_ << "int";
   Parser Parse(Input_);
-  std::unique_ptr<Type> Ty = Parse.ParseType();
+  Type *Ty = Parse.ParseType();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(Ty, nullptr);
 
-  const auto *Tyname = static_cast<const Typename *>(Ty.get());
-  ASSERT_STREQ(Tyname->Name().c_str(), "int");
+  const auto *Tyname = static_cast<const Typename *>(Ty);
+  ASSERT_EQ(Tyname->Name(), Symbol::Intern("int"));
 }
 
 TEST_F(ParserTest, ArgDecl) {
   Input_ << "int x";
   Parser Parse(Input_);
-  std::unique_ptr<ArgumentDeclaration> ArgDecl =
+  ArgumentDeclaration *ArgDecl =
       Parse.ParseArgumentDeclaration();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(ArgDecl, nullptr);
 
-  ASSERT_STREQ(ArgDecl->Name().c_str(), "x");
+  ASSERT_EQ(ArgDecl->Name(), Symbol::Intern("x"));
 
   const auto *Ty = static_cast<const Typename *>(ArgDecl->ArgType());
   ASSERT_NE(Ty, nullptr);
-  ASSERT_STREQ(Ty->Name().c_str(), "int");
+  ASSERT_EQ(Ty->Name(), Symbol::Intern("int"));
 }
 
 TEST_F(ParserTest, ParseFuncDecl) {
@@ -265,7 +296,7 @@ TEST_F(ParserTest, ParseFuncDecl) {
             "  return 0;\n"
             "}";
   Parser Parse(Input_);
-  std::unique_ptr<FunctionDeclaration> FuncDecl =
+  FunctionDeclaration *FuncDecl =
       Parse.ParseFunctionDeclaration();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(FuncDecl, nullptr);
@@ -273,28 +304,28 @@ TEST_F(ParserTest, ParseFuncDecl) {
   // Return type
   const auto *RetTy = static_cast<const Typename *>(FuncDecl->ReturnType());
   ASSERT_NE(RetTy, nullptr);
-  ASSERT_STREQ(RetTy->Name().c_str(), "int");
+  ASSERT_EQ(RetTy->Name(), Symbol::Intern("int"));
 
   // Name
-  ASSERT_STREQ(FuncDecl->Name().c_str(), "main");
+  ASSERT_EQ(FuncDecl->Name(), Symbol::Intern("main"));
 
   // Arguments
   const auto &Args = FuncDecl->Args();
-  ASSERT_EQ(Args.size(), 0);
+  ASSERT_EQ(Args.Size(), 0);
 
   // Body
   const auto &Body = FuncDecl->Body();
-  ASSERT_EQ(Body.size(), 2);
+  ASSERT_EQ(Body.Size(), 2);
   const auto &Stmt1 = static_cast<const ExprStmt &>(*Body[0]);
 
   // printf
   const auto *call = static_cast<const Call *>(Stmt1.Expression());
   ASSERT_NE(call, nullptr);
   const auto &func = static_cast<const ID &>(call->Caller());
-  ASSERT_STREQ(func.Name().c_str(), "printf");
+  ASSERT_EQ(func.Name(), Symbol::Intern("printf"));
 
   const auto &Stmt2 = static_cast<const Return &>(*Body[1]);
-  const auto *retval = dynamic_cast<const IntegerLiteral *>(Stmt2.Value());
+  const auto *retval = lang::dyn_cast<IntegerLiteral>(Stmt2.Value());
   ASSERT_NE(retval, nullptr);
   ASSERT_EQ(retval->Value(), 0);
 }
@@ -302,30 +333,30 @@ TEST_F(ParserTest, ParseFuncDecl) {
 TEST_F(ParserTest, FuncDeclArgsNoBody) {
   Input_ << "void func(int a, char b) {}";
   Parser Parse(Input_);
-  std::unique_ptr<FunctionDeclaration> FuncDecl =
+  FunctionDeclaration *FuncDecl =
       Parse.ParseFunctionDeclaration();
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(FuncDecl, nullptr);
 
   // Arguments
   const auto &Args = FuncDecl->Args();
-  ASSERT_EQ(Args.size(), 2);
+  ASSERT_EQ(Args.Size(), 2);
 
   const auto &Arg1 = static_cast<const ArgumentDeclaration &>(*Args[0]);
   const auto *Arg1Ty = static_cast<const Typename *>(Arg1.ArgType());
   ASSERT_NE(Arg1Ty, nullptr);
-  ASSERT_STREQ(Arg1Ty->Name().c_str(), "int");
-  ASSERT_STREQ(Arg1.Name().c_str(), "a");
+  ASSERT_EQ(Arg1Ty->Name(), Symbol::Intern("int"));
+  ASSERT_EQ(Arg1.Name(), Symbol::Intern("a"));
 
   const auto &Arg2 = static_cast<const ArgumentDeclaration &>(*Args[1]);
   const auto *Arg2Ty = static_cast<const Typename *>(Arg2.ArgType());
   ASSERT_NE(Arg2Ty, nullptr);
-  ASSERT_STREQ(Arg2Ty->Name().c_str(), "char");
-  ASSERT_STREQ(Arg2.Name().c_str(), "b");
+  ASSERT_EQ(Arg2Ty->Name(), Symbol::Intern("char"));
+  ASSERT_EQ(Arg2.Name(), Symbol::Intern("b"));
 
   // Body
   const auto &Body = FuncDecl->Body();
-  ASSERT_EQ(Body.size(), 0);
+  ASSERT_EQ(Body.Size(), 0);
 }
 
 TEST_PARSE_EXPR(IntegerLiteral, "123");
@@ -335,24 +366,24 @@ TEST_F(ParserTest, Empty) {
   Parser Parse(Input_);
   std::unique_ptr<Module> Mod = Parse.Parse();
   ASSERT_NE(Mod, nullptr);
-  ASSERT_TRUE(Mod->ExternDecls().empty());
+  ASSERT_TRUE(Mod->ExternDecls().Empty());
 }
 
 TEST_F(ParserTest, VarDecl) {
   Input_ << "x : int = 2;";
   Parser Parse(Input_);
-  std::unique_ptr<Stmt> stmt = Parse.ParseStmt();
+  Stmt *stmt = Parse.ParseStmt();
   ASSERT_TRUE(Parse.DebugOk());
   ASSERT_NE(stmt, nullptr);
 
-  const auto *decl = static_cast<const VarDecl *>(stmt.get());
-  ASSERT_STREQ(decl->Name().c_str(), "x");
+  const auto *decl = static_cast<const VarDecl *>(stmt);
+  ASSERT_EQ(decl->Name(), Symbol::Intern("x"));
 
   const auto &ty = static_cast<const Typename &>(decl->VarType());
-  ASSERT_STREQ(ty.Name().c_str(), "int");
+  ASSERT_EQ(ty.Name(), Symbol::Intern("int"));
 
   ASSERT_TRUE(decl->HasInit());
-  const auto &init = dynamic_cast<const IntegerLiteral &>(decl->Init());
+  const auto &init = lang::cast<IntegerLiteral>(decl->Init());
   ASSERT_EQ(init.Value(), 2);
 
   ASSERT_TRUE(Parse.ReachedEOF());
@@ -361,21 +392,40 @@ TEST_F(ParserTest, VarDecl) {
 TEST_F(ParserTest, VarDeclNoInit) {
   Input_ << "x : int;";
   Parser Parse(Input_);
-  std::unique_ptr<Stmt> stmt = Parse.ParseStmt();
+  Stmt *stmt = Parse.ParseStmt();
   ASSERT_TRUE(Parse.DebugOk());
   ASSERT_NE(stmt, nullptr);
 
-  const auto *decl = static_cast<const VarDecl *>(stmt.get());
-  ASSERT_STREQ(decl->Name().c_str(), "x");
+  const auto *decl = static_cast<const VarDecl *>(stmt);
+  ASSERT_EQ(decl->Name(), Symbol::Intern("x"));
 
   const auto &ty = static_cast<const Typename &>(decl->VarType());
-  ASSERT_STREQ(ty.Name().c_str(), "int");
+  ASSERT_EQ(ty.Name(), Symbol::Intern("int"));
 
   ASSERT_FALSE(decl->HasInit());
 
   ASSERT_TRUE(Parse.ReachedEOF());
 }
 
+TEST_F(ParserTest, ParseStackOnError) {
+  Input_ << "int main() {\n"
+            "  return ;\n"
+            "}";
+  Parser Parse(Input_);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_EQ(Mod, nullptr);
+  ASSERT_EQ(Parse.Status(), lang::PSTAT_UNEXPECTED_TOKEN_ERR);
+
+  std::stringstream Stack;
+  Parse.DumpParseStack(Stack);
+#if LANG_PARSE_TRACE
+  ASSERT_EQ(Stack.str(),
+            "Parse stack <Module; FunctionDeclaration; Stmt; Expr; >\n");
+#else
+  ASSERT_EQ(Stack.str(), "Parse stack <>\n");
+#endif
+}
+
 TEST_F(ParserTest, HelloWorld) {
   Input_ << "int main() {"
             "  printf(\"hello world\\n\");"
@@ -386,34 +436,34 @@ TEST_F(ParserTest, HelloWorld) {
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(Mod, nullptr);
 
-  ASSERT_EQ(Mod->ExternDecls().size(), 1);
+  ASSERT_EQ(Mod->ExternDecls().Size(), 1);
   const auto &FuncDecl =
       static_cast<const FunctionDeclaration &>(*(Mod->ExternDecls()[0]));
 
   // Return type
   const auto *RetTy = static_cast<const Typename *>(FuncDecl.ReturnType());
-  ASSERT_STREQ(RetTy->Name().c_str(), "int");
+  ASSERT_EQ(RetTy->Name(), Symbol::Intern("int"));
 
   // Name
-  ASSERT_STREQ(FuncDecl.Name().c_str(), "main");
+  ASSERT_EQ(FuncDecl.Name(), Symbol::Intern("main"));
 
   // Arguments
   const auto &Args = FuncDecl.Args();
-  ASSERT_EQ(Args.size(), 0);
+  ASSERT_EQ(Args.Size(), 0);
 
   // Body
   const auto &Body = FuncDecl.Body();
-  ASSERT_EQ(Body.size(), 2);
+  ASSERT_EQ(Body.Size(), 2);
   const auto &Stmt1 = static_cast<const ExprStmt &>(*Body[0]);
 
   // printf
-  const auto *call = dynamic_cast<const Call *>(Stmt1.Expression());
+  const auto *call = lang::dyn_cast<Call>(Stmt1.Expression());
   ASSERT_NE(call, nullptr);
   const auto &func = static_cast<const ID &>(call->Caller());
-  ASSERT_STREQ(func.Name().c_str(), "printf");
+  ASSERT_EQ(func.Name(), Symbol::Intern("printf"));
 
   const auto &Stmt2 = static_cast<const Return &>(*Body[1]);
-  const auto *retval = dynamic_cast<const IntegerLiteral *>(Stmt2.Value());
+  const auto *retval = lang::dyn_cast<IntegerLiteral>(Stmt2.Value());
   ASSERT_NE(retval, nullptr);
   ASSERT_EQ(retval->Value(), 0);
 }
@@ -425,38 +475,596 @@ TEST_F(ParserTest, HelloWorldFromFile) {
   ASSERT_TRUE(Parse.Ok());
   ASSERT_NE(Mod, nullptr);
 
-  ASSERT_EQ(Mod->ExternDecls().size(), 1);
+  ASSERT_EQ(Mod->ExternDecls().Size(), 1);
   const auto &FuncDecl =
       static_cast<const FunctionDeclaration &>(*(Mod->ExternDecls()[0]));
 
   // Return type
   const auto *RetTy = static_cast<const Typename *>(FuncDecl.ReturnType());
-  ASSERT_STREQ(RetTy->Name().c_str(), "int");
+  ASSERT_EQ(RetTy->Name(), Symbol::Intern("int"));
 
   // Name
-  ASSERT_STREQ(FuncDecl.Name().c_str(), "main");
+  ASSERT_EQ(FuncDecl.Name(), Symbol::Intern("main"));
 
   // Arguments
   const auto &Args = FuncDecl.Args();
-  ASSERT_EQ(Args.size(), 0);
+  ASSERT_EQ(Args.Size(), 0);
 
   // Body
   const auto &Body = FuncDecl.Body();
-  ASSERT_EQ(Body.size(), 2);
+  ASSERT_EQ(Body.Size(), 2);
   const auto &Stmt1 = static_cast<const ExprStmt &>(*Body[0]);
 
   // printf
   const auto *call = static_cast<const Call *>(Stmt1.Expression());
   ASSERT_NE(call, nullptr);
   const auto &func = static_cast<const ID &>(call->Caller());
-  ASSERT_STREQ(func.Name().c_str(), "printf");
+  ASSERT_EQ(func.Name(), Symbol::Intern("printf"));
 
   const auto &Stmt2 = static_cast<const Return &>(*Body[1]);
-  const auto *retval = dynamic_cast<const IntegerLiteral *>(Stmt2.Value());
+  const auto *retval = lang::dyn_cast<IntegerLiteral>(Stmt2.Value());
   ASSERT_NE(retval, nullptr);
   ASSERT_EQ(retval->Value(), 0);
 }
 
+TEST_F(ParserTest, HelloWorldFromTokenStream) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromFile("examples/hello_world.lang");
+  ASSERT_NE(Buf, nullptr);
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+  Parser Parse(Toks);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+  ASSERT_NE(Mod, nullptr);
+  ASSERT_TRUE(Parse.ReachedEOF());
+
+  ASSERT_EQ(Mod->ExternDecls().Size(), 1);
+  const auto &FuncDecl =
+      static_cast<const FunctionDeclaration &>(*(Mod->ExternDecls()[0]));
+  ASSERT_EQ(FuncDecl.Name(), Symbol::Intern("main"));
+
+  const auto &Body = FuncDecl.Body();
+  ASSERT_EQ(Body.Size(), 2);
+  const auto &Stmt1 = static_cast<const ExprStmt &>(*Body[0]);
+  const auto *call = lang::dyn_cast<Call>(Stmt1.Expression());
+  ASSERT_NE(call, nullptr);
+  const auto &Arg = static_cast<const StringLiteral &>(*(call->Args()[0]));
+  ASSERT_EQ(Arg.Value(), "\"hello world\\n\"");
+
+  const auto &Stmt2 = static_cast<const Return &>(*Body[1]);
+  const auto *retval = lang::dyn_cast<IntegerLiteral>(Stmt2.Value());
+  ASSERT_NE(retval, nullptr);
+  ASSERT_EQ(retval->Value(), 0);
+}
+
+TEST_F(ParserTest, NodeLocations) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      "int main() {\n"
+      "  printf(\"hi\", 2);\n"
+      "  return 0;\n"
+      "}\n");
+  Parser Parse(*Buf);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+  const lang::LineTable &Lines = Buf->Lines();
+
+  const auto &FuncDecl =
+      static_cast<const FunctionDeclaration &>(*(Mod->ExternDecls()[0]));
+  ASSERT_EQ(FuncDecl.Loc(), 0);
+
+  const auto &Stmt1 = static_cast<const ExprStmt &>(*FuncDecl.Body()[0]);
+  ASSERT_EQ(Lines.Lookup(Stmt1.Loc()).Row, 1);
+  ASSERT_EQ(Lines.Lookup(Stmt1.Loc()).Col, 2);
+  const auto &call = static_cast<const Call &>(*Stmt1.Expression());
+  ASSERT_EQ(call.Loc(), Stmt1.Loc());
+  ASSERT_EQ(Lines.Lookup(call.Args()[0]->Loc()).Col, 9);
+  ASSERT_EQ(Lines.Lookup(call.Args()[1]->Loc()).Col, 15);
+
+  const auto &Stmt2 = static_cast<const Return &>(*FuncDecl.Body()[1]);
+  ASSERT_EQ(Lines.Lookup(Stmt2.Loc()).Row, 2);
+  ASSERT_EQ(Lines.Lookup(Stmt2.Loc()).Col, 2);
+  ASSERT_EQ(Lines.Lookup(Stmt2.Value()->Loc()).Col, 9);
+}
+
+TEST_F(ParserTest, ParseNextDecl) {
+  std::string Src;
+  for (unsigned i = 0; i < 2000; ++i)
+    Src += "int f" + std::to_string(i) + "() { printf(\"some text\"); }\n";
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(Src);
+  Parser Parse(*Buf);
+
+  size_t MaxBytes = 0;
+  unsigned NumDecls = 0;
+  while (const lang::ast::ExternalDeclaration *Decl = Parse.ParseNextDecl()) {
+    const auto *Func = lang::cast<FunctionDeclaration>(Decl);
+    ASSERT_EQ(Func->Name(), Symbol::Intern("f" + std::to_string(NumDecls)));
+    ASSERT_EQ(Func->Body().Size(), 1);
+    MaxBytes = std::max(MaxBytes, Parse.Context().BytesAllocated());
+    ++NumDecls;
+  }
+  ASSERT_TRUE(Parse.Ok());
+  ASSERT_EQ(NumDecls, 2000);
+
+  // Memory is reused between declarations instead of growing with the file.
+  Parser Whole(*Buf);
+  std::unique_ptr<Module> Mod = Whole.Parse();
+  ASSERT_LT(MaxBytes * 4, Mod->Context().BytesAllocated());
+}
+
+TEST_F(ParserTest, ParseNextDeclError) {
+  Input_ << "int f() { return 0; } int g( { }";
+  Parser Parse(Input_);
+  ASSERT_NE(Parse.ParseNextDecl(), nullptr);
+  ASSERT_EQ(Parse.ParseNextDecl(), nullptr);
+  ASSERT_FALSE(Parse.Ok());
+  ASSERT_EQ(Parse.ParseNextDecl(), nullptr);
+}
+
+std::string DumpModule(const Module &Mod) {
+  std::stringstream Out;
+  lang::ast::ASTDumper Dumper(Out);
+  Dumper.Visit(Mod);
+  return Out.str();
+}
+
+std::string ManyFunctions(unsigned NumFuncs) {
+  std::string Src;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Src += "int f" + std::to_string(i) + "(int a, char b) {\n";
+    for (unsigned j = 0; j < i % 7; ++j)
+      Src += "  printf(\"%d\", a, " + std::to_string(j) + ");\n";
+    Src += "  return " + std::to_string(i) + ";\n}\n";
+  }
+  return Src;
+}
+
+TEST_F(ParserTest, ParseParallel) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(ManyFunctions(3000));
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+
+  Parser Serial(Toks);
+  std::unique_ptr<Module> Expected = Serial.Parse();
+  ASSERT_TRUE(Serial.Ok());
+
+  ThreadPool Pool(4);
+  for (unsigned NumChunks : {0, 1, 3, 64, 10000}) {
+    Parser Parse(Toks);
+    std::unique_ptr<Module> Mod = Parse.ParseParallel(Pool, NumChunks);
+    ASSERT_TRUE(Parse.Ok());
+    ASSERT_NE(Mod, nullptr);
+    ASSERT_EQ(DumpModule(*Mod), DumpModule(*Expected));
+    ASSERT_EQ(Mod->DeclLoc(2999), Expected->DeclLoc(2999));
+  }
+
+  std::unique_ptr<MemoryBuffer> Empty = MemoryBuffer::FromString(" \n");
+  TokenStream EmptyToks(*Empty);
+  ASSERT_TRUE(EmptyToks.LexAll());
+  Parser Parse(EmptyToks);
+  std::unique_ptr<Module> Mod = Parse.ParseParallel(Pool);
+  ASSERT_NE(Mod, nullptr);
+  ASSERT_TRUE(Mod->ExternDecls().Empty());
+}
+
+TEST_F(ParserTest, ParseParallelErrors) {
+  // A bad body, a bad signature, a stray brace, an unclosed body and a lexer
+  // error are all reported the same way a serial parse reports them.
+  for (const char *Bad : {"int f() { return; }", "int f( { }", "}",
+                          "int f() { return 0;", "int f() { \\ }"}) {
+    std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+        ManyFunctions(500) + Bad + ManyFunctions(500));
+    TokenStream Toks(*Buf);
+    Toks.LexAll();
+
+    Parser Serial(Toks);
+    ASSERT_EQ(Serial.Parse(), nullptr);
+    std::stringstream Expected;
+    Serial.DumpParseStack(Expected);
+
+    ThreadPool Pool(4);
+    Parser Parse(Toks);
+    ASSERT_EQ(Parse.ParseParallel(Pool), nullptr);
+    ASSERT_EQ(Parse.Status(), Serial.Status());
+    ASSERT_EQ(Parse.LastReadTok().Offset, Serial.LastReadTok().Offset);
+    std::stringstream Actual;
+    Parse.DumpParseStack(Actual);
+    ASSERT_EQ(Actual.str(), Expected.str());
+  }
+}
+
+TEST_F(ParserTest, ParseParallelRecoverableErrors) {
+  // These bodies still come back as declarations, with the error set, so
+  // the parallel parse has to check each chunk's status and not only what
+  // it returns.
+  for (const char *Bad : {"int main() { x : ;; return 0; }",
+                          "int main() { char c : ; return 0; }"}) {
+    std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+        ManyFunctions(500) + Bad + ManyFunctions(500));
+    TokenStream Toks(*Buf);
+    ASSERT_TRUE(Toks.LexAll());
+
+    Parser Serial(Toks);
+    std::unique_ptr<Module> Expected = Serial.Parse();
+    ASSERT_FALSE(Serial.Ok());
+
+    ThreadPool Pool(4);
+    for (unsigned NumChunks : {0, 1, 3, 64}) {
+      Parser Parse(Toks);
+      std::unique_ptr<Module> Mod = Parse.ParseParallel(Pool, NumChunks);
+      ASSERT_FALSE(Parse.Ok());
+      ASSERT_EQ(Parse.Status(), Serial.Status());
+      ASSERT_EQ(Parse.LastReadTok().Offset, Serial.LastReadTok().Offset);
+      ASSERT_EQ(Mod == nullptr, Expected == nullptr);
+    }
+  }
+}
+
+TEST_F(ParserTest, ParseLazy) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(ManyFunctions(1000));
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+
+  Parser Eager(Toks);
+  std::unique_ptr<Module> Expected = Eager.Parse();
+  ASSERT_TRUE(Eager.Ok());
+
+  Parser Parse(Toks);
+  std::unique_ptr<Module> Mod = Parse.ParseLazy();
+  ASSERT_TRUE(Parse.Ok());
+  ASSERT_TRUE(Parse.ReachedEOF());
+  ASSERT_NE(Mod->Bodies(), nullptr);
+  ASSERT_LT(Mod->Context().BytesAllocated(),
+            Expected->Context().BytesAllocated());
+
+  // Signatures are there without parsing any body.
+  const auto &Last =
+      static_cast<const FunctionDeclaration &>(*Mod->ExternDecls()[999]);
+  ASSERT_EQ(Last.Name(), Symbol::Intern("f999"));
+  ASSERT_EQ(Last.Args().Size(), 2);
+  for (const auto *Decl : Mod->ExternDecls())
+    ASSERT_FALSE(lang::cast<FunctionDeclaration>(Decl)->HasParsedBody());
+
+  // Bodies are parsed as they are reached, from any number of threads.
+  ThreadPool Pool(4);
+  for (unsigned i = 0; i < 4; ++i)
+    Pool.Async([&] {
+      for (const auto *Decl : Mod->ExternDecls())
+        lang::cast<FunctionDeclaration>(Decl)->Body();
+    });
+  Pool.Wait();
+  ASSERT_TRUE(Mod->Bodies()->Ok());
+  ASSERT_EQ(DumpModule(*Mod), DumpModule(*Expected));
+}
+
+TEST_F(ParserTest, ParseLazyBodyError) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      "int f() { return 0; }\n"
+      "int g() { return; }\n"
+      "int h() { return 0;");
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+
+  // The unclosed body cannot be skipped, so it is parsed right away and the
+  // error is reported by the parser.
+  Parser Unclosed(Toks);
+  ASSERT_EQ(Unclosed.ParseLazy(), nullptr);
+  ASSERT_EQ(Unclosed.Status(), lang::PSTAT_UNEXPECTED_TOKEN_ERR);
+
+  // An error inside a skipped body only shows up once the body is asked for.
+  std::unique_ptr<MemoryBuffer> Buf2 = MemoryBuffer::FromString(
+      "int f() { return 0; }\n"
+      "int g() { return; }\n");
+  TokenStream Toks2(*Buf2);
+  ASSERT_TRUE(Toks2.LexAll());
+  Parser Parse(Toks2);
+  std::unique_ptr<Module> Mod = Parse.ParseLazy();
+  ASSERT_TRUE(Parse.Ok());
+  ASSERT_TRUE(Mod->Bodies()->Ok());
+
+  const auto *F = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[0]);
+  const auto *G = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[1]);
+  ASSERT_EQ(F->Body().Size(), 1);
+  ASSERT_TRUE(Mod->Bodies()->Ok());
+  ASSERT_TRUE(G->Body().Empty());
+  ASSERT_TRUE(G->HasParsedBody());
+  ASSERT_FALSE(Mod->Bodies()->Ok());
+}
+
+TEST_F(ParserTest, ParseLazyRecoverableBodyError) {
+  // The body parser gets past `x : ;` with a body to return, but its status
+  // is an error, and forcing the body has to report it.
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      "int f() { return 0; }\n"
+      "int main() { x : ;; return 0; }\n");
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+  Parser Parse(Toks);
+  std::unique_ptr<Module> Mod = Parse.ParseLazy();
+  ASSERT_TRUE(Parse.Ok());
+
+  const auto *F = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[0]);
+  const auto *Main = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[1]);
+  ASSERT_EQ(F->Body().Size(), 1);
+  ASSERT_TRUE(Mod->Bodies()->Ok());
+  ASSERT_TRUE(Main->Body().Empty());
+  ASSERT_FALSE(Mod->Bodies()->Ok());
+  ASSERT_FALSE(Mod->Bodies()->DebugOk());
+}
+
+TEST_F(ParserTest, ParseLazyWithoutTokenStream) {
+  Input_ << "int f() { return 0; }";
+  Parser Parse(Input_);
+  std::unique_ptr<Module> Mod = Parse.ParseLazy();
+  ASSERT_TRUE(Parse.Ok());
+  ASSERT_EQ(Mod->Bodies(), nullptr);
+  const auto *F = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[0]);
+  ASSERT_TRUE(F->HasParsedBody());
+  ASSERT_EQ(F->Body().Size(), 1);
+}
+
+TEST_F(ParserTest, CallWithNoArgs) {
+  Input_ << "int main() { f(); return g(1, h()); }";
+  Parser Parse(Input_);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+  const auto *Func = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[0]);
+  const auto *Stmt1 = lang::cast<ExprStmt>(Func->Body()[0]);
+  ASSERT_TRUE(lang::cast<Call>(Stmt1->Expression())->Args().Empty());
+  const auto *Stmt2 = lang::cast<Return>(Func->Body()[1]);
+  const auto *G = lang::cast<Call>(Stmt2->Value());
+  ASSERT_EQ(G->Args().Size(), 2);
+  ASSERT_TRUE(lang::cast<Call>(G->Args()[1])->Args().Empty());
+}
+
+std::string NestedCalls(unsigned Depth, const char *Innermost = "1") {
+  std::string Src = "int main() {\n  return ";
+  for (unsigned i = 0; i < Depth; ++i) Src += "f(";
+  Src += Innermost;
+  Src.append(Depth, ')');
+  return Src + ";\n}\n";
+}
+
+double SecondsToParse(const MemoryBuffer &Buf) {
+  auto Start = std::chrono::steady_clock::now();
+  Parser Parse(Buf);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  std::chrono::duration<double> Secs = std::chrono::steady_clock::now() - Start;
+  EXPECT_TRUE(Parse.Ok());
+  return Secs.count();
+}
+
+TEST_F(ParserTest, DeeplyNestedCalls) {
+  // Far deeper than the C++ stack could take if each call recursed.
+  const unsigned Depth = 1000000;
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(NestedCalls(Depth));
+  Parser Parse(*Buf);
+  std::unique_ptr<Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+
+  const auto *Func = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[0]);
+  const Expr *E = lang::cast<Return>(Func->Body()[0])->Value();
+  unsigned NumCalls = 0;
+  while (const auto *C = lang::dyn_cast<Call>(E)) {
+    ASSERT_EQ(C->Args().Size(), 1);
+    E = C->Args()[0];
+    ++NumCalls;
+  }
+  ASSERT_EQ(NumCalls, Depth);
+  ASSERT_EQ(lang::cast<IntegerLiteral>(E)->Value(), 1);
+
+  // Ten times the depth should take about ten times as long, not a hundred.
+  std::unique_ptr<MemoryBuffer> Small =
+      MemoryBuffer::FromString(NestedCalls(Depth / 10));
+  double SmallSecs = SecondsToParse(*Small);
+  double BigSecs = SecondsToParse(*Buf);
+  ASSERT_LT(BigSecs, SmallSecs * 40);
+}
+
+TEST_F(ParserTest, DeeplyNestedCallError) {
+  // Errors in arguments keep the parse stack the recursive rules would have.
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(NestedCalls(2, ";"));
+  Parser Parse(*Buf);
+  ASSERT_EQ(Parse.Parse(), nullptr);
+  ASSERT_EQ(Parse.Status(), lang::PSTAT_UNEXPECTED_TOKEN_ERR);
+  std::stringstream Stack;
+  Parse.DumpParseStack(Stack);
+  ASSERT_EQ(Stack.str(),
+            "Parse stack <Module; FunctionDeclaration; Stmt; Expr; ExprList; "
+            "Expr; ExprList; Expr; >\n");
+
+  // A bad int inside an argument list is reported as an unexpected token.
+  Buf = MemoryBuffer::FromString(NestedCalls(1000000, "99999999999999999999"));
+  Parser Deep(*Buf);
+  ASSERT_EQ(Deep.Parse(), nullptr);
+  ASSERT_EQ(Deep.Status(), lang::PSTAT_UNEXPECTED_TOKEN_ERR);
+
+  // A missing paren at the outermost call.
+  std::string Src = NestedCalls(1000000);
+  Src.erase(Src.find(';') - 1, 1);
+  Buf = MemoryBuffer::FromString(Src);
+  Parser Unclosed(*Buf);
+  ASSERT_EQ(Unclosed.Parse(), nullptr);
+  ASSERT_EQ(Unclosed.Status(), lang::PSTAT_UNEXPECTED_TOKEN_ERR);
+  Stack.str("");
+  Unclosed.DumpParseStack(Stack);
+  ASSERT_EQ(Stack.str(),
+            "Parse stack <Module; FunctionDeclaration; Stmt; Expr; >\n");
+}
+
+/**
+ * The location of every node in walk order, after where each declaration
+ * starts.
+ */
+class LocCollector : public lang::ast::ASTWalker<LocCollector> {
+ public:
+  template <class T>
+  bool Enter(const T &N) {
+    Locs.push_back(N.Loc());
+    return true;
+  }
+
+  std::vector<lang::SourceLocation> Locs;
+};
+
+std::vector<lang::SourceLocation> Locations(const Module &Mod) {
+  LocCollector Collector;
+  Collector.Locs.assign(Mod.DeclLocs().begin(), Mod.DeclLocs().end());
+  Collector.Walk(Mod);
+  return Collector.Locs;
+}
+
+TextEdit Replace(const std::string &Src, const std::string &Old,
+                 const std::string &New) {
+  size_t Offset = Src.find(Old);
+  assert(Offset != std::string::npos);
+  return {static_cast<uint32_t>(Offset), static_cast<uint32_t>(Old.size()),
+          New};
+}
+
+TEST_F(ParserTest, Reparse) {
+  std::string Src = ManyFunctions(20);
+  uint32_t Size = Src.size();
+  std::vector<TextEdit> Edits = {
+      // Inside one body, growing, shrinking and keeping its length.
+      Replace(Src, "return 10;", "return 12345;"),
+      Replace(Src, "  printf(\"%d\", a, 3);\n  return 4;", "  return 4;"),
+      Replace(Src, "a, 4);\n  return 5", "a, 9);\n  return 5"),
+      // Adding and removing whole functions.
+      Replace(Src, "int f6", "int g() {\n  return 1;\n}\nint f6"),
+      {static_cast<uint32_t>(Src.find("int f7")),
+       static_cast<uint32_t>(Src.find("int f8") - Src.find("int f7")), ""},
+      {Size, 0, "int h() { return 2; }"},
+      {0, 0, "  \n"},
+      {0, Size, ""},
+      // Joining a token onto the start of a function.
+      Replace(Src, "int f3", "xint f3"),
+      // Splitting one function into two across the boundary of the next.
+      Replace(Src, "return 12;\n}\nint f13(int a, char b) {",
+              "return 12;\n}\nint f13(int a, char b) {\n  return 0;\n}\n"
+              "int k(int a, char b) {"),
+  };
+
+  for (const TextEdit &Edit : Edits) {
+    std::unique_ptr<MemoryBuffer> OldBuf = MemoryBuffer::FromString(Src);
+    std::unique_ptr<MemoryBuffer> NewBuf =
+        MemoryBuffer::FromEdit(*OldBuf, Edit);
+    std::unique_ptr<Module> Old = Parser(*OldBuf).Parse();
+    ASSERT_NE(Old, nullptr);
+
+    Parser Parse(*NewBuf);
+    std::unique_ptr<Module> Mod = Parse.Reparse(std::move(Old), *OldBuf, Edit);
+    ASSERT_NE(Mod, nullptr) << Edit.Text;
+    std::unique_ptr<Module> Expected = Parser(*NewBuf).Parse();
+    ASSERT_NE(Expected, nullptr);
+    ASSERT_EQ(DumpModule(*Mod), DumpModule(*Expected)) << Edit.Text;
+    ASSERT_EQ(Locations(*Mod), Locations(*Expected)) << Edit.Text;
+  }
+}
+
+TEST_F(ParserTest, ReparseReusesUntouchedFunctions) {
+  std::string Src = ManyFunctions(20);
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(Src);
+  std::unique_ptr<Module> Mod = Parser(*Buf).Parse();
+
+  // Edit the same function twice, reparsing the reparsed module.
+  std::string Current = "return 10;";
+  for (const char *Text : {"return 100;", "return 1000;"}) {
+    TextEdit Edit = Replace(Src, Current, Text);
+    Current = Text;
+    std::unique_ptr<MemoryBuffer> NewBuf = MemoryBuffer::FromEdit(*Buf, Edit);
+    Src = std::string(NewBuf->Begin(), NewBuf->Size());
+
+    std::vector<const lang::ast::ExternalDeclaration *> OldDecls(
+        Mod->ExternDecls().begin(), Mod->ExternDecls().end());
+    std::weak_ptr<const lang::ast::ASTContext> Replaced =
+        Mod->DeclContext(10);
+    bool SharesContext = Mod->DeclContext(10) == Mod->DeclContext(0);
+    Parser Parse(*NewBuf);
+    Mod = Parse.Reparse(std::move(Mod), *Buf, Edit);
+    ASSERT_NE(Mod, nullptr);
+    // The old function is freed, unless the rest of the first parse still
+    // holds on to it.
+    ASSERT_EQ(Replaced.expired(), !SharesContext);
+    ASSERT_EQ(Mod->ExternDecls().Size(), 20);
+    for (size_t i = 0; i < 20; ++i) {
+      if (i == 10)
+        ASSERT_NE(Mod->ExternDecls()[i], OldDecls[i]);
+      else
+        ASSERT_EQ(Mod->ExternDecls()[i], OldDecls[i]);
+    }
+    ASSERT_EQ(Locations(*Mod), Locations(*Parser(*NewBuf).Parse()));
+    Buf = std::move(NewBuf);
+  }
+
+  // A module with deferred bodies is parsed again in full.
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+  std::unique_ptr<Module> Lazy = Parser(Toks).ParseLazy();
+  ASSERT_NE(Lazy->Bodies(), nullptr);
+  TextEdit Edit = Replace(Src, "return 1000;", "return 1;");
+  std::unique_ptr<MemoryBuffer> NewBuf = MemoryBuffer::FromEdit(*Buf, Edit);
+  Parser Parse(*NewBuf);
+  Mod = Parse.Reparse(std::move(Lazy), *Buf, Edit);
+  ASSERT_NE(Mod, nullptr);
+  ASSERT_EQ(DumpModule(*Mod), DumpModule(*Parser(*NewBuf).Parse()));
+}
+
+TEST_F(ParserTest, LocationsAreRelativeToTheirFunction) {
+  std::string First = "int f() {\n  return 1;\n}\n";
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(First + "int g() {\n  return 2;\n}\n");
+  std::unique_ptr<Module> Mod = Parser(*Buf).Parse();
+  ASSERT_NE(Mod, nullptr);
+  ASSERT_EQ(Mod->DeclLoc(0), 0);
+  ASSERT_EQ(Mod->DeclLoc(1), First.size());
+
+  const auto *G = lang::cast<FunctionDeclaration>(Mod->ExternDecls()[1]);
+  ASSERT_EQ(G->Loc(), 0);
+  ASSERT_EQ(G->Body()[0]->Loc(), 12);
+  ASSERT_EQ(Buf->Lines().Lookup(Mod->DeclLoc(1) + G->Body()[0]->Loc()).Row,
+            4);
+
+  // Deferred bodies get the same locations.
+  TokenStream Toks(*Buf);
+  ASSERT_TRUE(Toks.LexAll());
+  std::unique_ptr<Module> Lazy = Parser(Toks).ParseLazy();
+  ASSERT_NE(Lazy->Bodies(), nullptr);
+  ASSERT_EQ(Locations(*Lazy), Locations(*Mod));
+}
+
+TEST_F(ParserTest, ReparseErrors) {
+  // Errors inside the edited function, ones that run past it, and lexer
+  // errors are all reported the same way a full parse reports them.
+  std::string Src = ManyFunctions(20);
+  std::unique_ptr<MemoryBuffer> OldBuf = MemoryBuffer::FromString(Src);
+  for (const TextEdit &Edit :
+       {Replace(Src, "return 10;", "return;"),
+        Replace(Src, "return 10;\n}", "return 10;"),
+        Replace(Src, "return 10;", "return \"10;"),
+        Replace(Src, "return 10;", "return \\;"),
+        Replace(Src, "int f10", "}")}) {
+    std::unique_ptr<MemoryBuffer> NewBuf =
+        MemoryBuffer::FromEdit(*OldBuf, Edit);
+    Parser Full(*NewBuf);
+    ASSERT_EQ(Full.Parse(), nullptr);
+    std::stringstream Expected;
+    Full.DumpParseStack(Expected);
+
+    Parser Parse(*NewBuf);
+    ASSERT_EQ(Parse.Reparse(Parser(*OldBuf).Parse(), *OldBuf, Edit), nullptr);
+    ASSERT_EQ(Parse.Status(), Full.Status());
+    ASSERT_EQ(Parse.LastReadTok().Offset, Full.LastReadTok().Offset);
+    std::stringstream Actual;
+    Parse.DumpParseStack(Actual);
+    ASSERT_EQ(Actual.str(), Expected.str());
+  }
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,134 @@
+#include <sstream>
+#include <thread>
+
+#include "AST/Dump.h"
+#include "MemoryBuffer.h"
+#include "Parser.h"
+#include "Pipeline.h"
+#include "SPSCQueue.h"
+#include "TokenPipe.h"
+#include "TokenStream.h"
+#include "bench/BenchUtil.h"
+#include "gtest/gtest.h"
+
+using lang::MemoryBuffer;
+using lang::Parser;
+using lang::Pipeline;
+using lang::SPSCQueue;
+using lang::StallStats;
+using lang::TokenPipe;
+using lang::TokenStream;
+
+namespace {
+
+TEST(TestPipeline, SPSCQueue) {
+  SPSCQueue<unsigned> Queue(/*Capacity=*/5);
+  ASSERT_EQ(Queue.Capacity(), 8);
+
+  constexpr unsigned kNumItems = 1000000;
+  StallStats ProducerStalls;
+  std::thread Producer([&] {
+    for (unsigned i = 0; i < kNumItems; ++i)
+      lang::WaitFor([&] { return Queue.TryPush(i); }, ProducerStalls);
+  });
+
+  StallStats ConsumerStalls;
+  for (unsigned i = 0; i < kNumItems; ++i) {
+    unsigned Val;
+    lang::WaitFor([&] { return Queue.TryPop(Val); }, ConsumerStalls);
+    ASSERT_EQ(Val, i);
+  }
+  Producer.join();
+
+  unsigned Val;
+  ASSERT_FALSE(Queue.TryPop(Val));
+}
+
+TEST(TestPipeline, TokenPipeMatchesTokenStream) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(500));
+  TokenStream Expected(*Buf);
+  ASSERT_TRUE(Expected.LexAll());
+
+  // A tiny pipe makes both sides wait on each other.
+  TokenPipe Pipe(*Buf, /*File=*/0, /*Capacity=*/4);
+  std::thread Producer([&] { Pipe.LexAll(); });
+
+  TokenStream Actual(*Buf);
+  lang::Token Tok;
+  do {
+    ASSERT_TRUE(Pipe.ReadToken(Tok));
+    Actual.Push(Tok);
+  } while (Tok.Kind != lang::TOK_EOF);
+  Producer.join();
+
+  ASSERT_TRUE(Actual == Expected);
+
+  // EOF is sticky like it is for the lexer.
+  ASSERT_TRUE(Pipe.ReadToken(Tok));
+  ASSERT_EQ(Tok.Kind, lang::TOK_EOF);
+}
+
+/**
+ * Dump the declarations the pipeline produces in the same format ASTDumper
+ * uses for a whole module.
+ */
+bool DumpPipeline(std::string &Dump, Pipeline &Pipe) {
+  std::stringstream Out;
+  Out << "Module\n";
+  lang::ast::ASTDumper Dumper(Out);
+  bool Ok = Pipe.Run(
+      [&](const lang::ast::ExternalDeclaration &Decl) { Dumper.Visit(Decl); });
+  Dump = Out.str();
+  return Ok;
+}
+
+TEST(TestPipeline, MatchesSerialParse) {
+  std::unique_ptr<MemoryBuffer> Buf =
+      MemoryBuffer::FromString(lang::bench::GenerateSource(2000));
+
+  Parser Parse(*Buf);
+  std::unique_ptr<lang::ast::Module> Mod = Parse.Parse();
+  ASSERT_TRUE(Parse.Ok());
+  std::stringstream Expected;
+  lang::ast::ASTDumper Dumper(Expected);
+  Dumper.Visit(*Mod);
+
+  Pipeline Pipe(*Buf);
+  std::string Actual;
+  ASSERT_TRUE(DumpPipeline(Actual, Pipe));
+  ASSERT_EQ(Actual, Expected.str());
+  ASSERT_EQ(Pipe.Stats().NumDecls, 2000);
+}
+
+TEST(TestPipeline, ParseError) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      lang::bench::GenerateSource(100) + "int f( {}" +
+      lang::bench::GenerateSource(10000));
+
+  Pipeline Pipe(*Buf);
+  std::string Dump;
+  ASSERT_FALSE(DumpPipeline(Dump, Pipe));
+  ASSERT_EQ(Pipe.Stats().NumDecls, 100);
+}
+
+TEST(TestPipeline, LexerError) {
+  std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::FromString(
+      lang::bench::GenerateSource(10) + "int f() { \\ }");
+
+  Pipeline Pipe(*Buf);
+  std::string Dump;
+  ASSERT_FALSE(DumpPipeline(Dump, Pipe));
+  ASSERT_EQ(Pipe.Stats().NumDecls, 10);
+
+  Parser Parse(*Buf);
+  Parse.Parse();
+  ASSERT_EQ(Parse.Status(), lang::PSTAT_LEXER_ERR);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}